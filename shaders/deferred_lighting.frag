@@ -0,0 +1,80 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
+
+// Deferred lighting pass: shades each covered pixel once from the G-buffer
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D gDepth;
+layout(set = 0, binding = 1) uniform sampler2D gNormal;
+layout(set = 0, binding = 2) uniform sampler2D gAlbedo;
+layout(set = 0, binding = 3) uniform sampler2D ssaoTexture;
+
+// Must match frg::PointLight / frg::LightData (MAX_LIGHTS = 10), positions in view space
+struct PointLight {
+    vec4 position;
+    vec4 color;     // w component is intensity
+    float radius;
+};
+
+layout(set = 0, binding = 4) uniform LightUBO {
+    PointLight pointLights[10];
+    uint pointLightCount;
+} lights;
+
+layout(push_constant) uniform Push {
+    mat4 projection;
+    int debugMode;        // 0=normal, 1=SSAO only, 2=normals, 3=depth
+} push;
+
+const float AMBIENT_LIGHT = 0.15;
+
+// Same falloff as triangle.frag
+vec3 calculatePointLight(vec3 lightPos, vec3 lightColor, float intensity,
+                         vec3 normal, vec3 viewPos) {
+    vec3 lightDir = lightPos - viewPos;
+    float distance = length(lightDir);
+    lightDir = normalize(lightDir);
+    float attenuation =
+        1.0 / (1.0 + 0.09 * distance + 0.032 * distance * distance);
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    return lightColor * intensity * diffuse * attenuation;
+}
+
+void main() {
+    float depth = texture(gDepth, fragTexCoord).r;
+    vec3 viewPos = reconstructViewPos(fragTexCoord, depth,
+                                      projectionInfo(push.projection));
+    vec3 normal = decodeNormal(texture(gNormal, fragTexCoord).xy);
+    vec3 albedo = texture(gAlbedo, fragTexCoord).rgb;
+
+    float ao = clamp(texture(ssaoTexture, fragTexCoord).r, 0.0, 1.0);
+    if (ao < 0.001) {
+        ao = 1.0;
+    }
+
+    if (push.debugMode == 1) {
+        outColor = vec4(vec3(ao), 1.0);
+        return;
+    } else if (push.debugMode == 2) {
+        // View-space normals (the forward path shows world-space normals)
+        outColor = vec4(normal * 0.5 + 0.5, 1.0);
+        return;
+    } else if (push.debugMode == 3) {
+        outColor = vec4(vec3(depth), 1.0);
+        return;
+    }
+
+    vec3 lighting = vec3(AMBIENT_LIGHT) * ao;
+    for (uint i = 0; i < lights.pointLightCount; ++i) {
+        lighting += calculatePointLight(lights.pointLights[i].position.xyz,
+                                        lights.pointLights[i].color.xyz,
+                                        lights.pointLights[i].color.w,
+                                        normal, viewPos);
+    }
+
+    outColor = vec4(albedo * lighting, 1.0);
+}
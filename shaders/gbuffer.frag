@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
 
 // Inputs from vertex shader
 layout(location = 0) in vec3 fragViewPos;
@@ -7,17 +10,9 @@ layout(location = 2) in vec2 fragTexCoord;
 layout(location = 3) in mat3 TBN;
 
 // Multiple Render Targets (MRT)
-layout(location = 0) out vec4 gPosition;  // View-space position
-layout(location = 1) out vec4 gNormal;    // View-space normal
+// Position comes from the depth attachment; albedo is left untouched
+layout(location = 0) out vec2 gNormal;    // View-space normal (octahedral)
 
 void main() {
-    // Store view-space position
-    // Using w=1.0 to indicate valid fragment (for edge detection)
-    gPosition = vec4(fragViewPos, 1.0);
-    
-    // Store view-space normal (normalized)
-    // Pack into [0,1] range is not needed since we use RGBA16F
-    gNormal = vec4(normalize(fragViewNormal), 1.0);
-    //gNormal = vec4(normalize( fragViewNormal), 1.0);
-
+    gNormal = encodeNormal(normalize(fragViewNormal));
 }
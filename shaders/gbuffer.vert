@@ -14,11 +14,15 @@ layout(location = 3) out mat3 TBN;
 
 // Push constants
 layout(push_constant) uniform Push {
+    mat4 transform;     // projection * view * model, same as triangle.vert
     mat4 modelView;     // Model * View matrix
-    mat4 projection;    // Projection matrix
     mat4 normalMat;     // Normal matrix (transpose(inverse(modelView)))
 } push;
 
+// The final pass depth-tests EQUAL against this depth, so both vertex shaders
+// must produce bit-identical positions
+invariant gl_Position;
+
 void main() {
     // Transform position to view space
     vec4 viewPos = push.modelView * vec4(position, 1.0);
@@ -35,5 +39,5 @@ void main() {
     vec3 b = cross(fragViewNormal, t);
     TBN = mat3(t, b, fragViewNormal);
     // Final clip position
-    gl_Position = push.projection * viewPos;
+    gl_Position = push.transform * vec4(position, 1.0);
 }
@@ -0,0 +1,46 @@
+// G-buffer encoding helpers shared by every pass that reads the G-buffer
+//
+// Normals are stored octahedral-encoded in two channels ([-1, 1] range).
+// Position is not stored: it is reconstructed from the hardware depth and
+// the camera's perspective projection. projInfo packs the four projection
+// terms that matter, (P[0][0], P[1][1], P[2][2], P[3][2]); see
+// frg::FrgCamera::setPerspectiveProjection.
+
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return n.xy;
+}
+
+vec3 decodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec4 projectionInfo(mat4 projection) {
+    return vec4(projection[0][0], projection[1][1], projection[2][2],
+                projection[3][2]);
+}
+
+// Cleared depth: nothing was rasterized here
+bool isBackground(float depth) {
+    return depth >= 1.0;
+}
+
+// Hardware depth to positive view-space z
+float linearizeDepth(float depth, vec4 projInfo) {
+    return projInfo.w / (depth - projInfo.z);
+}
+
+// uv in [0, 1] across the target that depth was sampled from
+vec3 reconstructViewPos(vec2 uv, float depth, vec4 projInfo) {
+    float z = linearizeDepth(depth, projInfo);
+    vec2 ndc = uv * 2.0 - 1.0;
+    return vec3(ndc.x * z / projInfo.x, ndc.y * z / projInfo.y, z);
+}
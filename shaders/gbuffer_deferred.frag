@@ -0,0 +1,50 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+#include "gbuffer_common.glsl"
+
+layout(set = 0, binding = 0) uniform sampler tex_sampler;
+// Bindless table, sized at runtime (see FrgDescriptor)
+layout(set = 0, binding = 2) uniform texture2D textures[];
+
+// Inputs from vertex shader
+layout(location = 0) in vec3 fragViewPos;
+layout(location = 1) in vec3 fragViewNormal;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) in mat3 TBN;
+
+// Multiple Render Targets (MRT), position comes from the depth attachment
+layout(location = 0) out vec2 gNormal;    // View-space normal (normal mapped, octahedral)
+layout(location = 1) out vec4 gAlbedo;    // Albedo, a = 1 for covered pixels
+
+// Material constants, set per pipeline by DeferredRenderSystem
+layout(constant_id = 0) const int TEXTURE_COUNT = 1; // 0 = untextured
+layout(constant_id = 1) const bool NORMAL_MAP = false;
+
+// Push constants - MUST match gbuffer_deferred.vert exactly!
+layout(push_constant) uniform Push {
+    mat4 transform;
+    mat4 modelMatrix;
+    mat4 normalMat;
+    vec4 pointLightPosition;
+    vec4 pointLightColor;
+    vec2 screenSize;
+    int texture_idx;
+} push;
+
+void main() {
+    // Same materials as triangle.frag
+    vec3 albedo = vec3(1.0, 1.0, 1.0);
+    vec3 normal = normalize(fragViewNormal);
+    if (TEXTURE_COUNT > 0) {
+        albedo = texture(sampler2D(textures[push.texture_idx], tex_sampler), fragTexCoord).rgb;
+    }
+    if (NORMAL_MAP) {
+        vec3 normal_tex = texture(sampler2D(textures[push.texture_idx + 1], tex_sampler), fragTexCoord).rgb;
+        normal = normalize(TBN * normalize(normal_tex * 2.0 - 1.0));
+    }
+
+    gNormal = encodeNormal(normal);
+    gAlbedo = vec4(albedo, 1.0);
+}
@@ -0,0 +1,40 @@
+#version 450
+
+// Vertex inputs
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 tex_coord;
+layout(location = 3) in vec3 in_tangent;
+
+// Outputs to fragment shader
+layout(location = 0) out vec3 fragViewPos;
+layout(location = 1) out vec3 fragViewNormal;
+layout(location = 2) out vec2 fragTexCoord;
+layout(location = 3) out mat3 TBN;
+
+// Push constants - same layout as SimplePushConstantData (triangle.vert),
+// but modelMatrix/normalMat hold view-space transforms
+layout(push_constant) uniform Push {
+    mat4 transform;     // projection * view * model
+    mat4 modelMatrix;   // view * model
+    mat4 normalMat;     // transpose(inverse(view * model))
+    vec4 pointLightPosition;
+    vec4 pointLightColor;
+    vec2 screenSize;
+    int texture_idx;
+} push;
+
+void main() {
+    vec4 viewPos = push.modelMatrix * vec4(position, 1.0);
+    fragViewPos = viewPos.xyz;
+
+    fragViewNormal = normalize(mat3(push.normalMat) * normal);
+    fragTexCoord = tex_coord;
+
+    //https://learnopengl.com/Advanced-Lighting/Normal-Mapping
+    vec3 t = normalize((push.modelMatrix * vec4(in_tangent, 1.0)).xzy);
+    vec3 b = cross(fragViewNormal, t);
+    TBN = mat3(t, b, fragViewNormal);
+
+    gl_Position = push.transform * vec4(position, 1.0);
+}
@@ -0,0 +1,89 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
+
+// Horizon-based ambient occlusion (HBAO+ style)
+// Marches a few screen-space directions from each pixel and accumulates how
+// far the depth buffer rises above the surface's tangent plane along them.
+// Reads the same G-buffer inputs and writes the same r8 occlusion as
+// ssao.frag, so either can feed the blur.
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 0) out float fragOcclusion;
+
+// Same set layout as ssao.frag (the kernel UBO at binding 3 is unused)
+layout(set = 0, binding = 0) uniform sampler2D gDepth;
+layout(set = 0, binding = 1) uniform sampler2D gNormal;
+layout(set = 0, binding = 2) uniform sampler2D texNoise;
+
+layout(push_constant) uniform HBAOParams {
+    vec4 projInfo;
+    vec2 noiseScale;  // AO target dimensions / 4
+    float radius;     // view-space radius
+    float angleBias;  // ignores horizons within this sine of the tangent plane
+    int directions;
+    int steps;        // samples per direction
+    float rotation;   // per-frame direction offset (radians)
+} params;
+
+const float TWO_PI = 6.28318530718;
+
+vec3 viewPosAt(vec2 uv) {
+    return reconstructViewPos(uv, texture(gDepth, uv).r, params.projInfo);
+}
+
+void main() {
+    float depth = texture(gDepth, fragTexCoord).r;
+    if (isBackground(depth)) {
+        fragOcclusion = 1.0;
+        return;
+    }
+
+    vec3 P = reconstructViewPos(fragTexCoord, depth, params.projInfo);
+    vec3 N = decodeNormal(texture(gNormal, fragTexCoord).xy);
+
+    // Project the view-space radius to pixels
+    vec2 size = vec2(textureSize(gDepth, 0));
+    float radiusPixels = params.radius * params.projInfo.x * 0.5 * size.x / P.z;
+    if (radiusPixels < 1.0) {
+        fragOcclusion = 1.0;
+        return;
+    }
+    float stepPixels = radiusPixels / float(params.steps + 1);
+
+    // Per-pixel direction rotation and step jitter from the noise texture
+    vec2 noise = texture(texNoise, fragTexCoord * params.noiseScale).xy;
+    float baseAngle = atan(noise.y, noise.x) + params.rotation;
+    float jitter = fract(length(noise) * 4.0);
+
+    float negInvRadius2 = -1.0 / (params.radius * params.radius);
+    float occlusion = 0.0;
+
+    for (int d = 0; d < params.directions; ++d) {
+        float angle = baseAngle + TWO_PI * float(d) / float(params.directions);
+        vec2 dir = vec2(cos(angle), sin(angle));
+
+        float rayPixels = jitter * stepPixels + 1.0;
+        for (int s = 0; s < params.steps; ++s) {
+            // Snap to texel centers so neighbouring pixels share fetches
+            vec2 offset = round(rayPixels * dir) / size;
+            vec3 V = viewPosAt(fragTexCoord + offset) - P;
+
+            float VdotV = dot(V, V);
+            float NdotV = dot(N, V) * inversesqrt(max(VdotV, 1e-6));
+
+            // Horizon term with distance falloff (0 beyond radius)
+            float falloff = clamp(VdotV * negInvRadius2 + 1.0, 0.0, 1.0);
+            occlusion += clamp(NdotV - params.angleBias, 0.0, 1.0) * falloff;
+
+            rayPixels += stepPixels;
+        }
+    }
+
+    // Rescale so the bias does not cap the darkest value
+    occlusion /= float(params.directions * params.steps) *
+                 (1.0 - params.angleBias);
+
+    fragOcclusion = clamp(1.0 - occlusion, 0.0, 1.0);
+}
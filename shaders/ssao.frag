@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
 
 // SSAO calculation shader
 // Based on LearnOpenGL SSAO implementation
@@ -6,8 +9,8 @@
 layout(location = 0) in vec2 fragTexCoord;
 layout(location = 0) out float fragOcclusion;
 
-// G-buffer textures
-layout(set = 0, binding = 0) uniform sampler2D gPosition;
+// G-buffer textures (depth + octahedral normal)
+layout(set = 0, binding = 0) uniform sampler2D gDepth;
 layout(set = 0, binding = 1) uniform sampler2D gNormal;
 
 // Noise texture (4x4 tiled)
@@ -24,13 +27,26 @@ layout(push_constant) uniform SSAOParams {
     vec2 noiseScale;  // screen dimensions / 4
     float radius;
     float bias;
-    int kernelSize;
+    int kernelSize;    // samples evaluated this frame
+    int sampleOffset;  // first kernel index (temporal slice)
+    int sampleStride;  // kernel index step (1 = contiguous)
+    int adaptive;      // per-pixel sample count from the importance map
 } params;
 
+// Sample count per FrgSSAO::ADAPTIVE_TILE block (adaptive mode only)
+layout(set = 0, binding = 4) uniform sampler2D importanceMap;
+const int ADAPTIVE_TILE = 4;
+
 void main() {
     // Get input from G-buffer
-    vec3 fragPos = texture(gPosition, fragTexCoord).xyz;
-    vec3 normal = normalize(texture(gNormal, fragTexCoord).xyz);
+    float depth = texture(gDepth, fragTexCoord).r;
+    if (isBackground(depth)) {
+        fragOcclusion = 1.0;
+        return;
+    }
+    vec4 projInfo = projectionInfo(params.projection);
+    vec3 fragPos = reconstructViewPos(fragTexCoord, depth, projInfo);
+    vec3 normal = decodeNormal(texture(gNormal, fragTexCoord).xy);
     
     // Get random rotation vector from noise texture
     vec3 randomVec = normalize(texture(texNoise, fragTexCoord * params.noiseScale).xyz);
@@ -41,11 +57,22 @@ void main() {
     vec3 bitangent = cross(normal, tangent);
     mat3 TBN = mat3(tangent, bitangent, normal);
     
+    // Adaptive mode spreads fewer samples evenly over the kernel's radii
+    int sampleCount = params.kernelSize;
+    if (params.adaptive != 0) {
+        ivec2 block = ivec2(gl_FragCoord.xy) / ADAPTIVE_TILE;
+        sampleCount = clamp(int(texelFetch(importanceMap, block, 0).r), 1,
+                            params.kernelSize);
+    }
+
     // Iterate over sample kernel and calculate occlusion
     float occlusion = 0.0;
     
-    for (int i = 0; i < params.kernelSize; ++i) {
-        // Get sample position (in tangent space)
+    for (int k = 0; k < sampleCount; ++k) {
+        // Get sample position (in tangent space); temporal mode evaluates an
+        // interleaved slice of the kernel so every frame covers all radii
+        int i = params.sampleOffset +
+                (k * params.kernelSize / sampleCount) * params.sampleStride;
         vec3 sampleTangent = kernel.samples[i].xyz;
         
         // Transform sample to view space
@@ -58,7 +85,7 @@ void main() {
         offset.xyz = offset.xyz * 0.5 + 0.5;  // Transform to [0, 1] range
         
         // Get depth at sample position from G-buffer
-        float sampleDepth = texture(gPosition, offset.xy).z;
+        float sampleDepth = linearizeDepth(texture(gDepth, offset.xy).r, projInfo);
         
         // Range check: avoid occlusion from far-away surfaces
         // The idea: if the sampled depth is much further than our radius,
@@ -71,7 +98,7 @@ void main() {
     }
     
     // Average and invert (1.0 = no occlusion, 0.0 = fully occluded)
-    occlusion = 1.0 - (occlusion / float(params.kernelSize));
+    occlusion = 1.0 - (occlusion / float(sampleCount));
     
     fragOcclusion = occlusion;
 }
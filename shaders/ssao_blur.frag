@@ -1,25 +1,70 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
 
 // SSAO blur shader
-// Simple 4x4 box blur to remove noise pattern from SSAO
+// One direction of a separable bilateral blur. Taps are weighted by a
+// spatial gaussian, view-space depth similarity and normal similarity so
+// occlusion does not bleed across silhouettes or creases.
 
 layout(location = 0) in vec2 fragTexCoord;
 layout(location = 0) out float fragBlurred;
 
 layout(set = 0, binding = 0) uniform sampler2D ssaoInput;
+layout(set = 0, binding = 1) uniform sampler2D gDepth;
+layout(set = 0, binding = 2) uniform sampler2D gNormal;
+
+layout(push_constant) uniform Push {
+    vec4 projInfo;
+    vec2 direction;   // (1, 0) horizontal or (0, 1) vertical
+    int radius;
+    float depthSigma; // relative depth tolerance
+} push;
+
+const float NORMAL_POWER = 8.0;
 
 void main() {
-    // Get texel size
-    vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
-    
-    // 4x4 box blur (matches noise texture size)
-    float result = 0.0;
-    for (int x = -2; x < 2; ++x) {
-        for (int y = -2; y < 2; ++y) {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, fragTexCoord + offset).r;
+    ivec2 size = textureSize(ssaoInput, 0);
+    ivec2 center = ivec2(fragTexCoord * vec2(size));
+
+    float centerDepth = texelFetch(gDepth, center, 0).r;
+    float centerAO = texelFetch(ssaoInput, center, 0).r;
+
+    // Background has nothing to blur against
+    if (isBackground(centerDepth)) {
+        fragBlurred = centerAO;
+        return;
+    }
+
+    float centerZ = linearizeDepth(centerDepth, push.projInfo);
+    vec3 centerNormal = decodeNormal(texelFetch(gNormal, center, 0).xy);
+    float depthScale = 1.0 / (push.depthSigma * centerZ + 1e-4);
+    float spatialSigma = max(float(push.radius) * 0.5, 0.5);
+    float spatialScale = -0.5 / (spatialSigma * spatialSigma);
+    ivec2 stepDir = ivec2(push.direction);
+
+    float result = centerAO;
+    float totalWeight = 1.0;
+    for (int i = -push.radius; i <= push.radius; ++i) {
+        if (i == 0) {
+            continue;
+        }
+        ivec2 coord = clamp(center + stepDir * i, ivec2(0), size - 1);
+        float depth = texelFetch(gDepth, coord, 0).r;
+        if (isBackground(depth)) {
+            continue;
         }
+        float z = linearizeDepth(depth, push.projInfo);
+        vec3 normal = decodeNormal(texelFetch(gNormal, coord, 0).xy);
+
+        float w = exp(float(i * i) * spatialScale);
+        w *= exp(-abs(z - centerZ) * depthScale);
+        w *= pow(max(dot(normal, centerNormal), 0.0), NORMAL_POWER);
+
+        result += texelFetch(ssaoInput, coord, 0).r * w;
+        totalWeight += w;
     }
-    
-    fragBlurred = result / 16.0;  // Average of 16 samples (4x4)
+
+    fragBlurred = result / totalWeight;
 }
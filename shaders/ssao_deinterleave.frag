@@ -0,0 +1,32 @@
+#version 450
+
+// SSAO depth deinterleave shader
+// Splits the AO-resolution depth into DEINTERLEAVE x DEINTERLEAVE layers
+// packed as tiles of one atlas: layer (i, j) holds every source texel whose
+// coordinate is (i, j) modulo DEINTERLEAVE, i.e. every pixel that uses the
+// same noise texel in ssao.frag.
+
+layout(location = 0) out float fragDepth;
+
+layout(set = 0, binding = 0) uniform sampler2D gDepth; // AO resolution
+
+layout(push_constant) uniform DeinterleaveParams {
+    ivec2 tileSize;  // one layer
+} params;
+
+// Must match FrgSSAO::DEINTERLEAVE
+const int DEINTERLEAVE = 4;
+
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 layer = coord / params.tileSize;
+    ivec2 local = coord - layer * params.tileSize;
+    ivec2 source = local * DEINTERLEAVE + layer;
+
+    // Padding texels (AO extent not a multiple of DEINTERLEAVE) are background
+    if (any(greaterThanEqual(source, textureSize(gDepth, 0)))) {
+        fragDepth = 1.0;
+        return;
+    }
+    fragDepth = texelFetch(gDepth, source, 0).r;
+}
@@ -0,0 +1,101 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
+
+// Deinterleaved SSAO shader
+// Same estimator as ssao.frag, run over the deinterleaved depth atlas. Every
+// pixel of a layer shares one noise rotation and samples only its own layer,
+// so neighbouring fragments fetch neighbouring texels and stay in cache. The
+// result is written in atlas layout; ssao_reinterleave.frag restores it.
+
+layout(location = 0) out float fragOcclusion;
+
+// Depth atlas (see ssao_deinterleave.frag) and AO-resolution normals
+layout(set = 0, binding = 0) uniform sampler2D depthAtlas;
+layout(set = 0, binding = 1) uniform sampler2D gNormal;
+
+// Noise texture (4x4, one texel per layer)
+layout(set = 0, binding = 2) uniform sampler2D texNoise;
+
+// Sample kernel (64 samples)
+layout(set = 0, binding = 3) uniform KernelUBO {
+    vec4 samples[64];
+} kernel;
+
+// Same push constants as ssao.frag (noiseScale is unused here)
+layout(push_constant) uniform SSAOParams {
+    mat4 projection;
+    vec2 noiseScale;
+    float radius;
+    float bias;
+    int kernelSize;    // samples evaluated this frame
+    int sampleOffset;  // first kernel index (temporal slice)
+    int sampleStride;  // kernel index step (1 = contiguous)
+    int adaptive;      // per-pixel sample count from the importance map
+} params;
+
+// Sample count per FrgSSAO::ADAPTIVE_TILE block (adaptive mode only)
+layout(set = 0, binding = 4) uniform sampler2D importanceMap;
+const int ADAPTIVE_TILE = 4;
+
+// Must match FrgSSAO::DEINTERLEAVE (== NOISE_SIZE)
+const int DEINTERLEAVE = 4;
+
+void main() {
+    ivec2 atlasCoord = ivec2(gl_FragCoord.xy);
+    ivec2 tileSize = textureSize(depthAtlas, 0) / DEINTERLEAVE;
+    ivec2 layer = atlasCoord / tileSize;
+    ivec2 tileOrigin = layer * tileSize;
+
+    // Pixel of the AO target this atlas texel stands for
+    ivec2 aoSize = textureSize(gNormal, 0);
+    ivec2 source = (atlasCoord - tileOrigin) * DEINTERLEAVE + layer;
+
+    float depth = texelFetch(depthAtlas, atlasCoord, 0).r;
+    if (isBackground(depth) || any(greaterThanEqual(source, aoSize))) {
+        fragOcclusion = 1.0;
+        return;
+    }
+
+    vec4 projInfo = projectionInfo(params.projection);
+    vec2 uv = (vec2(source) + 0.5) / vec2(aoSize);
+    vec3 fragPos = reconstructViewPos(uv, depth, projInfo);
+    vec3 normal = decodeNormal(texelFetch(gNormal, source, 0).xy);
+
+    // Constant rotation per layer: the noise texel ssao.frag would pick
+    vec3 randomVec = normalize(texelFetch(texNoise, layer, 0).xyz);
+
+    vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 TBN = mat3(tangent, bitangent, normal);
+
+    int sampleCount = params.kernelSize;
+    if (params.adaptive != 0) {
+        sampleCount = clamp(int(texelFetch(importanceMap, source / ADAPTIVE_TILE, 0).r),
+                            1, params.kernelSize);
+    }
+
+    float occlusion = 0.0;
+
+    for (int k = 0; k < sampleCount; ++k) {
+        int i = params.sampleOffset +
+                (k * params.kernelSize / sampleCount) * params.sampleStride;
+        vec3 samplePos = fragPos + TBN * kernel.samples[i].xyz * params.radius;
+
+        vec4 offset = params.projection * vec4(samplePos, 1.0);
+        offset.xy = (offset.xy / offset.w) * 0.5 + 0.5;
+
+        // Nearest texel of this pixel's layer
+        vec2 layerPos = (offset.xy * vec2(aoSize) - 0.5 - vec2(layer)) /
+                        float(DEINTERLEAVE);
+        ivec2 local = clamp(ivec2(round(layerPos)), ivec2(0), tileSize - 1);
+        float sampleDepth = linearizeDepth(
+            texelFetch(depthAtlas, tileOrigin + local, 0).r, projInfo);
+
+        float rangeCheck = smoothstep(0.0, 1.0, params.radius / abs(fragPos.z - sampleDepth));
+        occlusion += (sampleDepth <= samplePos.z - params.bias ? 1.0 : 0.0) * rangeCheck;
+    }
+
+    fragOcclusion = 1.0 - (occlusion / float(sampleCount));
+}
@@ -0,0 +1,44 @@
+#version 450
+
+// SSAO downsample shader
+// Reduces the G-buffer depth/normal to the AO resolution. Each low-res
+// texel keeps one real G-buffer sample (the closest valid one in its block)
+// instead of an average, so depth discontinuities are not smeared. Both
+// outputs keep the G-buffer encoding (hardware depth, octahedral normal).
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out float lowDepth;
+layout(location = 1) out vec2 lowNormal;
+
+layout(set = 0, binding = 0) uniform sampler2D gDepth;
+layout(set = 0, binding = 1) uniform sampler2D gNormal;
+
+layout(push_constant) uniform DownsampleParams {
+    int factor;  // resolution divisor (2 = half, 4 = quarter)
+} params;
+
+void main() {
+    ivec2 fullSize = textureSize(gDepth, 0);
+    ivec2 base = ivec2(gl_FragCoord.xy) * params.factor;
+
+    // Depth 1.0 marks background (cleared G-buffer)
+    float bestDepth = 1.0;
+    vec2 bestNormal = vec2(0.0);
+
+    for (int y = 0; y < params.factor; ++y) {
+        for (int x = 0; x < params.factor; ++x) {
+            ivec2 coord = min(base + ivec2(x, y), fullSize - 1);
+            float depth = texelFetch(gDepth, coord, 0).r;
+
+            // Hardware depth is monotonic in view z: smaller is closer
+            if (depth < bestDepth) {
+                bestDepth = depth;
+                bestNormal = texelFetch(gNormal, coord, 0).xy;
+            }
+        }
+    }
+
+    lowDepth = bestDepth;
+    lowNormal = bestNormal;
+}
@@ -0,0 +1,23 @@
+#version 450
+
+// SSAO reinterleave shader
+// Gathers the per-layer AO atlas back into the regular AO target layout, so
+// the blur sees the same input as after ssao.frag.
+
+layout(location = 0) out float fragOcclusion;
+
+layout(set = 0, binding = 0) uniform sampler2D aoAtlas;
+
+layout(push_constant) uniform DeinterleaveParams {
+    ivec2 tileSize;  // one layer
+} params;
+
+// Must match FrgSSAO::DEINTERLEAVE
+const int DEINTERLEAVE = 4;
+
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 layer = coord % DEINTERLEAVE;
+    ivec2 local = coord / DEINTERLEAVE;
+    fragOcclusion = texelFetch(aoAtlas, layer * params.tileSize + local, 0).r;
+}
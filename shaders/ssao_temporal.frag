@@ -0,0 +1,57 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
+
+// SSAO temporal accumulation shader
+// Blends this frame's partial SSAO (one slice of the kernel) into the history
+// reprojected from the previous frame. History is rejected when the pixel was
+// off-screen or its stored view depth does not match (disocclusion), in which
+// case the current estimate is used as is.
+//
+// Output: r = accumulated AO, g = linear view depth (for next frame's test)
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 0) out vec2 fragHistory;
+
+layout(set = 0, binding = 0) uniform sampler2D ssaoInput;
+layout(set = 0, binding = 1) uniform sampler2D gDepth;
+layout(set = 0, binding = 2) uniform sampler2D history;
+
+layout(push_constant) uniform TemporalParams {
+    mat4 reprojection;  // current view space -> previous clip space
+    vec4 projInfo;
+    float blend;        // weight of the current frame
+    float depthTolerance;
+    int historyValid;
+} params;
+
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, coord, 0).r;
+
+    // Background: no occlusion, depth 0 never matches a surface
+    if (isBackground(depth)) {
+        fragHistory = vec2(1.0, 0.0);
+        return;
+    }
+
+    vec3 viewPos = reconstructViewPos(fragTexCoord, depth, params.projInfo);
+    float ao = texelFetch(ssaoInput, coord, 0).r;
+
+    vec4 prevClip = params.reprojection * vec4(viewPos, 1.0);
+    vec2 prevUV = (prevClip.xy / prevClip.w) * 0.5 + 0.5;
+    float prevZ = prevClip.w;
+
+    float result = ao;
+    if (params.historyValid != 0 && prevClip.w > 0.0 &&
+        all(greaterThanEqual(prevUV, vec2(0.0))) &&
+        all(lessThanEqual(prevUV, vec2(1.0)))) {
+        vec2 prev = texture(history, prevUV).rg;
+        if (abs(prev.g - prevZ) < params.depthTolerance * prevZ) {
+            result = mix(prev.r, ao, params.blend);
+        }
+    }
+
+    fragHistory = vec2(result, viewPos.z);
+}
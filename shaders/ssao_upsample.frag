@@ -0,0 +1,86 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
+
+// SSAO bilateral upsample shader
+// Reconstructs full-resolution AO from the low-res blurred result. The four
+// nearest low-res texels are weighted bilinearly, then by how closely their
+// depth and normal match the full-res pixel, so occlusion does not bleed
+// across silhouettes.
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 0) out float fragOcclusion;
+
+layout(set = 0, binding = 0) uniform sampler2D aoLow;
+layout(set = 0, binding = 1) uniform sampler2D lowDepth;
+layout(set = 0, binding = 2) uniform sampler2D lowNormal;
+layout(set = 0, binding = 3) uniform sampler2D gDepth;
+layout(set = 0, binding = 4) uniform sampler2D gNormal;
+
+layout(push_constant) uniform UpsampleParams {
+    vec4 projInfo;
+} params;
+
+// Relative depth difference at which a sample's weight halves
+const float DEPTH_SIGMA = 0.05;
+// Exponent sharpening the normal similarity term
+const float NORMAL_POWER = 8.0;
+
+void main() {
+    ivec2 fullCoord = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, fullCoord, 0).r;
+
+    // Background: nothing to occlude
+    if (isBackground(depth)) {
+        fragOcclusion = 1.0;
+        return;
+    }
+
+    float z = linearizeDepth(depth, params.projInfo);
+    vec3 normal = decodeNormal(texelFetch(gNormal, fullCoord, 0).xy);
+
+    ivec2 lowSize = textureSize(aoLow, 0);
+    vec2 lowCoord = fragTexCoord * vec2(lowSize) - 0.5;
+    ivec2 base = ivec2(floor(lowCoord));
+    vec2 f = fract(lowCoord);
+
+    float totalWeight = 0.0;
+    float result = 0.0;
+
+    // Fallback: the low-res texel whose depth is closest
+    float nearestAO = 1.0;
+    float nearestDelta = 1e30;
+
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            ivec2 coord = clamp(base + ivec2(x, y), ivec2(0), lowSize - 1);
+            float lowD = texelFetch(lowDepth, coord, 0).r;
+            float ao = texelFetch(aoLow, coord, 0).r;
+
+            if (isBackground(lowD)) {
+                continue;
+            }
+
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) *
+                             (y == 0 ? 1.0 - f.y : f.y);
+
+            float delta = abs(z - linearizeDepth(lowD, params.projInfo));
+            float depthWeight = 1.0 / (1.0 + delta / (DEPTH_SIGMA * z));
+
+            vec3 lowN = decodeNormal(texelFetch(lowNormal, coord, 0).xy);
+            float normalWeight = pow(max(dot(normal, lowN), 0.0), NORMAL_POWER);
+
+            float weight = bilinear * depthWeight * normalWeight;
+            result += ao * weight;
+            totalWeight += weight;
+
+            if (delta < nearestDelta) {
+                nearestDelta = delta;
+                nearestAO = ao;
+            }
+        }
+    }
+
+    fragOcclusion = totalWeight > 1e-4 ? result / totalWeight : nearestAO;
+}
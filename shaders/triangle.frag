@@ -1,8 +1,10 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(set = 0, binding = 0) uniform sampler tex_sampler;
-layout(set = 0, binding = 1) uniform texture2D textures[255];
-layout(set = 0, binding = 2) uniform sampler2D ssaoTexture;
+layout(set = 1, binding = 0) uniform sampler2D ssaoTexture;
+// Bindless table, sized at runtime (see FrgDescriptor)
+layout(set = 0, binding = 2) uniform texture2D textures[];
 
 layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec2 frag_tex_coord;
@@ -11,6 +13,13 @@ layout(location = 3) in mat3 TBN;
 
 layout(location = 0) out vec4 outColor;
 
+// Variant constants, set per pipeline by SimpleRenderSystem. The driver folds
+// them, so each variant only contains the work its material needs.
+layout(constant_id = 0) const int TEXTURE_COUNT = 1; // 0 = untextured
+layout(constant_id = 1) const bool NORMAL_MAP = false;
+layout(constant_id = 2) const bool USE_SSAO = true;
+layout(constant_id = 3) const int DEBUG_MODE = 0; // 0=normal, 1=SSAO only, 2=normals, 3=depth
+
 // Push constants - MUST match triangle.vert exactly!
 layout(push_constant) uniform Push {
     mat4 transform; // transform is actually projection * view * model
@@ -20,8 +29,6 @@ layout(push_constant) uniform Push {
     vec4 pointLightColor; // w component is intensity
     vec2 screenSize;      // Actual screen size for SSAO UV calculation
     int texture_idx;
-    int flags;
-    int debugMode;        // 0=normal, 1=SSAO only, 2=normals, 3=depth
 }
 push;
 
@@ -40,66 +47,54 @@ vec3 calculatePointLight(vec3 lightPos, vec3 lightColor, float intensity,
 }
 
 void main() {
-    // ---------------------------------------------------------
-    // 1. SETUP & NORMAL MAPPING (From 'bigaron')
-    // ---------------------------------------------------------
-    // Sample texture
-  vec3 texColor = vec3(1.0, 1.0, 1.0);
+  // ---------------------------------------------------------
+  // 1. NORMAL MAPPING
+  // ---------------------------------------------------------
   vec3 normal = fragNormal;
-  int num_textures = int(push.flags / 10) % 10;
-  bool has_normal = (push.flags % 10) > 0;
-  if(num_textures > 0){
-      //texColor = vec3(1.0, 0.0, 0.0);
-      texColor = texture(sampler2D(textures[push.texture_idx], tex_sampler), frag_tex_coord).rgb;
-  }
-  if(has_normal){
-      vec3 normal_tex = texture(sampler2D(textures[push.texture_idx + 1], tex_sampler), frag_tex_coord).rgb;
-      normal = normalize(normal_tex * 2.0 - 1.0);
-      normal = normalize(TBN * normal);
+  if (NORMAL_MAP) {
+    vec3 normal_tex = texture(sampler2D(textures[push.texture_idx + 1], tex_sampler), frag_tex_coord).rgb;
+    normal = normalize(normal_tex * 2.0 - 1.0);
+    normal = normalize(TBN * normal);
   }
-  
+
   // ---------------------------------------------------------
-  // 2. SSAO SAMPLING (From 'ali')
+  // 2. SSAO SAMPLING
   // ---------------------------------------------------------
-  // Calculate screen UV for SSAO sampling
   // Both G-buffer and swap chain use Vulkan's coordinate system (Y=0 at top)
   // so no flip is needed
-  vec2 screenUV = gl_FragCoord.xy / push.screenSize;
-  
-  // Sample SSAO
-  float ao = texture(ssaoTexture, screenUV).r;
-  ao = clamp(ao, 0.0, 1.0);
-  if (ao < 0.001) {
-    ao = 1.0;
+  float ao = 1.0;
+  if (USE_SSAO) {
+    vec2 screenUV = gl_FragCoord.xy / push.screenSize;
+    ao = clamp(texture(ssaoTexture, screenUV).r, 0.0, 1.0);
+    if (ao < 0.001) {
+      ao = 1.0;
+    }
   }
 
   // ---------------------------------------------------------
-  // 3. DEBUG MODES (From 'ali')
+  // 3. DEBUG MODES
   // ---------------------------------------------------------
-  if (push.debugMode == 1) {
+  if (DEBUG_MODE == 1) {
     // Mode 1: Show raw SSAO (white = no occlusion, black = full occlusion)
     outColor = vec4(vec3(ao), 1.0);
     return;
   }
-  else if (push.debugMode == 2) {
+  if (DEBUG_MODE == 2) {
     // Mode 2: Show normals as colors (remap from [-1,1] to [0,1])
-    vec3 normalColor = normal * 0.5 + 0.5;
-    outColor = vec4(normalColor, 1.0);
+    outColor = vec4(normal * 0.5 + 0.5, 1.0);
     return;
   }
-  else if (push.debugMode == 3) {
+  if (DEBUG_MODE == 3) {
     // Mode 3: Show depth visualization
-    float depth = gl_FragCoord.z;
-    outColor = vec4(vec3(depth), 1.0);
+    outColor = vec4(vec3(gl_FragCoord.z), 1.0);
     return;
   }
-  
+
   // ---------------------------------------------------------
   // 4. FINAL RENDERING
   // ---------------------------------------------------------
-  // Mode 0: Normal rendering with SSAO
-  // Sample texture
-  if(num_textures > 0){
+  vec3 texColor = vec3(1.0);
+  if (TEXTURE_COUNT > 0) {
     texColor = texture(sampler2D(textures[push.texture_idx], tex_sampler), frag_tex_coord).rgb;
   }
 
@@ -115,4 +110,4 @@ void main() {
   // Apply lighting to texture
   vec3 finalColor = texColor * lighting;
   outColor = vec4(finalColor, 1.0);
-}
\ No newline at end of file
+}
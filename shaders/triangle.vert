@@ -19,11 +19,12 @@ layout(push_constant) uniform Push {
     vec4 pointLightColor; // w component is intensity
     vec2 screenSize;      // Actual screen size for SSAO UV calculation
     int texture_idx;
-    int flags;
-    int debugMode;        // 0=normal, 1=SSAO only, 2=normals, 3=depth
 }
 push;
 
+// Must match gbuffer.vert so the depth-EQUAL pass sees identical depth
+invariant gl_Position;
+
 void main() {
   gl_Position = push.transform * vec4(position, 1.0);
   fragNormal = normalize(mat3(push.normalMat) * normal);
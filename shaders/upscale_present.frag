@@ -0,0 +1,12 @@
+#version 450
+
+// Copies the upscaled output (resolve history) into the swap chain image
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D upscaled;
+
+void main() {
+    outColor = vec4(texture(upscaled, fragTexCoord).rgb, 1.0);
+}
@@ -0,0 +1,85 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "gbuffer_common.glsl"
+
+// Temporal upscale resolve
+// Runs at the output resolution. The scene was rendered at the internal
+// resolution with a sub-pixel jitter that changes every frame; this pass
+// reprojects the previous output with the G-buffer depth and blends this
+// frame's samples into it. The history is clamped to the color range of the
+// current 3x3 neighborhood, so disoccluded or changed pixels do not ghost.
+//
+// Motion is taken from the closest depth in the neighborhood, which keeps
+// foreground edges moving with the foreground. Background pixels reproject
+// their view direction (w = 0), so only the camera rotation moves them.
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor; // internal res
+layout(set = 0, binding = 1) uniform sampler2D gDepth;     // internal res
+layout(set = 0, binding = 2) uniform sampler2D history;    // output res
+
+layout(push_constant) uniform ResolveParams {
+    mat4 reprojection;  // current view space -> previous clip space
+    vec4 projInfo;      // unjittered projection terms
+    vec2 jitter;        // NDC offset the scene was rendered with
+    float blend;        // weight of the current frame
+    int historyValid;
+} params;
+
+void main() {
+    // The jittered render shows this output pixel shifted by the jitter
+    vec2 jitterUV = params.jitter * 0.5;
+    vec2 sceneUV = fragTexCoord + jitterUV;
+    ivec2 sceneSize = textureSize(sceneColor, 0);
+    ivec2 center = clamp(ivec2(sceneUV * vec2(sceneSize)), ivec2(0),
+                         sceneSize - 1);
+
+    vec3 current = texture(sceneColor, sceneUV).rgb;
+    vec3 minColor = current;
+    vec3 maxColor = current;
+    float closestDepth = 1.0;
+    ivec2 closest = center;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            ivec2 coord = clamp(center + ivec2(x, y), ivec2(0), sceneSize - 1);
+            vec3 color = texelFetch(sceneColor, coord, 0).rgb;
+            minColor = min(minColor, color);
+            maxColor = max(maxColor, color);
+
+            float depth = texelFetch(gDepth, coord, 0).r;
+            if (depth < closestDepth) {
+                closestDepth = depth;
+                closest = coord;
+            }
+        }
+    }
+
+    // Unjittered screen position of the closest sample and where it was last
+    // frame
+    vec2 closestUV = (vec2(closest) + 0.5) / vec2(sceneSize) - jitterUV;
+    vec4 viewPoint;
+    if (isBackground(closestDepth)) {
+        vec2 ndc = closestUV * 2.0 - 1.0;
+        viewPoint = vec4(ndc.x / params.projInfo.x, ndc.y / params.projInfo.y,
+                         1.0, 0.0);
+    } else {
+        viewPoint = vec4(reconstructViewPos(closestUV, closestDepth,
+                                            params.projInfo), 1.0);
+    }
+    vec4 prevClip = params.reprojection * viewPoint;
+    vec2 motion = closestUV - ((prevClip.xy / prevClip.w) * 0.5 + 0.5);
+    vec2 prevUV = fragTexCoord - motion;
+
+    vec3 result = current;
+    if (params.historyValid != 0 && prevClip.w > 0.0 &&
+        all(greaterThanEqual(prevUV, vec2(0.0))) &&
+        all(lessThanEqual(prevUV, vec2(1.0)))) {
+        vec3 previous = clamp(texture(history, prevUV).rgb, minColor, maxColor);
+        result = mix(previous, current, params.blend);
+    }
+
+    outColor = vec4(result, 1.0);
+}
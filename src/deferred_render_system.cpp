@@ -0,0 +1,328 @@
+#include "deferred_render_system.hpp"
+
+#include "frg_model.hpp"
+#include "frg_swap_chain.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace frg {
+
+DeferredRenderSystem::DeferredRenderSystem(FrgDevice &device,
+                                           FrgGBuffer &gbuffer, FrgSSAO &ssao,
+                                           FrgDescriptor &descriptor,
+                                           LightManager &lightManager,
+                                           VkRenderPass swapChainRenderPass)
+    : frgDevice{device}, gbuffer{gbuffer}, ssao{ssao},
+      frgDescriptor{descriptor}, lightManager{lightManager} {
+  createDescriptorSetLayout();
+  createUniformBuffers();
+  createGBufferPipelineLayout();
+  createGBufferPipelines();
+  createLightingPipelineLayout();
+  createLightingPipeline(swapChainRenderPass);
+}
+
+DeferredRenderSystem::~DeferredRenderSystem() {
+  // Background builds may still reference the layouts destroyed below
+  frgDevice.pipelineCompiler().waitIdle();
+  VkDevice dev = frgDevice.device();
+
+  if (lightingPipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, lightingPipelineLayout, nullptr);
+  }
+  if (gbufferPipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, gbufferPipelineLayout, nullptr);
+  }
+  for (size_t i = 0; i < lightBuffers.size(); ++i) {
+    vkDestroyBuffer(dev, lightBuffers[i], nullptr);
+    vkFreeMemory(dev, lightBuffersMemory[i], nullptr);
+  }
+  if (lightingDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, lightingDescriptorSetLayout, nullptr);
+  }
+}
+
+void DeferredRenderSystem::createDescriptorSetLayout() {
+  // Lighting descriptor set layout
+  // Binding 0: gDepth      (sampler2D, view position is reconstructed)
+  // Binding 1: gNormal     (sampler2D)
+  // Binding 2: gAlbedo     (sampler2D)
+  // Binding 3: ssaoTexture (sampler2D)
+  // Binding 4: lights      (uniform buffer)
+  std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+  for (uint32_t i = 0; i < 4; ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  }
+
+  bindings[4].binding = 4;
+  bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  bindings[4].descriptorCount = 1;
+  bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                  &lightingDescriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create deferred lighting descriptor set layout!");
+  }
+}
+
+void DeferredRenderSystem::createUniformBuffers() {
+  VkDeviceSize bufferSize = sizeof(LightData);
+
+  lightBuffers.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+  lightBuffersMemory.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+  lightBuffersMapped.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < lightBuffers.size(); ++i) {
+    frgDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           lightBuffers[i], lightBuffersMemory[i]);
+    vkMapMemory(frgDevice.device(), lightBuffersMemory[i], 0, bufferSize, 0,
+                &lightBuffersMapped[i]);
+  }
+}
+
+void DeferredRenderSystem::createGBufferPipelineLayout() {
+  // Same interface as the forward pipeline so FrgModel::draw can push the
+  // per-mesh texture index
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags =
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(SimplePushConstantData);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = frgDescriptor.descriptorSetCount();
+  layoutInfo.pSetLayouts = frgDescriptor.descriptorSetLayout();
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &gbufferPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create deferred G-buffer pipeline layout!");
+  }
+}
+
+bool DeferredRenderSystem::isReady() const {
+  for (const auto &pipeline : gbufferPipelines) {
+    if (!pipeline->isReady()) {
+      return false;
+    }
+  }
+  return lightingPipeline->isReady();
+}
+
+void DeferredRenderSystem::createGBufferPipelines() {
+  assert(gbufferPipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  for (uint32_t material = 0; material < MESH_MATERIAL_COUNT; material++) {
+    gbufferPipelines[material] =
+        createGBufferPipeline(static_cast<MeshMaterial>(material));
+  }
+}
+
+std::unique_ptr<FrgPipeline>
+DeferredRenderSystem::createGBufferPipeline(MeshMaterial material) {
+  // Matches the constant_ids in gbuffer_deferred.frag
+  struct SpecializationData {
+    int32_t textureCount;
+    VkBool32 normalMap;
+  } data{};
+  data.textureCount = material == MeshMaterial::Untextured ? 0 : 1;
+  data.normalMap =
+      material == MeshMaterial::DiffuseNormal ? VK_TRUE : VK_FALSE;
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Normal + albedo
+  pipelineConfig.colorBlendAttachments.resize(2);
+  pipelineConfig.colorBlendAttachments[0].colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  pipelineConfig.colorBlendAttachments[0].blendEnable = VK_FALSE;
+  pipelineConfig.colorBlendAttachments[1] =
+      pipelineConfig.colorBlendAttachments[0];
+
+  pipelineConfig.colorBlendInfo.attachmentCount = 2;
+  pipelineConfig.colorBlendInfo.pAttachments =
+      pipelineConfig.colorBlendAttachments.data();
+
+  FrgPipeline::setRenderTarget(pipelineConfig, gbuffer.getTarget());
+  pipelineConfig.pipelineLayout = gbufferPipelineLayout;
+  pipelineConfig.fragmentSpecializationEntries = {
+      {0, offsetof(SpecializationData, textureCount), sizeof(int32_t)},
+      {1, offsetof(SpecializationData, normalMap), sizeof(VkBool32)},
+  };
+  auto bytes = reinterpret_cast<const uint8_t *>(&data);
+  pipelineConfig.fragmentSpecializationData.assign(bytes, bytes + sizeof(data));
+
+  return std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/gbuffer_deferred.vert.spv",
+      "shaders/gbuffer_deferred.frag.spv", pipelineConfig);
+}
+
+void DeferredRenderSystem::createLightingPipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(LightingPushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &lightingDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &lightingPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create deferred lighting pipeline layout!");
+  }
+}
+
+void DeferredRenderSystem::createLightingPipeline(
+    VkRenderPass swapChainRenderPass) {
+  assert(lightingPipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen triangle - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // The triangle sits on the far plane: it passes only where the G-buffer
+  // depth holds geometry, so background pixels are never shaded
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_TRUE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER;
+
+  pipelineConfig.renderPass = swapChainRenderPass;
+  pipelineConfig.pipelineLayout = lightingPipelineLayout;
+
+  lightingPipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/deferred_lighting.vert.spv",
+      "shaders/deferred_lighting.frag.spv", pipelineConfig);
+}
+
+void DeferredRenderSystem::renderGBuffer(
+    VkCommandBuffer commandBuffer, std::vector<FrgGameObject> &gameObjects,
+    const FrgCamera &camera) {
+  renderGBuffer(commandBuffer, gameObjects, 0, gameObjects.size(), camera);
+}
+
+void DeferredRenderSystem::renderGBuffer(
+    VkCommandBuffer commandBuffer, std::vector<FrgGameObject> &gameObjects,
+    size_t begin, size_t end, const FrgCamera &camera) {
+  // Consecutive meshes often share a material; keep their pipeline bound
+  FrgPipeline *bound = nullptr;
+  auto bindMaterial = [&](MeshMaterial material) {
+    FrgPipeline *pipeline =
+        gbufferPipelines[static_cast<uint32_t>(material)].get();
+    if (pipeline != bound) {
+      pipeline->bind(commandBuffer);
+      bound = pipeline;
+    }
+  };
+
+  // Every variant shares the layout, so the sets stay bound across switches
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          gbufferPipelineLayout, 0,
+                          frgDescriptor.descriptorSetCount(),
+                          frgDescriptor.descriptorSet(), 0, nullptr);
+
+  auto projectionView = camera.getProjectionMatrix() * camera.getViewMatrix();
+
+  for (size_t i = begin; i < end; i++) {
+    auto &gameObject = gameObjects[i];
+    // modelMatrix/normalMat carry view-space transforms here
+    SimplePushConstantData push{};
+    auto modelMat = gameObject.transform.mat4();
+    push.transform = projectionView * modelMat;
+    push.modelMatrix = camera.getViewMatrix() * modelMat;
+    push.normalMat = glm::transpose(glm::inverse(push.modelMatrix));
+
+    gameObject.model->draw(commandBuffer, gbufferPipelineLayout, push,
+                           bindMaterial);
+  }
+}
+
+void DeferredRenderSystem::renderLighting(VkCommandBuffer commandBuffer,
+                                          int frameIndex,
+                                          const FrgCamera &camera,
+                                          int debugMode) {
+  // Move the light list into view space to match the G-buffer
+  LightData lightData = lightManager.getLightData();
+  for (uint32_t i = 0; i < lightData.pointLightCount; ++i) {
+    glm::vec3 worldPos = glm::vec3(lightData.pointLights[i].position);
+    lightData.pointLights[i].position =
+        camera.getViewMatrix() * glm::vec4(worldPos, 1.0f);
+  }
+  std::memcpy(lightBuffersMapped[frameIndex], &lightData, sizeof(LightData));
+
+  lightingPipeline->bind(commandBuffer);
+
+  // A transient set picks up whatever G-buffer and SSAO views are current
+  std::array<VkDescriptorImageInfo, 4> imageInfos = {
+      gbuffer.getDepthDescriptor(), gbuffer.getNormalDescriptor(),
+      gbuffer.getAlbedoDescriptor(), ssao.getBlurredDescriptor()};
+  VkDescriptorBufferInfo lightInfo{};
+  lightInfo.buffer = lightBuffers[frameIndex];
+  lightInfo.offset = 0;
+  lightInfo.range = sizeof(LightData);
+
+  std::vector<VkWriteDescriptorSet> writes(5);
+  for (uint32_t i = 0; i < 4; ++i) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstBinding = i;
+    writes[i].dstArrayElement = 0;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[i].descriptorCount = 1;
+    writes[i].pImageInfo = &imageInfos[i];
+  }
+
+  writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writes[4].dstBinding = 4;
+  writes[4].dstArrayElement = 0;
+  writes[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  writes[4].descriptorCount = 1;
+  writes[4].pBufferInfo = &lightInfo;
+
+  VkDescriptorSet lightingSet = frgDevice.descriptorAllocator().getTransient(
+      lightingDescriptorSetLayout, writes);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          lightingPipelineLayout, 0, 1, &lightingSet, 0,
+                          nullptr);
+
+  LightingPushConstants push{};
+  push.projection = camera.getProjectionMatrix();
+  push.debugMode = debugMode;
+
+  vkCmdPushConstants(commandBuffer, lightingPipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(LightingPushConstants), &push);
+
+  // Draw fullscreen triangle (3 vertices, no vertex buffer)
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+} // namespace frg
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "frg_camera.hpp"
+#include "frg_descriptor.hpp"
+#include "frg_device.hpp"
+#include "frg_game_object.hpp"
+#include "frg_gbuffer.hpp"
+#include "frg_lighting.hpp"
+#include "frg_model.hpp"
+#include "frg_pipeline.hpp"
+#include "frg_ssao.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Deferred Render System
+ *
+ * Alternative to the forward SimpleRenderSystem path:
+ * - G-buffer pass writes depth, mapped normal and albedo (rasterized once)
+ * - Lighting pass shades every covered pixel with a fullscreen triangle that
+ *   reads the G-buffer, the blurred SSAO and the light list
+ *
+ * The lighting pass runs inside the swap chain pass that loaded the G-buffer
+ * depth, so background pixels are rejected by the depth test. That pass keeps
+ * the depth read-only, which lets the lighting shader sample it at the same
+ * time to reconstruct view-space position.
+ */
+class DeferredRenderSystem {
+public:
+  // Push constants for the lighting pass
+  struct LightingPushConstants {
+    glm::mat4 projection;
+    int debugMode;
+  };
+
+  DeferredRenderSystem(FrgDevice &device, FrgGBuffer &gbuffer, FrgSSAO &ssao,
+                       FrgDescriptor &descriptor, LightManager &lightManager,
+                       VkRenderPass swapChainRenderPass);
+  ~DeferredRenderSystem();
+
+  DeferredRenderSystem(const DeferredRenderSystem &) = delete;
+  DeferredRenderSystem &operator=(const DeferredRenderSystem &) = delete;
+
+  // Call between SSAORenderSystem::beginGBufferPass/endGBufferPass
+  void renderGBuffer(VkCommandBuffer commandBuffer,
+                     std::vector<FrgGameObject> &gameObjects,
+                     const FrgCamera &camera);
+  // Records gameObjects [begin, end); safe to call from several threads
+  void renderGBuffer(VkCommandBuffer commandBuffer,
+                     std::vector<FrgGameObject> &gameObjects, size_t begin,
+                     size_t end, const FrgCamera &camera);
+
+  // Whether every pipeline finished building in the background
+  bool isReady() const;
+
+  // Call inside a swap chain pass that reuses the G-buffer depth
+  void renderLighting(VkCommandBuffer commandBuffer, int frameIndex,
+                      const FrgCamera &camera, int debugMode);
+
+private:
+  void createDescriptorSetLayout();
+  void createUniformBuffers();
+  void createGBufferPipelineLayout();
+  // One G-buffer pipeline per MeshMaterial, like SimpleRenderSystem
+  void createGBufferPipelines();
+  std::unique_ptr<FrgPipeline> createGBufferPipeline(MeshMaterial material);
+  void createLightingPipelineLayout();
+  void createLightingPipeline(VkRenderPass swapChainRenderPass);
+
+  FrgDevice &frgDevice;
+  FrgGBuffer &gbuffer;
+  FrgSSAO &ssao;
+  FrgDescriptor &frgDescriptor;
+  LightManager &lightManager;
+
+  // Lighting descriptors, a transient set per frame (see renderLighting)
+  VkDescriptorSetLayout lightingDescriptorSetLayout = VK_NULL_HANDLE;
+
+  // Light list in view space, uploaded every frame
+  std::vector<VkBuffer> lightBuffers;
+  std::vector<VkDeviceMemory> lightBuffersMemory;
+  std::vector<void *> lightBuffersMapped;
+
+  // G-buffer pipelines (use the material descriptor set)
+  VkPipelineLayout gbufferPipelineLayout = VK_NULL_HANDLE;
+  std::array<std::unique_ptr<FrgPipeline>, MESH_MATERIAL_COUNT>
+      gbufferPipelines;
+
+  // Lighting pipeline
+  VkPipelineLayout lightingPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> lightingPipeline;
+};
+
+} // namespace frg
@@ -2,8 +2,14 @@
 
 #include "camera_animation_system.hpp"
 #include "frg_camera.hpp"
+#include "frg_command_recorder.hpp"
+#include "frg_gpu_timer.hpp"
+#include "frg_quality_governor.hpp"
+#include "frg_render_graph.hpp"
+#include "frg_thread_pool.hpp"
 #include "keyboard_movement_controller.hpp"
 #include "simple_render_system.hpp"
+#include "upscale_render_system.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -12,6 +18,7 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <chrono>
@@ -23,42 +30,78 @@
 namespace frg {
 FirstApp::FirstApp() {
     loadGameObjects();
-    frgDescriptor.write_descriptor_sets(get_descriptors_of_game_objects());
+    frgRenderer.setPresentConfig(
+        {sceneSettings.framesInFlight, sceneSettings.presentMode, sceneSettings.swapChainImages}
+    );
+    for (auto &obj : gameObjects) {
+        obj.model->register_textures(frgDescriptor);
+    }
     computeCommandBuffers = frgDevice.createComputeCommandBuffers(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
 }
 
 FirstApp::~FirstApp() {
 }
 
-std::vector<VkDescriptorImageInfo> FirstApp::get_descriptors_of_game_objects() {
-    std::vector<VkDescriptorImageInfo> all_descriptor_infos{};
-    for (const auto &obj : gameObjects) {
-        std::vector<VkDescriptorImageInfo> tmp_infos = obj.model->get_descriptors();
-        all_descriptor_infos.insert(all_descriptor_infos.end(), tmp_infos.begin(), tmp_infos.end());
-    }
-
-    return all_descriptor_infos;
-}
-
 void FirstApp::run() {
-    // Get swap chain extent for G-buffer and SSAO - MUST match swap chain!
+    // Pipelines build in the background from here on (see FrgPipelineCompiler)
+    auto runStart = std::chrono::high_resolution_clock::now();
+
+    // Get swap chain extent for G-buffer and SSAO - MUST match swap chain
+    // unless temporal upscaling renders at a lower internal resolution
     VkExtent2D extent = frgRenderer.getSwapChainExtent();
     std::cout << "Swap chain extent: " << extent.width << "x" << extent.height << std::endl;
+    VkExtent2D renderExtent = extent;
+    if (sceneSettings.upscaleEnabled) {
+        renderExtent = UpscaleRenderSystem::scaledExtent(extent, sceneSettings.upscaleScale);
+        std::cout << "Temporal upscaling from " << renderExtent.width << "x" << renderExtent.height
+                  << std::endl;
+    }
+
+    // Vulkan 1.3 path: the G-buffer and SSAO passes render without render passes or framebuffers,
+    // and the render graph records synchronization2 barriers
+    bool dynamicRendering = sceneSettings.dynamicRendering && frgDevice.supportsDynamicRendering();
+    if (sceneSettings.dynamicRendering && !dynamicRendering) {
+        std::cout << "Dynamic rendering not supported, using render passes" << std::endl;
+    }
 
-    // Create G-buffer for deferred rendering (same size as swap chain)
-    FrgGBuffer gbuffer{frgDevice, extent};
+    // Create G-buffer for deferred rendering (internal render resolution)
+    FrgGBuffer gbuffer{frgDevice, renderExtent, dynamicRendering};
 
-    // Create SSAO system (same size as swap chain)
-    FrgSSAO ssao{frgDevice, extent};
+    // Create SSAO system (output matches the G-buffer; AO itself may run at
+    // half or quarter resolution)
+    FrgSSAO ssao{frgDevice, renderExtent, sceneSettings.ssaoResolutionDivisor, dynamicRendering};
 
     // Create SSAO render system (manages G-buffer, SSAO, and blur passes)
     SSAORenderSystem ssaoRenderSystem{frgDevice, gbuffer, ssao};
+    ssaoRenderSystem.setBlurRadius(sceneSettings.ssaoBlurRadius);
+    ssaoRenderSystem.setTemporalEnabled(sceneSettings.ssaoTemporal);
+    ssaoRenderSystem.setDeinterleaved(sceneSettings.ssaoDeinterleaved);
+    ssaoRenderSystem.setAdaptiveSampling(sceneSettings.ssaoAdaptive);
+
+    using AOMethod = SSAORenderSystem::AOMethod;
+    AOMethod aoMethod = sceneSettings.ssaoHorizon ? AOMethod::Horizon : AOMethod::Hemisphere;
+
+    // Let the final pass depth-test against the G-buffer depth instead of
+    // rasterizing into a freshly cleared depth buffer
+    frgRenderer.setSharedDepthView(gbuffer.getDepthImageView(), gbuffer.getExtent());
 
     // Create the main render system for final lighting
     SimpleRenderSystem simpleRenderSystem{frgDevice, frgRenderer.getSwapChainRenderPass(),
                                           frgDescriptor, lightManager};
     simpleRenderSystem.setup_ssbos(frgParticleDispenser);
+
+    // Deferred path: G-buffer with albedo + fullscreen lighting (toggle with 'G')
+    DeferredRenderSystem deferredRenderSystem{frgDevice, gbuffer, ssao, frgDescriptor, lightManager,
+                                              frgRenderer.getSwapChainRenderPass()};
     simpleRenderSystem.set_up_compute_desc_sets(frgParticleDispenser.particle_count() * sizeof(Particle));
+
+    // Scene into an internal-resolution target, resolved to the swap chain
+    std::unique_ptr<UpscaleRenderSystem> upscaleRenderSystem;
+    if (sceneSettings.upscaleEnabled) {
+        upscaleRenderSystem = std::make_unique<UpscaleRenderSystem>(
+            frgDevice, gbuffer, extent, frgRenderer.getSwapChainImageFormat(),
+            frgRenderer.getSwapChainRenderPass());
+    }
   
     FrgCamera camera{};
     // example camera setup - now loaded from scene if available
@@ -92,21 +135,136 @@ void FirstApp::run() {
     bool ssaoEnabled = sceneSettings.ssaoEnabled;
     bool oKeyWasPressed = false;
 
+    // SSAO resolution toggle (press 'H' to cycle full/half/quarter)
+    bool hKeyWasPressed = false;
+
+    // SSAO blur radius (press '[' / ']' to shrink / grow)
+    bool bracketKeyWasPressed = false;
+
+    // Fragment/compute SSAO toggle (press 'K')
+    bool computeSSAO = sceneSettings.ssaoCompute && ssao.supportsCompute();
+    bool kKeyWasPressed = false;
+
+    // Temporal SSAO accumulation toggle (press 'T', fragment path only)
+    bool tKeyWasPressed = false;
+
+    // Hemisphere/horizon-based AO toggle (press 'J', fragment path only)
+    bool jKeyWasPressed = false;
+
+    // Deinterleaved SSAO toggle (press 'I', fragment hemisphere only)
+    bool iKeyWasPressed = false;
+
+    // Adaptive SSAO sample count toggle (press 'V', fragment hemisphere only).
+    // The average samples spent per pixel is printed every few seconds.
+    bool vKeyWasPressed = false;
+    constexpr int SAMPLE_STATS_INTERVAL = 240;
+    double sampleStatsSum = 0.0;
+    int sampleStatsFrames = 0;
+
+    // GPU time of the SSAO passes per path (0 = fragment hemisphere,
+    // 1 = compute hemisphere, 2 = fragment horizon). 'B' runs the paths back
+    // to back at the same sample count and prints the averages side by side.
+    FrgGpuTimer ssaoTimer{frgDevice, FrgSwapChain::MAX_FRAMES_IN_FLIGHT};
+    std::array<int, FrgSwapChain::MAX_FRAMES_IN_FLIGHT> timedPath;
+    timedPath.fill(-1);
+    constexpr int BENCHMARK_PATHS = 3;
+    std::array<double, BENCHMARK_PATHS> ssaoGpuMs{};
+    std::array<int, BENCHMARK_PATHS> ssaoGpuSamples{};
+    constexpr int BENCHMARK_FRAMES = 240;
+    int benchmarkFrame = -1;
+    bool bKeyWasPressed = false;
+
+    // Frame-time governor (press 'F'): trades SSAO and particle quality for
+    // a steady frame time. The GPU side is the graphics command buffer.
+    using Clock = std::chrono::high_resolution_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    FrgGpuTimer frameTimer{frgDevice, FrgSwapChain::MAX_FRAMES_IN_FLIGHT};
+
+    // Rebuilt every frame; kept to reuse its storage
+    FrgRenderGraph renderGraph{dynamicRendering ? frgDevice.getPipelineBarrier2() : nullptr};
+    FrgQualityGovernor governor{sceneSettings.governorBudgetMs};
+    bool governorEnabled = sceneSettings.governorEnabled;
+    bool fKeyWasPressed = false;
+    double gpuFrameMs = -1.0;
+    // Simulated and drawn particles, in whole particles.comp workgroups
+    constexpr uint32_t PARTICLE_GROUP_SIZE = 256;
+    uint32_t particleCount = frgParticleDispenser.particle_count();
+
+    auto applyQuality = [&](int kernelSize, uint32_t divisor, float particleFraction) {
+        ssaoRenderSystem.setKernelSize(kernelSize);
+        if (ssao.getResolutionDivisor() != divisor) {
+            ssao.setResolutionDivisor(divisor);
+            ssaoRenderSystem.updateDescriptorSets();
+        }
+        uint32_t groups = static_cast<uint32_t>(
+            frgParticleDispenser.particle_count() / PARTICLE_GROUP_SIZE * particleFraction);
+        particleCount = std::max(groups, 1u) * PARTICLE_GROUP_SIZE;
+    };
+    auto applyGovernorLevel = [&]() {
+        const FrgQualityGovernor::QualityLevel &level = governor.getLevel();
+        applyQuality(level.ssaoKernelSize, level.ssaoDivisor, level.particleFraction);
+        std::cout << "Quality level " << governor.getLevelIndex() << "/" << governor.getLevelCount() - 1
+                  << ": SSAO " << level.ssaoKernelSize << " samples at 1/" << level.ssaoDivisor << ", "
+                  << particleCount << " particles (budget " << governor.getBudgetMs() << " ms)" << std::endl;
+    };
+    if (governorEnabled) {
+        applyGovernorLevel();
+    }
+
+    // Multi-threaded draw recording (press 'R'): the G-buffer and lighting draws
+    // are split across worker threads into secondary command buffers, each
+    // worker with its own command pool per frame in flight
+    FrgThreadPool threadPool{static_cast<uint32_t>(std::max(sceneSettings.recordingThreads, 0))};
+    FrgCommandRecorder commandRecorder{frgDevice, threadPool, FrgSwapChain::MAX_FRAMES_IN_FLIGHT};
+    bool parallelRecording = sceneSettings.parallelRecording;
+    bool rKeyWasPressed = false;
+
+    // Deferred shading toggle (press 'G')
+    bool deferredEnabled = sceneSettings.deferredShading;
+    bool gKeyWasPressed = false;
+
     // Debug mode toggle (press 'D' to cycle)
     // 0=normal, 1=SSAO only, 2=normals, 3=depth
     int debugMode = sceneSettings.debugMode;
     bool cKeyWasPressed = false;
 
+    // Render graph dump (press 'P'): prints the passes of the next frame
+    bool dumpRenderGraph = false;
+    bool pKeyWasPressed = false;
+
+    // Texture reload (press 'X'): reads every model's textures from disk
+    // again and evicts the old ones while frames are still in flight
+    bool xKeyWasPressed = false;
+
     std::cout << "\n=== Controls ===\n";
     std::cout << "M: Toggle Camera Animation (Auto/Manual)\n";
     std::cout << "WASD: Move camera (Manual mode)\n";
     std::cout << "Arrow keys: Look around (Manual mode)\n";
     std::cout << "O: Toggle SSAO\n";
+    std::cout << "H: Cycle SSAO resolution (Full/Half/Quarter)\n";
+    std::cout << "K: Toggle SSAO path (Fragment/Compute)\n";
+    std::cout << "T: Toggle temporal SSAO accumulation (Fragment path)\n";
+    std::cout << "J: Toggle AO method (Hemisphere/Horizon, Fragment path)\n";
+    std::cout << "I: Toggle deinterleaved SSAO (Fragment hemisphere)\n";
+    std::cout << "V: Toggle adaptive SSAO sample count (Fragment hemisphere)\n";
+    std::cout << "B: Benchmark fragment vs compute vs horizon-based AO\n";
+    std::cout << "F: Toggle frame-time quality governor\n";
+    std::cout << "G: Toggle deferred shading (Forward/Deferred)\n";
+    std::cout << "R: Toggle multi-threaded draw recording\n";
     std::cout << "C: Cycle debug mode (Normal/SSAO/Normals/Depth)\n";
+    std::cout << "P: Print the render graph passes\n";
+    std::cout << "X: Reload textures from disk\n";
     std::cout << "================\n\n";
 
+    // Startup pipelines may still be building; the first frame only waits for
+    // the ones it binds
+    bool firstFrame = true;
+    bool pipelineStatsPrinted = false;
+
     while (!frgWindow.shouldClose()) {
+        auto cpuStart = Clock::now();
         glfwPollEvents();
+        frgRenderer.markInputSample();
 
         // Check for Camera Mode toggle (M key)
         bool mKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_M) == GLFW_PRESS;
@@ -129,15 +287,154 @@ void FirstApp::run() {
         }
         oKeyWasPressed = oKeyPressed;
 
+        // Check for SSAO resolution toggle (H key)
+        bool hKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_H) == GLFW_PRESS;
+        if (hKeyPressed && !hKeyWasPressed) {
+            uint32_t divisor = ssao.getResolutionDivisor() >= 4 ? 1 : ssao.getResolutionDivisor() * 2;
+            ssao.setResolutionDivisor(divisor);
+            ssaoRenderSystem.updateDescriptorSets();
+            VkExtent2D aoExtent = ssao.getAOExtent();
+            std::cout << "SSAO resolution: 1/" << divisor << " (" << aoExtent.width << "x"
+                      << aoExtent.height << ")" << std::endl;
+        }
+        hKeyWasPressed = hKeyPressed;
+
+        // Check for SSAO blur radius change ([ and ] keys)
+        bool shrinkPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+        bool growPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+        bool bracketKeyPressed = shrinkPressed || growPressed;
+        if (bracketKeyPressed && !bracketKeyWasPressed) {
+            ssaoRenderSystem.setBlurRadius(ssaoRenderSystem.getBlurRadius() + (growPressed ? 1 : -1));
+            std::cout << "SSAO blur radius: " << ssaoRenderSystem.getBlurRadius() << std::endl;
+        }
+        bracketKeyWasPressed = bracketKeyPressed;
+
+        // Check for SSAO path toggle (K key)
+        bool kKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_K) == GLFW_PRESS;
+        if (kKeyPressed && !kKeyWasPressed) {
+            if (ssao.supportsCompute()) {
+                computeSSAO = !computeSSAO;
+                std::cout << "SSAO path: " << (computeSSAO ? "Compute" : "Fragment") << std::endl;
+            } else {
+                std::cout << "SSAO path: Compute not supported (no r8 storage images)" << std::endl;
+            }
+        }
+        kKeyWasPressed = kKeyPressed;
+
+        // Check for temporal SSAO toggle (T key)
+        bool tKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_T) == GLFW_PRESS;
+        if (tKeyPressed && !tKeyWasPressed) {
+            ssaoRenderSystem.setTemporalEnabled(!ssaoRenderSystem.isTemporalEnabled());
+            std::cout << "SSAO temporal accumulation: "
+                      << (ssaoRenderSystem.isTemporalEnabled() ? "ON" : "OFF") << std::endl;
+        }
+        tKeyWasPressed = tKeyPressed;
+
+        // Check for AO method toggle (J key)
+        bool jKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_J) == GLFW_PRESS;
+        if (jKeyPressed && !jKeyWasPressed) {
+            aoMethod = aoMethod == AOMethod::Horizon ? AOMethod::Hemisphere : AOMethod::Horizon;
+            std::cout << "AO method: " << (aoMethod == AOMethod::Horizon ? "Horizon" : "Hemisphere")
+                      << std::endl;
+        }
+        jKeyWasPressed = jKeyPressed;
+
+        // Check for deinterleaved SSAO toggle (I key)
+        bool iKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_I) == GLFW_PRESS;
+        if (iKeyPressed && !iKeyWasPressed) {
+            ssaoRenderSystem.setDeinterleaved(!ssaoRenderSystem.isDeinterleaved());
+            std::cout << "SSAO deinterleaving: " << (ssaoRenderSystem.isDeinterleaved() ? "ON" : "OFF")
+                      << std::endl;
+        }
+        iKeyWasPressed = iKeyPressed;
+
+        // Check for adaptive SSAO sample count toggle (V key)
+        bool vKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_V) == GLFW_PRESS;
+        if (vKeyPressed && !vKeyWasPressed) {
+            ssaoRenderSystem.setAdaptiveSampling(!ssaoRenderSystem.isAdaptiveSampling());
+            std::cout << "SSAO adaptive sampling: "
+                      << (ssaoRenderSystem.isAdaptiveSampling() ? "ON" : "OFF") << std::endl;
+            sampleStatsSum = 0.0;
+            sampleStatsFrames = 0;
+        }
+        vKeyWasPressed = vKeyPressed;
+
+        // Start the SSAO benchmark (B key)
+        bool bKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_B) == GLFW_PRESS;
+        if (bKeyPressed && !bKeyWasPressed && benchmarkFrame < 0) {
+            if (ssaoTimer.isSupported()) {
+                benchmarkFrame = 0;
+                ssaoGpuMs = {};
+                ssaoGpuSamples = {};
+                std::cout << "SSAO benchmark: " << BENCHMARK_FRAMES << " frames..." << std::endl;
+            } else {
+                std::cout << "SSAO benchmark: timestamp queries not supported" << std::endl;
+            }
+        }
+        bKeyWasPressed = bKeyPressed;
+
+        // Check for multi-threaded recording toggle (R key)
+        bool rKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_R) == GLFW_PRESS;
+        if (rKeyPressed && !rKeyWasPressed) {
+            parallelRecording = !parallelRecording;
+            if (parallelRecording) {
+                std::cout << "Draw recording: Parallel (" << threadPool.getWorkerCount() << " workers)"
+                          << std::endl;
+            } else {
+                std::cout << "Draw recording: Single-threaded" << std::endl;
+            }
+        }
+        rKeyWasPressed = rKeyPressed;
+
+        // Check for deferred shading toggle (G key)
+        bool gKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_G) == GLFW_PRESS;
+        if (gKeyPressed && !gKeyWasPressed) {
+            deferredEnabled = !deferredEnabled;
+            std::cout << "Shading: " << (deferredEnabled ? "Deferred" : "Forward") << std::endl;
+        }
+        gKeyWasPressed = gKeyPressed;
+
         // Check for debug mode toggle (C key)
         bool cKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_C) == GLFW_PRESS;
         if (cKeyPressed && !cKeyWasPressed) {
-            debugMode = (debugMode + 1) % 4;
+            debugMode = (debugMode + 1) % SimpleRenderSystem::DEBUG_MODE_COUNT;
             const char *modeNames[] = {"Normal", "SSAO Only", "Normals", "Depth"};
             std::cout << "Debug Mode: " << modeNames[debugMode] << std::endl;
         }
         cKeyWasPressed = cKeyPressed;
 
+        // Check for render graph dump (P key)
+        bool pKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_P) == GLFW_PRESS;
+        if (pKeyPressed && !pKeyWasPressed) {
+            dumpRenderGraph = true;
+        }
+        pKeyWasPressed = pKeyPressed;
+
+        // Check for texture reload (X key)
+        bool xKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_X) == GLFW_PRESS;
+        if (xKeyPressed && !xKeyWasPressed) {
+            for (auto &obj : gameObjects) {
+                obj.model->reload_textures(frgDescriptor);
+            }
+            std::cout << "Textures reloaded (" << frgDescriptor.texture_count() << " slots in use)" << std::endl;
+        }
+        xKeyWasPressed = xKeyPressed;
+
+        // Check for quality governor toggle (F key)
+        bool fKeyPressed = glfwGetKey(frgWindow.getGLFWwindow(), GLFW_KEY_F) == GLFW_PRESS;
+        if (fKeyPressed && !fKeyWasPressed) {
+            governorEnabled = !governorEnabled;
+            std::cout << "Quality governor: " << (governorEnabled ? "ON" : "OFF") << std::endl;
+            if (governorEnabled) {
+                governor.reset(governor.getLevelIndex());
+                applyGovernorLevel();
+            } else {
+                // Back to the scene's fixed settings
+                applyQuality(FrgSSAO::KERNEL_SIZE, sceneSettings.ssaoResolutionDivisor, 1.0f);
+            }
+        }
+        fKeyWasPressed = fKeyPressed;
+
         float aspect = frgRenderer.getAspectRatio();
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime =
@@ -160,78 +457,324 @@ void FirstApp::run() {
         camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
         camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+        if (upscaleRenderSystem) {
+            // A new sub-pixel offset every frame for the resolve to accumulate
+            upscaleRenderSystem->jitterCamera(camera);
+        }
 
+        // CPU frame time leaves out the frame wait in beginFrame and the
+        // present in endFrame, which only measure how far ahead the CPU is
+        Milliseconds cpuFrameMs = Clock::now() - cpuStart;
         if (auto commandBuffer = frgRenderer.beginFrame()) {
-            if (ssaoEnabled) {
-                // === PASS 1: G-Buffer ===
-                // Render scene to position and normal textures
-                ssaoRenderSystem.beginGBufferPass(commandBuffer);
-                ssaoRenderSystem.renderGBuffer(commandBuffer, gameObjects, camera);
-                ssaoRenderSystem.endGBufferPass(commandBuffer);
-
-                // === PASS 2: SSAO Calculation ===
-                // Calculate ambient occlusion from G-buffer
-                ssaoRenderSystem.beginSSAOPass(commandBuffer);
-                ssaoRenderSystem.renderSSAO(commandBuffer, camera);
-                ssaoRenderSystem.endSSAOPass(commandBuffer);
-
-                // === PASS 3: Blur ===
-                // Blur the noisy SSAO output
-                ssaoRenderSystem.beginBlurPass(commandBuffer);
-                ssaoRenderSystem.renderBlur(commandBuffer);
-                ssaoRenderSystem.endBlurPass(commandBuffer);
+            auto recordStart = Clock::now();
+            uint32_t frameIndex = frgRenderer.getCurrentFrameIndex();
+            // beginFrame waited until this frame slot was retired
+            commandRecorder.beginFrame(frameIndex);
+            frgDescriptor.collect_released_textures();
+            frgDevice.descriptorAllocator().beginFrame(frameIndex);
+
+            // The swap chain was recreated at a new size (window resize or fullscreen): follow it with
+            // the size-dependent targets. The old ones are retired, not destroyed, so no frame waits.
+            VkExtent2D swapChainExtent = frgRenderer.getSwapChainExtent();
+            if (swapChainExtent.width != extent.width || swapChainExtent.height != extent.height) {
+                extent = swapChainExtent;
+                renderExtent = upscaleRenderSystem
+                                   ? UpscaleRenderSystem::scaledExtent(extent, sceneSettings.upscaleScale)
+                                   : extent;
+                gbuffer.resize(renderExtent);
+                ssao.resize(renderExtent);
+                ssaoRenderSystem.updateDescriptorSets();
+                frgDescriptor.setSSAOTexture(ssao.getBlurredDescriptor());
+                frgRenderer.setSharedDepthView(gbuffer.getDepthImageView(), gbuffer.getExtent());
+                if (upscaleRenderSystem) {
+                    upscaleRenderSystem->resize(extent);
+                }
+                std::cout << "Swap chain extent: " << extent.width << "x" << extent.height << std::endl;
+            }
+
+            VkSubpassContents sceneContents =
+                parallelRecording ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+            // Whole-frame GPU time of this slot's previous submission
+            double frameGpuMs = 0.0;
+            if (frameTimer.resolve(frameIndex, frameGpuMs)) {
+                gpuFrameMs = frameGpuMs;
+            }
+            frameTimer.begin(commandBuffer, frameIndex);
+
+            // This slot has been retired: collect its SSAO timing
+            double ssaoMs = 0.0;
+            if (ssaoTimer.resolve(frameIndex, ssaoMs) && timedPath[frameIndex] >= 0) {
+                ssaoGpuMs[timedPath[frameIndex]] += ssaoMs;
+                ssaoGpuSamples[timedPath[frameIndex]]++;
+            }
+            timedPath[frameIndex] = -1;
+
+            // Same slot: average samples per pixel spent by the adaptive pass
+            double averageSamples = 0.0;
+            if (ssaoRenderSystem.resolveSampleStats(frameIndex, averageSamples)) {
+                sampleStatsSum += averageSamples;
+                if (++sampleStatsFrames == SAMPLE_STATS_INTERVAL) {
+                    std::cout << "SSAO adaptive sampling: avg " << sampleStatsSum / sampleStatsFrames
+                              << " of " << ssaoRenderSystem.getKernelSize() << " samples/pixel" << std::endl;
+                    sampleStatsSum = 0.0;
+                    sampleStatsFrames = 0;
+                }
+            }
+
+            // The benchmark runs fragment hemisphere, compute hemisphere, then
+            // fragment horizon-based AO for an equal share of its frames
+            bool ssaoActive = ssaoEnabled;
+            bool useCompute = computeSSAO;
+            AOMethod frameMethod = aoMethod;
+            if (benchmarkFrame >= 0) {
+                ssaoActive = true;
+                int phase = std::min(benchmarkFrame * BENCHMARK_PATHS / BENCHMARK_FRAMES,
+                                     BENCHMARK_PATHS - 1);
+                useCompute = phase == 1 && ssao.supportsCompute();
+                frameMethod = phase == 2 ? AOMethod::Horizon : AOMethod::Hemisphere;
+                if (++benchmarkFrame > BENCHMARK_FRAMES + FrgSwapChain::MAX_FRAMES_IN_FLIGHT) {
+                    bool temporal = ssaoRenderSystem.isTemporalEnabled();
+                    const char *pathNames[] = {
+                        temporal ? "Fragment hemisphere (temporal)" : "Fragment hemisphere",
+                        "Compute hemisphere",
+                        temporal ? "Fragment horizon (temporal)" : "Fragment horizon"};
+                    VkExtent2D aoExtent = ssao.getAOExtent();
+                    std::cout << "SSAO benchmark at " << aoExtent.width << "x" << aoExtent.height << ", "
+                              << ssaoRenderSystem.getKernelSize() << " depth samples/pixel:\n";
+                    for (int path = 0; path < BENCHMARK_PATHS; path++) {
+                        if (ssaoGpuSamples[path] > 0) {
+                            std::cout << "  " << pathNames[path] << ": "
+                                      << ssaoGpuMs[path] / ssaoGpuSamples[path] << " ms GPU (avg of "
+                                      << ssaoGpuSamples[path] << " frames)\n";
+                        }
+                    }
+                    std::cout << std::flush;
+                    benchmarkFrame = -1;
+                }
+            }
+
+            // Until its background pipelines are built SSAO stays off, so startup
+            // does not wait on them. The benchmark waits instead.
+            if (ssaoActive && benchmarkFrame < 0 &&
+                !ssaoRenderSystem.isReady(frameMethod, useCompute)) {
+                ssaoActive = false;
+            }
+
+            // Deferred lighting needs the G-buffer depth bound in the final pass.
+            // The upscaled scene pass always loads it (the resolve reprojects it).
+            bool upscaling = upscaleRenderSystem != nullptr;
+            // Forward shading stands in while the deferred pipelines build
+            bool deferred = deferredEnabled && deferredRenderSystem.isReady() &&
+                            (upscaling || frgRenderer.canReuseDepth());
+            bool gbufferPass = ssaoActive || deferred || upscaling;
+            // With the G-buffer depth loaded, triangle.frag runs once per visible pixel
+            bool reuseDepth = gbufferPass && (upscaling || frgRenderer.canReuseDepth());
+
+            // The frame is declared as a render graph: each pass names the images it reads and
+            // writes, and the graph drops the passes nobody reads and places the barriers
+            using Usage = FrgRenderGraph::Usage;
+            renderGraph.reset();
+            FrgGBuffer::GraphImages gbufferImages = gbuffer.importImages(renderGraph);
+            FrgSSAO::GraphImages aoImages = ssao.importImages(renderGraph);
+
+            // === PASS 1: G-Buffer ===
+            // Render scene to depth and normal (and albedo when deferred) textures
+            renderGraph.addPass(
+                "gbuffer",
+                {{gbufferImages.normal, Usage::ColorAttachment},
+                 {gbufferImages.albedo, Usage::ColorAttachment},
+                 {gbufferImages.depth, Usage::DepthAttachment}},
+                [&](VkCommandBuffer cb) {
+                    ssaoRenderSystem.beginGBufferPass(cb, sceneContents);
+                    auto renderGBuffer = [&](VkCommandBuffer gbufferCb, size_t begin, size_t end) {
+                        if (deferred) {
+                            deferredRenderSystem.renderGBuffer(gbufferCb, gameObjects, begin, end, camera);
+                        } else {
+                            ssaoRenderSystem.renderGBuffer(gbufferCb, gameObjects, begin, end, camera);
+                        }
+                    };
+                    if (parallelRecording) {
+                        commandRecorder.recordParallel(
+                            cb, gbuffer.getTarget(), gameObjects.size(), renderGBuffer);
+                    } else {
+                        renderGBuffer(cb, 0, gameObjects.size());
+                    }
+                    ssaoRenderSystem.endGBufferPass(cb);
+                });
+
+            FrgRenderGraph::Resource aoResult;
+            if (ssaoActive) {
+                renderGraph.addPass(
+                    "ssao timer begin", {}, [&](VkCommandBuffer cb) { ssaoTimer.begin(cb, frameIndex); }, true);
+                // Compute always runs the hemisphere kernel
+                ssaoRenderSystem.setAOMethod(useCompute ? AOMethod::Hemisphere : frameMethod);
+                timedPath[frameIndex] = useCompute ? 1 : (frameMethod == AOMethod::Horizon ? 2 : 0);
+
+                // === PASS 2-3: SSAO + Blur ===
+                // Downsample, importance, (de)interleave, SSAO, temporal accumulation, blur and
+                // upsample, as the current settings need them
+                aoResult = ssaoRenderSystem.addPasses(renderGraph, gbufferImages, aoImages, camera, frameIndex,
+                                                      useCompute);
+                renderGraph.addPass(
+                    "ssao timer end", {}, [&](VkCommandBuffer cb) { ssaoTimer.end(cb, frameIndex); }, true);
             } else {
-                // If SSAO is disabled, we still need to clear the texture that the
-                // lighting pass reads from. The blur pass RenderPass is configured to
-                // loadOp = CLEAR (to white 1.0) So just beginning and ending the pass
-                // is enough to clear it.
-                ssaoRenderSystem.beginBlurPass(commandBuffer);
-                ssaoRenderSystem.endBlurPass(commandBuffer);
+                // The deferred lighting pass still reads the AO texture: clear it to 1.0. Culled in
+                // forward mode, which does not bind it.
+                aoResult = ssaoRenderSystem.addClearPass(renderGraph, aoImages);
             }
 
             // === PASS 4: Final Lighting ===
             // Render the scene with lighting (uses blurred SSAO for ambient)
-            frgRenderer.beginSwapChainRenderPass(commandBuffer);
-            simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects, camera, frameTime, extent, debugMode);
-            simpleRenderSystem.bindComputeGraphicsPipeline(commandBuffer);
+            // Advance the light and allocate the SSAO set once, before any worker reads them
+            simpleRenderSystem.animateLights(frameTime);
+            if (ssaoActive) {
+                frgDescriptor.updateSSAODescriptorSet();
+            }
+            auto renderLighting = [&](VkCommandBuffer cb) {
+                deferredRenderSystem.renderLighting(cb, frgRenderer.getCurrentFrameIndex(), camera, debugMode);
+            };
+            auto renderForward = [&](VkCommandBuffer cb, size_t begin, size_t end) {
+                simpleRenderSystem.renderGameObjectRange(cb, gameObjects, begin, end, camera, renderExtent,
+                                                         debugMode, reuseDepth, ssaoActive);
+            };
+            auto renderParticles = [&](VkCommandBuffer cb) {
+                simpleRenderSystem.bindComputeGraphicsPipeline(cb);
+                SimplePushConstantData push{};
+                auto projView = camera.getProjectionMatrix() * camera.getViewMatrix();
+                auto modelMat = frgParticleDispenser.transform.mat4();
+                push.transform = projView * modelMat;
+                vkCmdPushConstants(
+                    cb,
+                    simpleRenderSystem.getComputeGraphicsPipelineLayout(),
+                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    0,
+                    sizeof(SimplePushConstantData),
+                    &push
+                );
+                frgRenderer.delegateComputeBindAndDraw(
+                    cb,
+                    simpleRenderSystem.getSSBOS(),
+                    particleCount
+                );
+            };
+
+            std::vector<FrgRenderGraph::Access> sceneReads;
+            if (reuseDepth) {
+                sceneReads.push_back({gbufferImages.depth, Usage::DepthTest});
+            }
+            if (deferred) {
+                sceneReads.push_back({gbufferImages.depth, Usage::SampledFragment});
+                sceneReads.push_back({gbufferImages.normal, Usage::SampledFragment});
+                sceneReads.push_back({gbufferImages.albedo, Usage::SampledFragment});
+            }
+            if (deferred || ssaoActive) {
+                sceneReads.push_back({aoResult, Usage::SampledFragment});
+            }
+            renderGraph.addPass(
+                "scene", sceneReads,
+                [&](VkCommandBuffer cb) {
+                    FrgRenderTarget sceneTarget{};
+                    if (upscaling) {
+                        // Same pass at the internal resolution, into the upscaler's target
+                        upscaleRenderSystem->beginScenePass(cb, sceneContents);
+                        sceneTarget = {upscaleRenderSystem->getSceneRenderPass(),
+                                       upscaleRenderSystem->getSceneFramebuffer(), renderExtent};
+                    } else {
+                        frgRenderer.beginSwapChainRenderPass(cb, reuseDepth, sceneContents);
+                        sceneTarget = {frgRenderer.getActiveRenderPass(), frgRenderer.getActiveFramebuffer(),
+                                       frgRenderer.getSwapChainExtent()};
+                    }
+                    if (parallelRecording) {
+                        // The fullscreen lighting draw is a single secondary on this thread
+                        if (deferred) {
+                            commandRecorder.record(cb, sceneTarget, renderLighting);
+                        } else {
+                            commandRecorder.recordParallel(cb, sceneTarget, gameObjects.size(), renderForward);
+                        }
+                        commandRecorder.record(cb, sceneTarget, renderParticles);
+                    } else {
+                        if (deferred) {
+                            renderLighting(cb);
+                        } else {
+                            renderForward(cb, 0, gameObjects.size());
+                        }
+                        renderParticles(cb);
+                    }
+                    if (upscaling) {
+                        upscaleRenderSystem->endScenePass(cb);
+                    } else {
+                        frgRenderer.endSwapChainRenderPass(cb);
+                    }
+                },
+                true);
+
+            if (upscaling) {
+                // === PASS 5: Temporal Upscale ===
+                // Accumulate the jittered internal-resolution frames at the output
+                // resolution, then copy the result into the swap chain image
+                renderGraph.addPass(
+                    "upscale resolve", {{gbufferImages.depth, Usage::SampledFragment}},
+                    [&](VkCommandBuffer cb) {
+                        upscaleRenderSystem->beginResolvePass(cb);
+                        upscaleRenderSystem->renderResolve(cb, camera);
+                        upscaleRenderSystem->endResolvePass(cb);
+                    },
+                    true);
+                renderGraph.addPass(
+                    "present", {},
+                    [&](VkCommandBuffer cb) {
+                        frgRenderer.beginSwapChainRenderPass(cb);
+                        upscaleRenderSystem->renderPresent(cb);
+                        frgRenderer.endSwapChainRenderPass(cb);
+                    },
+                    true);
+            }
+
+            renderGraph.execute(commandBuffer);
+            if (dumpRenderGraph) {
+                renderGraph.dumpPasses(std::cout);
+                dumpRenderGraph = false;
+            }
+
             UniformBufferObject ubo{};
             ubo.deltaTime = frameTime;
-            SimplePushConstantData push{};
-            auto projView = camera.getProjectionMatrix() * camera.getViewMatrix();
-            auto modelMat = frgParticleDispenser.transform.mat4();
-            push.transform = projView * modelMat;
-            vkCmdPushConstants(
-                commandBuffer,
-                simpleRenderSystem.getComputeGraphicsPipelineLayout(),
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(SimplePushConstantData),
-                &push
-            );
-
             ubo.w_parent_pos = {frgParticleDispenser.transform.translation, .6f};
             frgRenderer.renderComputePipeline(
                 computeCommandBuffers,
                 frgDescriptor,
                 simpleRenderSystem.getComputePipelineLayout(),
                 simpleRenderSystem.getComputePipeline(),
-                frgParticleDispenser.particle_count(),
+                particleCount,
                 ubo,
                 simpleRenderSystem.getUbosMapped()
             );
-            frgRenderer.delegateComputeBindAndDraw(
-                commandBuffer,
-                simpleRenderSystem.getSSBOS(),
-                frgParticleDispenser.particle_count()
-            );
-
 
-            frgRenderer.endSwapChainRenderPass(commandBuffer);
+            frameTimer.end(commandBuffer, frameIndex);
+            cpuFrameMs += Clock::now() - recordStart;
             frgRenderer.endFrame(true);
+
+            if (firstFrame) {
+                firstFrame = false;
+                std::cout << "First frame after " << Milliseconds{Clock::now() - runStart}.count() << " ms"
+                          << std::endl;
+            }
+            if (!pipelineStatsPrinted && frgDevice.pipelineCompiler().isIdle()) {
+                pipelineStatsPrinted = true;
+                frgDevice.pipelineCache().printStats();
+            }
+
+            // The benchmark compares paths at fixed settings
+            if (governorEnabled && benchmarkFrame < 0 && governor.update(cpuFrameMs.count(), gpuFrameMs)) {
+                std::cout << "Frame time " << governor.getAverageMs() << " ms -> ";
+                applyGovernorLevel();
+            }
         }
     }
 
     vkDeviceWaitIdle(frgDevice.device());
+    // The G-buffer goes out of scope before the renderer
+    frgRenderer.setSharedDepthView(VK_NULL_HANDLE, {0, 0});
 }
 
 void FirstApp::loadGameObjects() {
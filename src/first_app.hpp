@@ -1,5 +1,6 @@
 #pragma once
 
+#include "deferred_render_system.hpp"
 #include "frg_descriptor.hpp"
 #include "frg_device.hpp"
 #include "frg_game_object.hpp"
@@ -42,7 +43,6 @@ class FirstApp {
         frgDevice, 131072, HEIGHT, WIDTH, {1.3, -0.2, -1.8, 0.0}
     };
 
-    std::vector<VkDescriptorImageInfo> get_descriptors_of_game_objects();
     std::vector<FrgGameObject> gameObjects;
     std::vector<VkCommandBuffer> computeCommandBuffers;
     FrgGameObject viewerObject{FrgGameObject::createGameObject()};
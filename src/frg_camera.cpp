@@ -30,6 +30,14 @@ void FrgCamera::setPerspectiveProjection(
     projectionMatrix[2][2] = far / (far - near);
     projectionMatrix[2][3] = 1.f;
     projectionMatrix[3][2] = -(far * near) / (far - near);
+    projectionJitter = glm::vec2{0.f};
+}
+
+void FrgCamera::setProjectionJitter(const glm::vec2 &ndcOffset) {
+    // clip.w = view z, so offsetting the z column shifts NDC by a constant
+    projectionMatrix[2][0] += ndcOffset.x - projectionJitter.x;
+    projectionMatrix[2][1] += ndcOffset.y - projectionJitter.y;
+    projectionJitter = ndcOffset;
 }
 
 void FrgCamera::setViewDirection(
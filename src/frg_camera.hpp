@@ -11,6 +11,9 @@ namespace frg
     public:
         void setOrthographicProjection(float left, float right, float top, float bottom, float near, float far);
         void setPerspectiveProjection(float fovy, float aspect, float near, float far);
+        // Shifts the perspective projection by a sub-pixel offset in NDC (temporal upscaling).
+        // Reset by the next setPerspectiveProjection call.
+        void setProjectionJitter(const glm::vec2 &ndcOffset);
 
         void setViewDirection(const glm::vec3 &position, const glm::vec3 &direction, const glm::vec3 &up = glm::vec3{0, -1, 0});
         void setViewTarget(const glm::vec3 &position, const glm::vec3 &target, const glm::vec3 &up = glm::vec3{0, -1, 0});
@@ -18,10 +21,12 @@ namespace frg
 
         const glm::mat4 &getProjectionMatrix() const { return projectionMatrix; }
         const glm::mat4 &getViewMatrix() const { return viewMatrix; }
+        const glm::vec2 &getProjectionJitter() const { return projectionJitter; }
 
     private:
         glm::mat4 projectionMatrix{1.f};
         glm::mat4 viewMatrix{1.f};
+        glm::vec2 projectionJitter{0.f};
     };
 
 } // namespace frg
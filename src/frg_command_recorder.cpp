@@ -0,0 +1,156 @@
+#include "frg_command_recorder.hpp"
+
+// std
+#include <stdexcept>
+
+namespace frg {
+
+FrgCommandRecorder::FrgCommandRecorder(FrgDevice &device,
+                                       FrgThreadPool &threadPool,
+                                       uint32_t frameCount)
+    : frgDevice{device}, threadPool{threadPool} {
+  QueueFamilyIndices queueFamilyIndices =
+      frgDevice.findPhysicalQueueFamilies();
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsAndComputeFamily;
+  // Buffers are only ever reset together with their pool
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  frames.resize(frameCount);
+  for (auto &threads : frames) {
+    threads.resize(threadPool.getWorkerCount() + 1);
+    for (auto &commands : threads) {
+      if (vkCreateCommandPool(frgDevice.device(), &poolInfo, nullptr,
+                              &commands.pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create recording command pool!");
+      }
+    }
+  }
+}
+
+FrgCommandRecorder::~FrgCommandRecorder() {
+  for (auto &threads : frames) {
+    for (auto &commands : threads) {
+      // Destroying the pool frees its command buffers
+      vkDestroyCommandPool(frgDevice.device(), commands.pool, nullptr);
+    }
+  }
+}
+
+void FrgCommandRecorder::beginFrame(uint32_t frameIndex) {
+  currentFrame = frameIndex;
+  for (auto &commands : frames[currentFrame]) {
+    vkResetCommandPool(frgDevice.device(), commands.pool, 0);
+    commands.used = 0;
+  }
+}
+
+void FrgCommandRecorder::recordParallel(VkCommandBuffer primary,
+                                        const FrgRenderTarget &target,
+                                        size_t drawCount,
+                                        const RangeFn &fn) {
+  if (drawCount == 0) {
+    return;
+  }
+
+  // One slot per chunk, filled by the worker that recorded it
+  std::vector<VkCommandBuffer> secondaries(
+      threadPool.chunkCount(drawCount, MIN_DRAWS_PER_WORKER));
+  auto &threads = frames[currentFrame];
+
+  threadPool.parallelFor(
+      drawCount, MIN_DRAWS_PER_WORKER,
+      [&](uint32_t worker, size_t begin, size_t end) {
+        VkCommandBuffer commandBuffer =
+            beginSecondary(threads[worker], target);
+        fn(commandBuffer, begin, end);
+        endSecondary(commandBuffer);
+        secondaries[worker] = commandBuffer;
+      });
+
+  vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()),
+                       secondaries.data());
+}
+
+void FrgCommandRecorder::record(VkCommandBuffer primary,
+                                const FrgRenderTarget &target,
+                                const RecordFn &fn) {
+  VkCommandBuffer commandBuffer =
+      beginSecondary(frames[currentFrame].back(), target);
+  fn(commandBuffer);
+  endSecondary(commandBuffer);
+
+  vkCmdExecuteCommands(primary, 1, &commandBuffer);
+}
+
+VkCommandBuffer
+FrgCommandRecorder::beginSecondary(ThreadCommands &commands,
+                                   const FrgRenderTarget &target) {
+  if (commands.used == commands.buffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = commands.pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(frgDevice.device(), &allocInfo,
+                                 &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+    commands.buffers.push_back(commandBuffer);
+  }
+  VkCommandBuffer commandBuffer = commands.buffers[commands.used++];
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = target.renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = target.framebuffer;
+
+  VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+  if (target.isDynamic()) {
+    renderingInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInfo.colorAttachmentCount = target.colorCount;
+    renderingInfo.pColorAttachmentFormats = target.colorFormats.data();
+    renderingInfo.depthAttachmentFormat = target.depthFormat;
+    renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    inheritanceInfo.pNext = &renderingInfo;
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin secondary command buffer!");
+  }
+
+  // Dynamic state does not carry over from the primary
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(target.extent.width);
+  viewport.height = static_cast<float>(target.extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  VkRect2D scissor{{0, 0}, target.extent};
+
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+  return commandBuffer;
+}
+
+void FrgCommandRecorder::endSecondary(VkCommandBuffer commandBuffer) {
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
+}
+
+} // namespace frg
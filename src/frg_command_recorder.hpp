@@ -0,0 +1,92 @@
+#pragma once
+
+#include "frg_device.hpp"
+#include "frg_render_target.hpp"
+#include "frg_thread_pool.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Command Recorder
+ *
+ * Records the draws of a render pass into secondary command buffers on the
+ * thread pool workers, then executes them from the frame's primary command
+ * buffer.
+ *
+ * Command pools are not thread-safe, so every worker (and the calling thread)
+ * gets its own pool per frame in flight. A frame's pools are reset as a whole
+ * with vkResetCommandPool once the frame has been retired, which recycles
+ * all of their secondaries at once instead of resetting them one by one.
+ *
+ * Usage per frame (after FrgRenderer::beginFrame):
+ *   recorder.beginFrame(frameIndex);
+ *   target.begin(..., VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+ *   recorder.recordParallel(primary, target, drawCount, fn);
+ *   recorder.record(primary, target, fn);  // optional, on the caller
+ *   target.end(...)
+ *
+ * The secondaries continue either a render pass instance or dynamic
+ * rendering, as the target records it.
+ */
+class FrgCommandRecorder {
+public:
+  // Records draws [begin, end) into a secondary command buffer
+  using RangeFn =
+      std::function<void(VkCommandBuffer commandBuffer, size_t begin,
+                         size_t end)>;
+  using RecordFn = std::function<void(VkCommandBuffer commandBuffer)>;
+
+  // Below this many draws per worker the hand-off costs more than it saves
+  static constexpr size_t MIN_DRAWS_PER_WORKER = 64;
+
+  FrgCommandRecorder(FrgDevice &device, FrgThreadPool &threadPool,
+                     uint32_t frameCount);
+  ~FrgCommandRecorder();
+
+  FrgCommandRecorder(const FrgCommandRecorder &) = delete;
+  FrgCommandRecorder &operator=(const FrgCommandRecorder &) = delete;
+
+  // Recycles the frame's secondaries; the frame must have been retired
+  void beginFrame(uint32_t frameIndex);
+
+  // Splits drawCount draws across the workers, one secondary each, and
+  // executes them in draw order. fn runs concurrently and must only read
+  // shared state.
+  void recordParallel(VkCommandBuffer primary, const FrgRenderTarget &target,
+                      size_t drawCount, const RangeFn &fn);
+
+  // Records one secondary on the calling thread and executes it
+  void record(VkCommandBuffer primary, const FrgRenderTarget &target,
+              const RecordFn &fn);
+
+  uint32_t getWorkerCount() const { return threadPool.getWorkerCount(); }
+
+private:
+  // One per thread per frame in flight
+  struct ThreadCommands {
+    VkCommandPool pool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> buffers; // allocated so far, reused
+    size_t used = 0;
+  };
+
+  VkCommandBuffer beginSecondary(ThreadCommands &commands,
+                                 const FrgRenderTarget &target);
+  void endSecondary(VkCommandBuffer commandBuffer);
+
+  FrgDevice &frgDevice;
+  FrgThreadPool &threadPool;
+
+  // [frame][thread]; the last thread slot belongs to the calling thread
+  std::vector<std::vector<ThreadCommands>> frames;
+  uint32_t currentFrame = 0;
+};
+
+} // namespace frg
@@ -0,0 +1,69 @@
+#include "frg_deletion_queue.hpp"
+
+// std
+#include <utility>
+
+namespace frg {
+
+FrgDeletionQueue::FrgDeletionQueue(VkDevice device) : device{device} {}
+
+FrgDeletionQueue::~FrgDeletionQueue() { flush(); }
+
+void FrgDeletionQueue::retire(std::function<void()> destroy) {
+  // The frame being recorded signals the next value
+  entries.push_back({submittedValue + 1, std::move(destroy)});
+}
+
+void FrgDeletionQueue::retireImage(VkImage &image, VkDeviceMemory &memory,
+                                   VkImageView &view) {
+  if (image == VK_NULL_HANDLE && memory == VK_NULL_HANDLE &&
+      view == VK_NULL_HANDLE) {
+    return;
+  }
+  retire([dev = device, image, memory, view] {
+    if (view != VK_NULL_HANDLE) {
+      vkDestroyImageView(dev, view, nullptr);
+    }
+    if (image != VK_NULL_HANDLE) {
+      vkDestroyImage(dev, image, nullptr);
+    }
+    if (memory != VK_NULL_HANDLE) {
+      vkFreeMemory(dev, memory, nullptr);
+    }
+  });
+  image = VK_NULL_HANDLE;
+  memory = VK_NULL_HANDLE;
+  view = VK_NULL_HANDLE;
+}
+
+void FrgDeletionQueue::retireFramebuffer(VkFramebuffer &framebuffer) {
+  if (framebuffer == VK_NULL_HANDLE) {
+    return;
+  }
+  retire([dev = device, framebuffer] {
+    vkDestroyFramebuffer(dev, framebuffer, nullptr);
+  });
+  framebuffer = VK_NULL_HANDLE;
+}
+
+void FrgDeletionQueue::advance(uint64_t submitted, uint64_t completed) {
+  submittedValue = submitted;
+  completedValue_ = completed;
+  // Values only grow, so the queue is ordered by them
+  while (!entries.empty() && entries.front().value <= completed) {
+    // Moved out first: destroy may retire further objects
+    std::function<void()> destroy = std::move(entries.front().destroy);
+    entries.pop_front();
+    destroy();
+  }
+}
+
+void FrgDeletionQueue::flush() {
+  while (!entries.empty()) {
+    std::function<void()> destroy = std::move(entries.front().destroy);
+    entries.pop_front();
+    destroy();
+  }
+}
+
+} // namespace frg
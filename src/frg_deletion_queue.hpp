@@ -0,0 +1,65 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace frg {
+
+/**
+ * Deletion Queue
+ *
+ * Destroys objects once the frames that may still use them have finished,
+ * so resources can be replaced (resize, resolution changes) without idling
+ * the device.
+ *
+ * Frames are identified by the graphics timeline value their submit
+ * signals (see FrgSwapChain). Everything retired while a frame is recorded
+ * is destroyed once that frame's value has been reached, which also covers
+ * every earlier frame. FrgRenderer reports the submitted and completed
+ * values after every submit.
+ *
+ * Main thread only.
+ */
+class FrgDeletionQueue {
+public:
+  explicit FrgDeletionQueue(VkDevice device);
+  // Destroys everything still queued; the device must be idle
+  ~FrgDeletionQueue();
+
+  FrgDeletionQueue(const FrgDeletionQueue &) = delete;
+  FrgDeletionQueue &operator=(const FrgDeletionQueue &) = delete;
+
+  void retire(std::function<void()> destroy);
+  // Null handles are skipped; the handles are reset to VK_NULL_HANDLE
+  void retireImage(VkImage &image, VkDeviceMemory &memory, VkImageView &view);
+  void retireFramebuffer(VkFramebuffer &framebuffer);
+
+  // Timeline value of the frame being recorded, for owners that track their
+  // own retired resources (see FrgDescriptor::release_textures)
+  uint64_t retireValue() const { return submittedValue + 1; }
+  uint64_t completedValue() const { return completedValue_; }
+
+  // submitted: last graphics timeline value handed to the queue
+  // completed: value the timeline has reached
+  void advance(uint64_t submitted, uint64_t completed);
+  // Destroys everything queued; the device must be idle
+  void flush();
+
+private:
+  struct Entry {
+    uint64_t value;
+    std::function<void()> destroy;
+  };
+
+  VkDevice device;
+  std::deque<Entry> entries;
+  uint64_t submittedValue = 0;
+  uint64_t completedValue_ = 0;
+};
+
+} // namespace frg
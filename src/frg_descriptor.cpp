@@ -1,7 +1,13 @@
 #include "frg_descriptor.hpp"
 
+// std
+#include <algorithm>
+#include <cassert>
+#include <optional>
+
 namespace frg {
-FrgDescriptor::FrgDescriptor(FrgDevice &device) : frg_device{device} {
+FrgDescriptor::FrgDescriptor(FrgDevice &device)
+    : frg_device{device}, texture_slots{bindless_capacity(device)} {
     create_descriptor_set_layout_binding();
     create_comp_descriptor_set_layout_binding();
     create_descriptor_pool();
@@ -10,6 +16,7 @@ FrgDescriptor::FrgDescriptor(FrgDevice &device) : frg_device{device} {
 FrgDescriptor::~FrgDescriptor() {
     vkDestroyDescriptorPool(frg_device.device(), descriptor_pool, nullptr);
     vkDestroyDescriptorSetLayout(frg_device.device(), descriptor_set_layout, nullptr);
+    vkDestroyDescriptorSetLayout(frg_device.device(), ssao_set_layout, nullptr);
     vkDestroyDescriptorSetLayout(frg_device.device(), comp_desc_set_layout, nullptr);
 }
 
@@ -22,35 +29,33 @@ void FrgDescriptor::create_descriptor_set_layout_binding() {
     sampler_layout_binding.pImmutableSamplers = nullptr;
     sampler_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    // Binding 1: Texture array
+    // Binding 1 (the SSAO texture) moved to its own set, see ssaoDescriptorSet
+
+    // Binding 2: Bindless texture table. A variable-count binding has to be
+    // the last one.
     VkDescriptorSetLayoutBinding image_array_binding{};
-    image_array_binding.binding = 1;
-    image_array_binding.descriptorCount = texture_descriptor_size;
+    image_array_binding.binding = 2;
+    image_array_binding.descriptorCount = texture_capacity();
     image_array_binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
     image_array_binding.pImmutableSamplers = nullptr;
     image_array_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    // Binding 2: SSAO texture (combined image sampler)
-    VkDescriptorSetLayoutBinding ssao_binding{};
-    ssao_binding.binding = 2;
-    ssao_binding.descriptorCount = 1;
-    ssao_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    ssao_binding.pImmutableSamplers = nullptr;
-    ssao_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {sampler_layout_binding,
-                                                            image_array_binding, ssao_binding};
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {sampler_layout_binding, image_array_binding};
 
     VkDescriptorSetLayoutCreateInfo layout_info{};
     layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
     layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
     layout_info.pBindings = bindings.data();
 
-    VkDescriptorBindingFlags binding_flags[] = {0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-                                                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT};
+    // Unused slots stay unwritten, and new ones are written while the set is
+    // bound in frames still in flight
+    VkDescriptorBindingFlags binding_flags[] = {0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                       VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT |
+                                                       VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT};
     VkDescriptorSetLayoutBindingFlagsCreateInfo layout_flags_info{};
     layout_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
-    layout_flags_info.bindingCount = 3;
+    layout_flags_info.bindingCount = 2;
     layout_flags_info.pBindingFlags = binding_flags;
     layout_flags_info.pNext = nullptr;
     layout_info.pNext = reinterpret_cast<void *>(&layout_flags_info);
@@ -58,6 +63,23 @@ void FrgDescriptor::create_descriptor_set_layout_binding() {
     if (vkCreateDescriptorSetLayout(frg_device.device(), &layout_info, nullptr, &descriptor_set_layout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout!");
     }
+
+    // Set 1: SSAO texture (combined image sampler)
+    VkDescriptorSetLayoutBinding ssao_binding{};
+    ssao_binding.binding = 0;
+    ssao_binding.descriptorCount = 1;
+    ssao_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    ssao_binding.pImmutableSamplers = nullptr;
+    ssao_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo ssao_layout_info{};
+    ssao_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    ssao_layout_info.bindingCount = 1;
+    ssao_layout_info.pBindings = &ssao_binding;
+
+    if (vkCreateDescriptorSetLayout(frg_device.device(), &ssao_layout_info, nullptr, &ssao_set_layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
 }
 
 void FrgDescriptor::create_comp_descriptor_set_layout_binding() {
@@ -91,24 +113,21 @@ void FrgDescriptor::create_comp_descriptor_set_layout_binding() {
 }
 
 void FrgDescriptor::create_descriptor_pool() {
-    std::array<VkDescriptorPoolSize, 5> pool_sizes;
+    // Only the bindless set lives here: it needs an update-after-bind pool
+    // sized to the table. Other sets come from the device's allocator.
+    std::array<VkDescriptorPoolSize, 2> pool_sizes;
     pool_sizes[0] = {};
     pool_sizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLER;
     pool_sizes[0].descriptorCount = 1;
     pool_sizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    pool_sizes[1].descriptorCount = texture_descriptor_size;
-    pool_sizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    pool_sizes[2].descriptorCount = 1; // SSAO texture
-    pool_sizes[3].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_sizes[3].descriptorCount = static_cast<uint32_t>(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
-    pool_sizes[4].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    pool_sizes[4].descriptorCount = static_cast<uint32_t>(FrgSwapChain::MAX_FRAMES_IN_FLIGHT) * 2;
+    pool_sizes[1].descriptorCount = texture_capacity();
 
     VkDescriptorPoolCreateInfo pool_info{};
     pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
     pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
     pool_info.pPoolSizes = pool_sizes.data();
-    pool_info.maxSets = texture_descriptor_size + static_cast<uint32_t>(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+    pool_info.maxSets = 1;
 
     if (vkCreateDescriptorPool(frg_device.device(), &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
@@ -116,8 +135,16 @@ void FrgDescriptor::create_descriptor_pool() {
 }
 
 void FrgDescriptor::create_descriptor_sets() {
+    // Allocate the whole table up front; slots are handed out by texture_slots
+    uint32_t texture_slot_count = texture_capacity();
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info{};
+    variable_count_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    variable_count_info.descriptorSetCount = 1;
+    variable_count_info.pDescriptorCounts = &texture_slot_count;
+
     VkDescriptorSetAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.pNext = &variable_count_info;
     alloc_info.descriptorPool = descriptor_pool;
     alloc_info.descriptorSetCount = 1;
     alloc_info.pSetLayouts = &descriptor_set_layout;
@@ -125,40 +152,60 @@ void FrgDescriptor::create_descriptor_sets() {
     if (vkAllocateDescriptorSets(frg_device.device(), &alloc_info, &descriptor_set) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor set!");
     }
-}
 
-void FrgDescriptor::write_descriptor_sets(const std::vector<VkDescriptorImageInfo> &image_infos) {
     VkDescriptorImageInfo sampler_info{};
     sampler_info.sampler = frg_device.textureSampler();
 
-    std::array<VkWriteDescriptorSet, 2> set_writes{};
-    set_writes[0] = {};
-    set_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    set_writes[0].dstSet = descriptor_set;
-    set_writes[0].dstBinding = 0;
-    set_writes[0].dstArrayElement = 0;
-    set_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-    set_writes[0].descriptorCount = 1;
-    set_writes[0].pBufferInfo = 0;
-    set_writes[0].pImageInfo = &sampler_info;
-
-    set_writes[1] = {};
-    set_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    set_writes[1].dstSet = descriptor_set;
-    set_writes[1].dstBinding = 1;
-    set_writes[1].dstArrayElement = 0;
-    set_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    set_writes[1].descriptorCount = static_cast<uint32_t>(image_infos.size());
-    set_writes[1].pBufferInfo = 0;
-    set_writes[1].pImageInfo = image_infos.data();
-
-    vkUpdateDescriptorSets(
-        frg_device.device(),
-        static_cast<uint32_t>(set_writes.size()),
-        set_writes.data(),
-        0,
-        nullptr
-    );
+    VkWriteDescriptorSet sampler_write{};
+    sampler_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    sampler_write.dstSet = descriptor_set;
+    sampler_write.dstBinding = 0;
+    sampler_write.dstArrayElement = 0;
+    sampler_write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    sampler_write.descriptorCount = 1;
+    sampler_write.pImageInfo = &sampler_info;
+
+    vkUpdateDescriptorSets(frg_device.device(), 1, &sampler_write, 0, nullptr);
+}
+
+uint32_t FrgDescriptor::bindless_capacity(FrgDevice &device) {
+    // The other sampled images count against the same per-stage limit
+    uint32_t device_limit = device.maxBindlessTextures();
+    uint32_t available = device_limit > RESERVED_SAMPLED_IMAGES ? device_limit - RESERVED_SAMPLED_IMAGES : 0;
+    return std::min(available, MAX_BINDLESS_TEXTURES);
+}
+
+uint32_t FrgDescriptor::add_textures(const std::vector<VkDescriptorImageInfo> &image_infos) {
+    assert(!image_infos.empty() && "Cannot add an empty set of textures");
+    uint32_t count = static_cast<uint32_t>(image_infos.size());
+    std::optional<uint32_t> first_slot = texture_slots.allocate(count);
+    if (!first_slot.has_value()) {
+        throw std::runtime_error("bindless texture table is full!");
+    }
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_set;
+    write.dstBinding = 2;
+    write.dstArrayElement = first_slot.value();
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.descriptorCount = count;
+    write.pImageInfo = image_infos.data();
+
+    vkUpdateDescriptorSets(frg_device.device(), 1, &write, 0, nullptr);
+    return first_slot.value();
+}
+
+void FrgDescriptor::release_textures(uint32_t first_slot, uint32_t count) {
+    texture_releases.push_back({frg_device.deletionQueue().retireValue(), first_slot, count});
+}
+
+void FrgDescriptor::collect_released_textures() {
+    uint64_t completed = frg_device.deletionQueue().completedValue();
+    while (!texture_releases.empty() && texture_releases.front().value <= completed) {
+        texture_slots.free(texture_releases.front().first_slot, texture_releases.front().count);
+        texture_releases.pop_front();
+    }
 }
 
 void FrgDescriptor::write_comp_descriptor_sets(
@@ -169,17 +216,8 @@ void FrgDescriptor::write_comp_descriptor_sets(
         layout_count == uni_buffers.size() &&
         "The program requires the same amount of descriptor sets as uniform buffers!"
     );
-    std::vector<VkDescriptorSetLayout> layouts(layout_count, comp_desc_set_layout);
-    VkDescriptorSetAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc_info.descriptorPool = descriptor_pool;
-    alloc_info.descriptorSetCount = layout_count;
-    alloc_info.pSetLayouts = layouts.data();
-
     comp_descriptor_set.resize(layout_count);
-    if (vkAllocateDescriptorSets(frg_device.device(), &alloc_info, comp_descriptor_set.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate compute descriptor sets!");
-    }
+    frg_device.descriptorAllocator().allocate(comp_desc_set_layout, comp_descriptor_set);
 
     for (uint32_t i = 0; i < layout_count; ++i) {
         VkDescriptorBufferInfo uniform_buffer_info{};
@@ -261,17 +299,20 @@ void FrgDescriptor::recordComputeCommandBuffer(
 }
 
 void FrgDescriptor::setSSAOTexture(VkDescriptorImageInfo ssaoInfo) {
+    ssao_info = ssaoInfo;
+    ssaoEnabled = true;
+}
+
+void FrgDescriptor::updateSSAODescriptorSet() {
+    assert(ssaoEnabled && "Cannot update the SSAO set before setSSAOTexture");
     VkWriteDescriptorSet write{};
     write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.dstSet = descriptor_set;
-    write.dstBinding = 2;
+    write.dstBinding = 0;
     write.dstArrayElement = 0;
     write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     write.descriptorCount = 1;
-    write.pImageInfo = &ssaoInfo;
-
-    vkUpdateDescriptorSets(frg_device.device(), 1, &write, 0, nullptr);
-    ssaoEnabled = true;
+    write.pImageInfo = &ssao_info;
+    ssao_descriptor_set = frg_device.descriptorAllocator().getTransient(ssao_set_layout, {write});
 }
 
 } // namespace frg
\ No newline at end of file
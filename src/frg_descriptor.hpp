@@ -1,5 +1,6 @@
 #pragma once
 #include "frg_device.hpp"
+#include "frg_slot_allocator.hpp"
 #include "frg_swap_chain.hpp"
 
 #define GLFW_INCLUDE_VULKAN
@@ -7,7 +8,9 @@
 
 #include <array>
 #include <cassert>
+#include <deque>
 #include <stdexcept>
+#include <vector>
 
 namespace frg {
 class FrgDescriptor {
@@ -24,14 +27,33 @@ class FrgDescriptor {
     uint32_t descriptorSetCount() { return 1; }
     uint32_t getComputeDescriptorSetCount() { return static_cast<uint32_t>(comp_descriptor_set.size()); }
 
-    void write_descriptor_sets(const std::vector<VkDescriptorImageInfo> &image_infos);
+    // Bindless texture table (binding 2). Textures are written into free slots
+    // and released again while frames are in flight; shaders index the table
+    // with the slot. add_textures returns the first of image_infos.size()
+    // consecutive slots.
+    uint32_t add_textures(const std::vector<VkDescriptorImageInfo> &image_infos);
+    // The slots are reused once the frame being recorded, and so every frame
+    // that may still sample them, has finished (see FrgDeletionQueue). The
+    // images must live that long too.
+    void release_textures(uint32_t first_slot, uint32_t count);
+    // Frees the slots of finished releases; call once per frame
+    void collect_released_textures();
+    uint32_t texture_capacity() const { return texture_slots.getCapacity(); }
+    uint32_t texture_count() const { return texture_slots.getUsedCount(); }
     void write_comp_descriptor_sets(
         std::vector<VkBuffer> &uni_buffers, size_t ubo_size, std::vector<VkBuffer> &shader_storage_buffers,
         size_t ssbo_size
     );
   
-      // Set SSAO texture for the final lighting pass
+      // Set SSAO texture for the final lighting pass. It lives in a set of its own (set 1 of the forward
+    // pipelines), transient per frame, so a new texture (resize) never rewrites a set frames in flight use.
     void setSSAOTexture(VkDescriptorImageInfo ssaoInfo);
+    bool hasSSAOTexture() const { return ssaoEnabled; }
+    VkDescriptorSetLayout ssaoSetLayout() const { return ssao_set_layout; }
+    // Allocates this frame's SSAO set. Call once per frame on the main thread, before recording; the
+    // recording threads then only read ssaoDescriptorSet.
+    void updateSSAODescriptorSet();
+    VkDescriptorSet ssaoDescriptorSet() const { return ssao_descriptor_set; }
 
     void recordComputeCommandBuffer(
         VkCommandBuffer command_buf, VkPipelineLayout pipeline_layout, VkPipeline compute_pipeline, size_t dispatch,
@@ -43,12 +65,29 @@ class FrgDescriptor {
     void create_comp_descriptor_set_layout_binding();
     void create_descriptor_pool();
     void create_descriptor_sets();
-    const uint32_t DEFAULT_POOL_SIZE_INCR = 255; // 255 + 1 SSAO = 256 (device limit)
-    uint32_t texture_descriptor_size = DEFAULT_POOL_SIZE_INCR;
-    uint32_t texture_count = 0;
+    // Upper bound for the table on top of the device limit, to keep the pool
+    // reasonably sized on devices that allow millions of descriptors
+    static constexpr uint32_t MAX_BINDLESS_TEXTURES = 1 << 16;
+    // Other sampled images of the fragment stage: the SSAO texture of the
+    // forward pipelines (set 1) and the G-buffer depth, normal, albedo and
+    // SSAO inputs of the deferred lighting pass
+    static constexpr uint32_t RESERVED_SAMPLED_IMAGES = 1 + 4;
+    static uint32_t bindless_capacity(FrgDevice &device);
+
     FrgDevice &frg_device;
+    FrgSlotAllocator texture_slots;
+    struct TextureRelease {
+        uint64_t value; // FrgDeletionQueue::retireValue at release
+        uint32_t first_slot;
+        uint32_t count;
+    };
+    // Ordered by value
+    std::deque<TextureRelease> texture_releases;
     VkDescriptorSetLayout descriptor_set_layout;
     VkDescriptorSetLayout comp_desc_set_layout;
+    VkDescriptorSetLayout ssao_set_layout;
+    VkDescriptorImageInfo ssao_info{};
+    VkDescriptorSet ssao_descriptor_set = VK_NULL_HANDLE;
     VkDescriptorPool descriptor_pool;
     VkDescriptorSet descriptor_set;
     std::vector<VkDescriptorSet> comp_descriptor_set;
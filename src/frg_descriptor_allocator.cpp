@@ -0,0 +1,224 @@
+#include "frg_descriptor_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace frg {
+
+namespace {
+
+struct PoolRatio {
+  VkDescriptorType type;
+  float perSet;
+};
+
+// Descriptors of each type per set in a new pool; generous for the sampler
+// heavy post-processing layouts
+constexpr std::array<PoolRatio, 6> POOL_RATIOS = {{
+    {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f},
+}};
+
+template <typename T> uint64_t handleBits(T handle) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &handle, sizeof(handle));
+  return bits;
+}
+
+} // namespace
+
+FrgDescriptorAllocator::FrgDescriptorAllocator(VkDevice device)
+    : device{device} {}
+
+FrgDescriptorAllocator::~FrgDescriptorAllocator() {
+  // Destroying a pool frees its sets
+  destroyChain(persistent);
+  for (auto &frame : frames) {
+    destroyChain(frame.pools);
+  }
+}
+
+VkDescriptorSet FrgDescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+  std::lock_guard<std::mutex> lock{mutex};
+  return allocatePersistent(layout);
+}
+
+void FrgDescriptorAllocator::allocate(VkDescriptorSetLayout layout,
+                                      std::vector<VkDescriptorSet> &sets) {
+  std::lock_guard<std::mutex> lock{mutex};
+  for (auto &set : sets) {
+    set = allocatePersistent(layout);
+  }
+}
+
+void FrgDescriptorAllocator::release(VkDescriptorSetLayout layout,
+                                     VkDescriptorSet set) {
+  std::lock_guard<std::mutex> lock{mutex};
+  released[layout].push_back(set);
+}
+
+VkDescriptorSet FrgDescriptorAllocator::getTransient(
+    VkDescriptorSetLayout layout,
+    const std::vector<VkWriteDescriptorSet> &writes) {
+  std::vector<uint64_t> key = makeKey(layout, writes);
+
+  std::lock_guard<std::mutex> lock{mutex};
+  if (frames.size() <= currentFrame) {
+    frames.resize(currentFrame + 1);
+  }
+  FrameData &frame = frames[currentFrame];
+  auto cached = frame.cache.find(key);
+  if (cached != frame.cache.end()) {
+    return cached->second;
+  }
+
+  VkDescriptorSet set = allocateFrom(frame.pools, layout);
+  std::vector<VkWriteDescriptorSet> setWrites = writes;
+  for (auto &write : setWrites) {
+    write.dstSet = set;
+  }
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(setWrites.size()),
+                         setWrites.data(), 0, nullptr);
+  frame.cache.emplace(std::move(key), set);
+  return set;
+}
+
+void FrgDescriptorAllocator::beginFrame(uint32_t frameIndex) {
+  std::lock_guard<std::mutex> lock{mutex};
+  currentFrame = frameIndex;
+  if (frames.size() <= currentFrame) {
+    frames.resize(currentFrame + 1);
+  }
+  FrameData &frame = frames[currentFrame];
+  frame.cache.clear();
+  resetChain(frame.pools);
+}
+
+VkDescriptorSet
+FrgDescriptorAllocator::allocatePersistent(VkDescriptorSetLayout layout) {
+  // Pools are created without FREE_DESCRIPTOR_SET, so released sets are
+  // handed out again as they are; writers overwrite every binding they use
+  auto reusable = released.find(layout);
+  if (reusable != released.end() && !reusable->second.empty()) {
+    VkDescriptorSet set = reusable->second.back();
+    reusable->second.pop_back();
+    return set;
+  }
+  return allocateFrom(persistent, layout);
+}
+
+VkDescriptorSet
+FrgDescriptorAllocator::allocateFrom(PoolChain &chain,
+                                     VkDescriptorSetLayout layout) {
+  if (chain.current == VK_NULL_HANDLE) {
+    chain.current = nextPool(chain);
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = chain.current;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  VkDescriptorSet set;
+  VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+      result == VK_ERROR_FRAGMENTED_POOL) {
+    // Chain a fresh pool and try once more
+    chain.full.push_back(chain.current);
+    chain.current = nextPool(chain);
+    allocInfo.descriptorPool = chain.current;
+    result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate descriptor set!");
+  }
+  return set;
+}
+
+VkDescriptorPool FrgDescriptorAllocator::nextPool(PoolChain &chain) {
+  if (!chain.ready.empty()) {
+    VkDescriptorPool pool = chain.ready.back();
+    chain.ready.pop_back();
+    return pool;
+  }
+
+  std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> poolSizes{};
+  for (size_t i = 0; i < POOL_RATIOS.size(); i++) {
+    poolSizes[i].type = POOL_RATIOS[i].type;
+    poolSizes[i].descriptorCount = std::max(
+        static_cast<uint32_t>(POOL_RATIOS[i].perSet * chain.setsPerPool), 1u);
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = chain.setsPerPool;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+  // The next pool of this chain gets more room
+  chain.setsPerPool = std::min(chain.setsPerPool * 2, MAX_SETS_PER_POOL);
+  return pool;
+}
+
+void FrgDescriptorAllocator::resetChain(PoolChain &chain) {
+  if (chain.current != VK_NULL_HANDLE) {
+    chain.full.push_back(chain.current);
+    chain.current = VK_NULL_HANDLE;
+  }
+  for (VkDescriptorPool pool : chain.full) {
+    vkResetDescriptorPool(device, pool, 0);
+    chain.ready.push_back(pool);
+  }
+  chain.full.clear();
+}
+
+void FrgDescriptorAllocator::destroyChain(PoolChain &chain) {
+  resetChain(chain);
+  for (VkDescriptorPool pool : chain.ready) {
+    vkDestroyDescriptorPool(device, pool, nullptr);
+  }
+  chain.ready.clear();
+}
+
+std::vector<uint64_t> FrgDescriptorAllocator::makeKey(
+    VkDescriptorSetLayout layout,
+    const std::vector<VkWriteDescriptorSet> &writes) {
+  std::vector<uint64_t> key{handleBits(layout)};
+  for (const auto &write : writes) {
+    assert((write.pImageInfo || write.pBufferInfo) &&
+           "Only image and buffer descriptors can be transient");
+    key.push_back(write.dstBinding);
+    key.push_back(write.dstArrayElement);
+    key.push_back(static_cast<uint64_t>(write.descriptorType));
+    for (uint32_t i = 0; i < write.descriptorCount; i++) {
+      if (write.pImageInfo) {
+        const VkDescriptorImageInfo &image = write.pImageInfo[i];
+        key.push_back(handleBits(image.sampler));
+        key.push_back(handleBits(image.imageView));
+        key.push_back(static_cast<uint64_t>(image.imageLayout));
+      } else {
+        const VkDescriptorBufferInfo &buffer = write.pBufferInfo[i];
+        key.push_back(handleBits(buffer.buffer));
+        key.push_back(buffer.offset);
+        key.push_back(buffer.range);
+      }
+    }
+  }
+  return key;
+}
+
+} // namespace frg
@@ -0,0 +1,96 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Descriptor Allocator
+ *
+ * Hands out descriptor sets from chains of pools, so nothing has to size a
+ * pool for its sets up front: when a pool runs out, the next one is created
+ * with twice the room. Pools are sized by a fixed ratio of descriptor types
+ * per set that covers the layouts the renderer uses.
+ *
+ * Two lifetimes:
+ *  - allocate: lives until it is released, for sets written once. A set
+ *    that has to point at new resources is replaced rather than rewritten
+ *    (pending frames may still use it) and the old one released once those
+ *    frames have finished (see FrgDeletionQueue); release keeps it for the
+ *    next allocation with the same layout.
+ *  - getTransient: lives until the same frame slot begins again. Each frame
+ *    slot has its own chain, reset wholesale with vkResetDescriptorPool in
+ *    beginFrame, so per-frame sets never need vkFreeDescriptorSets.
+ *    Transient sets are cached by layout and contents for the rest of the
+ *    frame: asking twice for the same writes returns the same set.
+ *
+ * Safe to call from several threads.
+ */
+class FrgDescriptorAllocator {
+public:
+  explicit FrgDescriptorAllocator(VkDevice device);
+  ~FrgDescriptorAllocator();
+
+  FrgDescriptorAllocator(const FrgDescriptorAllocator &) = delete;
+  FrgDescriptorAllocator &operator=(const FrgDescriptorAllocator &) = delete;
+
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+  // Fills every entry of sets
+  void allocate(VkDescriptorSetLayout layout,
+                std::vector<VkDescriptorSet> &sets);
+  // set must come from allocate with layout and no longer be in use
+  void release(VkDescriptorSetLayout layout, VkDescriptorSet set);
+
+  // A set of layout holding writes (their dstSet is ignored), valid for the
+  // current frame. Only image and buffer descriptors are supported.
+  VkDescriptorSet getTransient(VkDescriptorSetLayout layout,
+                               const std::vector<VkWriteDescriptorSet> &writes);
+
+  // Call once frameIndex was retired; recycles the transient
+  // sets that frame slot handed out last time
+  void beginFrame(uint32_t frameIndex);
+
+private:
+  struct PoolChain {
+    VkDescriptorPool current = VK_NULL_HANDLE;
+    // Pools that ran out; transient chains reuse them after a reset
+    std::vector<VkDescriptorPool> full;
+    std::vector<VkDescriptorPool> ready;
+    uint32_t setsPerPool = INITIAL_SETS_PER_POOL;
+  };
+
+  struct FrameData {
+    PoolChain pools;
+    // Serialized layout and writes -> set
+    std::map<std::vector<uint64_t>, VkDescriptorSet> cache;
+  };
+
+  static constexpr uint32_t INITIAL_SETS_PER_POOL = 32;
+  static constexpr uint32_t MAX_SETS_PER_POOL = 1024;
+
+  VkDescriptorSet allocateFrom(PoolChain &chain, VkDescriptorSetLayout layout);
+  VkDescriptorSet allocatePersistent(VkDescriptorSetLayout layout);
+  VkDescriptorPool nextPool(PoolChain &chain);
+  void resetChain(PoolChain &chain);
+  void destroyChain(PoolChain &chain);
+  static std::vector<uint64_t>
+  makeKey(VkDescriptorSetLayout layout,
+          const std::vector<VkWriteDescriptorSet> &writes);
+
+  VkDevice device;
+  std::mutex mutex;
+  PoolChain persistent;
+  // Released persistent sets by layout
+  std::map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> released;
+  std::vector<FrameData> frames;
+  uint32_t currentFrame = 0;
+};
+
+} // namespace frg
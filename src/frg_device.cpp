@@ -1,8 +1,10 @@
 #include "frg_device.hpp"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
@@ -48,11 +50,27 @@ FrgDevice::FrgDevice(FrgWindow &window) : window{window} {
     createLogicalDevice();
     createCommandPool();
     createTextureSampler();
+    createPipelineCache();
+    descriptorAllocator_ = std::make_unique<FrgDescriptorAllocator>(device_);
+    uploader_ = std::make_unique<FrgUploader>(
+        *this, deviceQueueFamilies.transferFamily, deviceQueueFamilies.graphicsAndComputeFamily, transferQueue_,
+        graphicsQueue_
+    );
+    deletionQueue_ = std::make_unique<FrgDeletionQueue>(device_);
 }
 
 FrgDevice::~FrgDevice() {
+    // Retired objects may hand descriptor sets back to the allocator
+    vkDeviceWaitIdle(device_);
+    deletionQueue_.reset();
+    // Saves the cache while the device is still alive
+    pipelineCompiler_.reset();
+    pipelineCache_.reset();
+    descriptorAllocator_.reset();
+    uploader_.reset();
     vkDestroySampler(device_, texture_sampler, nullptr);
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    vkDestroyCommandPool(device_, computeCommandPool, nullptr);
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers) {
@@ -68,7 +86,7 @@ std::vector<VkCommandBuffer> FrgDevice::createComputeCommandBuffers(size_t buff_
 
     VkCommandBufferAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    alloc_info.commandPool = commandPool;
+    alloc_info.commandPool = computeCommandPool;
     alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     alloc_info.commandBufferCount = static_cast<uint32_t>(buff_count);
 
@@ -90,7 +108,9 @@ void FrgDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for descriptor indexing (bindless textures); 1.3 features (dynamic
+    // rendering) are only used when the device reports 1.3
+    appInfo.apiVersion = VK_API_VERSION_1_3;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -151,13 +171,33 @@ void FrgDevice::pickPhysicalDevice() {
 
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
     std::cout << "physical device: " << properties.deviceName << std::endl;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+    bindlessTextureLimit = std::min(
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages
+    );
 }
 
 void FrgDevice::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    deviceQueueFamilies = indices;
+    if (indices.hasDedicatedCompute()) {
+        std::cout << "async compute queue family: " << indices.computeFamily << std::endl;
+    }
+    if (indices.hasDedicatedTransfer()) {
+        std::cout << "transfer queue family: " << indices.transferFamily << std::endl;
+    }
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsAndComputeFamily, indices.presentFamily};
+    std::set<uint32_t> uniqueQueueFamilies = {
+        indices.graphicsAndComputeFamily, indices.presentFamily, indices.computeFamily, indices.transferFamily
+    };
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -169,9 +209,14 @@ void FrgDevice::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    storageImageExtendedFormats = supportedFeatures.shaderStorageImageExtendedFormats == VK_TRUE;
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.largePoints = VK_TRUE;
+    deviceFeatures.shaderStorageImageExtendedFormats = supportedFeatures.shaderStorageImageExtendedFormats;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -179,9 +224,61 @@ void FrgDevice::createLogicalDevice() {
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+    // Optional: lets the pipeline cache tell hits from misses
+    std::vector<const char *> extensions = deviceExtensions;
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    bool hasPresentId = false;
+    bool hasPresentWait = false;
+    for (const auto &extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME) == 0) {
+            pipelineCreationFeedback = true;
+            extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        }
+        hasPresentId |= strcmp(extension.extensionName, VK_KHR_PRESENT_ID_EXTENSION_NAME) == 0;
+        hasPresentWait |= strcmp(extension.extensionName, VK_KHR_PRESENT_WAIT_EXTENSION_NAME) == 0;
+    }
+
+    // Optional: timestamps presents for the latency monitor (see FrgLatencyMonitor)
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (hasPresentId && hasPresentWait) {
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+        presentWait = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    }
+    if (presentWait) {
+        extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
+    // Optional: render pass-less rendering and synchronization2 barriers (see
+    // FrgRenderTarget and FrgRenderGraph)
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    if (properties.apiVersion >= VK_API_VERSION_1_3) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &vulkan13Features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+        dynamicRendering = vulkan13Features.dynamicRendering && vulkan13Features.synchronization2;
+    }
+    // Only the two features the renderer uses
+    VkPhysicalDeviceVulkan13Features enabledVulkan13Features{};
+    enabledVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    enabledVulkan13Features.dynamicRendering = VK_TRUE;
+    enabledVulkan13Features.synchronization2 = VK_TRUE;
+
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     // might not really be necessary anymore because device specific validation
     // layers have been deprecated
@@ -192,17 +289,48 @@ void FrgDevice::createLogicalDevice() {
         createInfo.enabledLayerCount = 0;
     }
 
+    // Bindless texture table, see FrgDescriptor
     VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features{};
     descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
     descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+    descriptor_indexing_features.runtimeDescriptorArray = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    // Frame pacing, see FrgSwapChain
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features{};
+    timeline_semaphore_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+    descriptor_indexing_features.pNext = &timeline_semaphore_features;
+    if (presentWait) {
+        // Still chained to presentWaitFeatures, both filled in by the query
+        timeline_semaphore_features.pNext = &presentIdFeatures;
+        presentWaitFeatures.pNext = dynamicRendering ? &enabledVulkan13Features : nullptr;
+    } else if (dynamicRendering) {
+        timeline_semaphore_features.pNext = &enabledVulkan13Features;
+    }
     createInfo.pNext = reinterpret_cast<void *>(&descriptor_indexing_features);
     if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device_) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device!");
     }
+    if (presentWait) {
+        waitForPresentKHR =
+            reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR"));
+        presentWait = waitForPresentKHR != nullptr;
+    }
+    if (dynamicRendering) {
+        // Core 1.3 entry points, looked up so older loaders still run the render pass path
+        beginRenderingFn =
+            reinterpret_cast<PFN_vkCmdBeginRendering>(vkGetDeviceProcAddr(device_, "vkCmdBeginRendering"));
+        endRenderingFn = reinterpret_cast<PFN_vkCmdEndRendering>(vkGetDeviceProcAddr(device_, "vkCmdEndRendering"));
+        pipelineBarrier2Fn =
+            reinterpret_cast<PFN_vkCmdPipelineBarrier2>(vkGetDeviceProcAddr(device_, "vkCmdPipelineBarrier2"));
+        dynamicRendering = beginRenderingFn && endRenderingFn && pipelineBarrier2Fn;
+    }
 
     vkGetDeviceQueue(device_, indices.graphicsAndComputeFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
-    vkGetDeviceQueue(device_, indices.graphicsAndComputeFamily, 0, &computeQueue_);
+    vkGetDeviceQueue(device_, indices.computeFamily, 0, &computeQueue_);
+    vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
 }
 
 void FrgDevice::createCommandPool() {
@@ -216,6 +344,16 @@ void FrgDevice::createCommandPool() {
     if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily;
+    if (vkCreateCommandPool(device_, &poolInfo, nullptr, &computeCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute command pool!");
+    }
+}
+
+void FrgDevice::createPipelineCache() {
+    pipelineCache_ = std::make_unique<FrgPipelineCache>(device_, properties, pipelineCreationFeedback);
+    pipelineCompiler_ = std::make_unique<FrgPipelineCompiler>();
 }
 
 void FrgDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
@@ -234,7 +372,44 @@ bool FrgDevice::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+           supportsBindlessTextures(device) && supportsTimelineSemaphores(device);
+}
+
+bool FrgDevice::supportsBindlessTextures(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &indexingFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
+    return indexingFeatures.descriptorBindingPartiallyBound && indexingFeatures.runtimeDescriptorArray &&
+           indexingFeatures.descriptorBindingVariableDescriptorCount &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+}
+
+bool FrgDevice::supportsTimelineSemaphores(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
+    return timelineFeatures.timelineSemaphore;
 }
 
 void FrgDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -349,26 +524,46 @@ QueueFamilyIndices FrgDevice::findQueueFamilies(VkPhysicalDevice device) {
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+    bool dedicatedCompute = false;
+    bool dedicatedTransfer = false;
     int i = 0;
     for (const auto &queueFamily : queueFamilies) {
-        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
-            (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+        if (!indices.graphicsFamilyHasValue && queueFamily.queueCount > 0 &&
+            (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
         {
             indices.graphicsAndComputeFamily = i;
             indices.graphicsFamilyHasValue = true;
         }
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-        if (queueFamily.queueCount > 0 && presentSupport) {
+        if (!indices.presentFamilyHasValue && queueFamily.queueCount > 0 && presentSupport) {
             indices.presentFamily = i;
             indices.presentFamilyHasValue = true;
         }
-        if (indices.isComplete()) {
-            break;
+        // Compute without graphics runs next to the graphics queue on hardware with async compute
+        if (!dedicatedCompute && queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+            !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.computeFamily = i;
+            dedicatedCompute = true;
+        }
+        // Usually the copy engine, which streams uploads without taking time from rendering
+        constexpr VkQueueFlags graphicsOrCompute = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+        if (!dedicatedTransfer && queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+            !(queueFamily.queueFlags & graphicsOrCompute))
+        {
+            indices.transferFamily = i;
+            dedicatedTransfer = true;
         }
 
         i++;
     }
+    if (!dedicatedCompute) {
+        indices.computeFamily = indices.graphicsAndComputeFamily;
+    }
+    if (!dedicatedTransfer) {
+        indices.transferFamily = indices.graphicsAndComputeFamily;
+    }
 
     return indices;
 }
@@ -425,7 +620,7 @@ uint32_t FrgDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pr
 
 void FrgDevice::createBuffer(
     VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory
+    VkDeviceMemory &bufferMemory, bool sharedWithCompute
 ) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -433,6 +628,13 @@ void FrgDevice::createBuffer(
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    uint32_t sharedFamilies[] = {deviceQueueFamilies.graphicsAndComputeFamily, deviceQueueFamilies.computeFamily};
+    if (sharedWithCompute && deviceQueueFamilies.hasDedicatedCompute()) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = sharedFamilies;
+    }
+
     if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create vertex buffer!");
     }
@@ -479,8 +681,16 @@ void FrgDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
+    // Waits for this submit only, not for the frames in flight on the same queue
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create single time command fence!");
+    }
+    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+    vkWaitForFences(device_, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    vkDestroyFence(device_, fence, nullptr);
 
     vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
@@ -543,6 +753,40 @@ void FrgDevice::createImageWithInfo(
     }
 }
 
+void FrgDevice::createAliasedImages(
+    const std::vector<VkImageCreateInfo> &imageInfos, VkMemoryPropertyFlags properties, std::vector<VkImage> &images,
+    VkDeviceMemory &imageMemory
+) {
+    images.resize(imageInfos.size());
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeBits = ~0u;
+    for (size_t i = 0; i < imageInfos.size(); i++) {
+        if (vkCreateImage(device_, &imageInfos[i], nullptr, &images[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image!");
+        }
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device_, images[i], &memRequirements);
+        size = std::max(size, memRequirements.size);
+        memoryTypeBits &= memRequirements.memoryTypeBits;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryTypeBits, properties);
+
+    if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate image memory!");
+    }
+
+    // Every image starts at offset 0, so the alignments are met as well
+    for (VkImage image : images) {
+        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory!");
+        }
+    }
+}
+
 void FrgDevice::createTextureSampler() {
     VkSamplerCreateInfo sampler_info{};
     sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
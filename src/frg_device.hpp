@@ -1,8 +1,14 @@
 #pragma once
 
+#include "frg_deletion_queue.hpp"
+#include "frg_descriptor_allocator.hpp"
+#include "frg_pipeline_cache.hpp"
+#include "frg_pipeline_compiler.hpp"
+#include "frg_uploader.hpp"
 #include "frg_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -17,9 +23,15 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
     uint32_t graphicsAndComputeFamily;
     uint32_t presentFamily;
+    // A compute-only family if the device has one (async compute), otherwise graphicsAndComputeFamily
+    uint32_t computeFamily;
+    // A transfer-only family if the device has one, otherwise graphicsAndComputeFamily
+    uint32_t transferFamily;
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+    bool hasDedicatedCompute() const { return computeFamily != graphicsAndComputeFamily; }
+    bool hasDedicatedTransfer() const { return transferFamily != graphicsAndComputeFamily; }
 };
 
 class FrgDevice {
@@ -40,12 +52,26 @@ class FrgDevice {
     FrgDevice &operator=(FrgDevice &&) = delete;
 
     VkCommandPool getCommandPool() { return commandPool; }
+    // Pool of the compute queue's family
+    VkCommandPool getComputeCommandPool() { return computeCommandPool; }
     VkDevice device() { return device_; }
     VkSampler textureSampler() { return texture_sampler; }
     VkSurfaceKHR surface() { return surface_; }
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
+    // Separate from the graphics queue when the device has an async compute family
     VkQueue computeQueue() { return computeQueue_; }
+    VkQueue transferQueue() { return transferQueue_; }
+    // Shared by every pipeline; persisted to disk across launches
+    FrgPipelineCache &pipelineCache() { return *pipelineCache_; }
+    // Background pipeline builds (see FrgPipeline)
+    FrgPipelineCompiler &pipelineCompiler() { return *pipelineCompiler_; }
+    // Growable pools for every descriptor set except the bindless table
+    FrgDescriptorAllocator &descriptorAllocator() { return *descriptorAllocator_; }
+    // Asynchronous uploads into device-local buffers and images on the transfer queue
+    FrgUploader &uploader() { return *uploader_; }
+    // Destroys replaced resources once the frames using them have finished
+    FrgDeletionQueue &deletionQueue() { return *deletionQueue_; }
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -55,10 +81,13 @@ class FrgDevice {
     );
 
     // Buffer Helper Functions
+    // sharedWithCompute: the graphics and compute queues use the buffer at the same time, so with a dedicated
+    // compute family it is created concurrent between both families instead of exclusive
     void createBuffer(
         VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer,
-        VkDeviceMemory &bufferMemory
+        VkDeviceMemory &bufferMemory, bool sharedWithCompute = false
     );
+    // Blocking graphics-queue commands for startup work the uploader cannot take (see FrgUploader)
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,9 +97,37 @@ class FrgDevice {
         const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image,
         VkDeviceMemory &imageMemory
     );
+    // Creates every image in imageInfos and binds them all to the start of one
+    // allocation large enough for each; only one may hold contents at a time
+    void createAliasedImages(
+        const std::vector<VkImageCreateInfo> &imageInfos, VkMemoryPropertyFlags properties,
+        std::vector<VkImage> &images, VkDeviceMemory &imageMemory
+    );
 
     VkPhysicalDeviceProperties properties;
 
+    VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
+    // Storage images in formats like r8 (compute SSAO output)
+    bool supportsStorageImageExtendedFormats() const { return storageImageExtendedFormats; }
+    // Sampled images one update-after-bind set can hold
+    uint32_t maxBindlessTextures() const { return bindlessTextureLimit; }
+    // VK_KHR_present_id and VK_KHR_present_wait are enabled
+    bool supportsPresentWait() const { return presentWait; }
+    // vkWaitForPresentKHR; only valid if supportsPresentWait()
+    VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout) {
+        return waitForPresentKHR(device_, swapChain, presentId, timeout);
+    }
+
+    // Vulkan 1.3 dynamicRendering and synchronization2 are enabled
+    bool supportsDynamicRendering() const { return dynamicRendering; }
+    // The 1.3 commands; only valid if supportsDynamicRendering()
+    void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo &renderingInfo) {
+        beginRenderingFn(commandBuffer, &renderingInfo);
+    }
+    void cmdEndRendering(VkCommandBuffer commandBuffer) { endRenderingFn(commandBuffer); }
+    PFN_vkCmdPipelineBarrier2 getPipelineBarrier2() const { return pipelineBarrier2Fn; }
+
+    // Allocated from the compute command pool, submit them to computeQueue
     std::vector<VkCommandBuffer> createComputeCommandBuffers(size_t buff_count);
 
   private:
@@ -81,9 +138,14 @@ class FrgDevice {
     void createLogicalDevice();
     void createCommandPool();
     void createTextureSampler();
+    void createPipelineCache();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
+    // Descriptor indexing features the bindless texture table relies on
+    bool supportsBindlessTextures(VkPhysicalDevice device);
+    // Timeline semaphores the swap chain paces frames with
+    bool supportsTimelineSemaphores(VkPhysicalDevice device);
     std::vector<const char *> getRequiredExtensions();
     bool checkValidationLayerSupport();
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
@@ -97,14 +159,32 @@ class FrgDevice {
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     FrgWindow &window;
     VkCommandPool commandPool;
+    VkCommandPool computeCommandPool;
+    // Families the logical device was created with
+    QueueFamilyIndices deviceQueueFamilies;
 
     VkDevice device_;
     VkSurfaceKHR surface_;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
     VkQueue computeQueue_;
+    VkQueue transferQueue_;
 
     VkSampler texture_sampler = VK_NULL_HANDLE;
+    bool storageImageExtendedFormats = false;
+    bool pipelineCreationFeedback = false;
+    bool presentWait = false;
+    PFN_vkWaitForPresentKHR waitForPresentKHR = nullptr;
+    bool dynamicRendering = false;
+    PFN_vkCmdBeginRendering beginRenderingFn = nullptr;
+    PFN_vkCmdEndRendering endRenderingFn = nullptr;
+    PFN_vkCmdPipelineBarrier2 pipelineBarrier2Fn = nullptr;
+    uint32_t bindlessTextureLimit = 0;
+    std::unique_ptr<FrgPipelineCache> pipelineCache_;
+    std::unique_ptr<FrgPipelineCompiler> pipelineCompiler_;
+    std::unique_ptr<FrgDescriptorAllocator> descriptorAllocator_;
+    std::unique_ptr<FrgUploader> uploader_;
+    std::unique_ptr<FrgDeletionQueue> deletionQueue_;
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> deviceExtensions = [] {
@@ -5,7 +5,8 @@
 
 namespace frg {
 
-FrgGBuffer::FrgGBuffer(FrgDevice &device, VkExtent2D extent)
+FrgGBuffer::FrgGBuffer(FrgDevice &device, VkExtent2D extent,
+                       bool dynamicRendering)
     : device{device}, extent{extent} {
   // Find depth format
   depthFormat = device.findSupportedFormat(
@@ -16,29 +17,37 @@ FrgGBuffer::FrgGBuffer(FrgDevice &device, VkExtent2D extent)
   createImages();
   createImageViews();
   createSampler();
-  createRenderPass();
-  createFramebuffer();
+  if (!dynamicRendering) {
+    createRenderPass();
+  }
+  createTarget();
 }
 
 FrgGBuffer::~FrgGBuffer() { cleanup(); }
 
 void FrgGBuffer::resize(VkExtent2D newExtent) {
-  vkDeviceWaitIdle(device.device());
-  cleanup();
+  // The render pass and sampler do not depend on the size
+  retireTargets();
   extent = newExtent;
   createImages();
   createImageViews();
-  createSampler();
-  createRenderPass();
-  createFramebuffer();
+  createTarget();
+}
+
+void FrgGBuffer::retireTargets() {
+  FrgDeletionQueue &queue = device.deletionQueue();
+  queue.retireFramebuffer(target.framebuffer);
+  queue.retireImage(normalImage, normalMemory, normalImageView);
+  queue.retireImage(albedoImage, albedoMemory, albedoImageView);
+  queue.retireImage(depthImage, depthMemory, depthImageView);
 }
 
 void FrgGBuffer::cleanup() {
   VkDevice dev = device.device();
 
-  if (framebuffer != VK_NULL_HANDLE) {
-    vkDestroyFramebuffer(dev, framebuffer, nullptr);
-    framebuffer = VK_NULL_HANDLE;
+  if (target.framebuffer != VK_NULL_HANDLE) {
+    vkDestroyFramebuffer(dev, target.framebuffer, nullptr);
+    target.framebuffer = VK_NULL_HANDLE;
   }
   if (renderPass != VK_NULL_HANDLE) {
     vkDestroyRenderPass(dev, renderPass, nullptr);
@@ -49,20 +58,6 @@ void FrgGBuffer::cleanup() {
     sampler = VK_NULL_HANDLE;
   }
 
-  // Cleanup position
-  if (positionImageView != VK_NULL_HANDLE) {
-    vkDestroyImageView(dev, positionImageView, nullptr);
-    positionImageView = VK_NULL_HANDLE;
-  }
-  if (positionImage != VK_NULL_HANDLE) {
-    vkDestroyImage(dev, positionImage, nullptr);
-    positionImage = VK_NULL_HANDLE;
-  }
-  if (positionMemory != VK_NULL_HANDLE) {
-    vkFreeMemory(dev, positionMemory, nullptr);
-    positionMemory = VK_NULL_HANDLE;
-  }
-
   // Cleanup normal
   if (normalImageView != VK_NULL_HANDLE) {
     vkDestroyImageView(dev, normalImageView, nullptr);
@@ -77,6 +72,20 @@ void FrgGBuffer::cleanup() {
     normalMemory = VK_NULL_HANDLE;
   }
 
+  // Cleanup albedo
+  if (albedoImageView != VK_NULL_HANDLE) {
+    vkDestroyImageView(dev, albedoImageView, nullptr);
+    albedoImageView = VK_NULL_HANDLE;
+  }
+  if (albedoImage != VK_NULL_HANDLE) {
+    vkDestroyImage(dev, albedoImage, nullptr);
+    albedoImage = VK_NULL_HANDLE;
+  }
+  if (albedoMemory != VK_NULL_HANDLE) {
+    vkFreeMemory(dev, albedoMemory, nullptr);
+    albedoMemory = VK_NULL_HANDLE;
+  }
+
   // Cleanup depth
   if (depthImageView != VK_NULL_HANDLE) {
     vkDestroyImageView(dev, depthImageView, nullptr);
@@ -93,7 +102,7 @@ void FrgGBuffer::cleanup() {
 }
 
 void FrgGBuffer::createImages() {
-  // Position image
+  // Normal image
   {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -103,7 +112,7 @@ void FrgGBuffer::createImages() {
     imageInfo.extent.depth = 1;
     imageInfo.mipLevels = 1;
     imageInfo.arrayLayers = 1;
-    imageInfo.format = POSITION_FORMAT;
+    imageInfo.format = NORMAL_FORMAT;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage =
@@ -112,10 +121,10 @@ void FrgGBuffer::createImages() {
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                               positionImage, positionMemory);
+                               normalImage, normalMemory);
   }
 
-  // Normal image
+  // Albedo image
   {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -125,7 +134,7 @@ void FrgGBuffer::createImages() {
     imageInfo.extent.depth = 1;
     imageInfo.mipLevels = 1;
     imageInfo.arrayLayers = 1;
-    imageInfo.format = NORMAL_FORMAT;
+    imageInfo.format = ALBEDO_FORMAT;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage =
@@ -134,7 +143,7 @@ void FrgGBuffer::createImages() {
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                               normalImage, normalMemory);
+                               albedoImage, albedoMemory);
   }
 
   // Depth image
@@ -161,13 +170,13 @@ void FrgGBuffer::createImages() {
 }
 
 void FrgGBuffer::createImageViews() {
-  // Position image view
+  // Normal image view
   {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = positionImage;
+    viewInfo.image = normalImage;
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = POSITION_FORMAT;
+    viewInfo.format = NORMAL_FORMAT;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
     viewInfo.subresourceRange.levelCount = 1;
@@ -175,19 +184,18 @@ void FrgGBuffer::createImageViews() {
     viewInfo.subresourceRange.layerCount = 1;
 
     if (vkCreateImageView(device.device(), &viewInfo, nullptr,
-                          &positionImageView) != VK_SUCCESS) {
-      throw std::runtime_error(
-          "Failed to create G-buffer position image view!");
+                          &normalImageView) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create G-buffer normal image view!");
     }
   }
 
-  // Normal image view
+  // Albedo image view
   {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = normalImage;
+    viewInfo.image = albedoImage;
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = NORMAL_FORMAT;
+    viewInfo.format = ALBEDO_FORMAT;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
     viewInfo.subresourceRange.levelCount = 1;
@@ -195,8 +203,8 @@ void FrgGBuffer::createImageViews() {
     viewInfo.subresourceRange.layerCount = 1;
 
     if (vkCreateImageView(device.device(), &viewInfo, nullptr,
-                          &normalImageView) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create G-buffer normal image view!");
+                          &albedoImageView) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create G-buffer albedo image view!");
     }
   }
 
@@ -246,18 +254,7 @@ void FrgGBuffer::createSampler() {
 }
 
 void FrgGBuffer::createRenderPass() {
-  // Attachment 0: Position (color)
-  VkAttachmentDescription positionAttachment{};
-  positionAttachment.format = POSITION_FORMAT;
-  positionAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-  positionAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  positionAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-  positionAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-  positionAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  positionAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  positionAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-  // Attachment 1: Normal (color)
+  // Attachment 0: Normal (color)
   VkAttachmentDescription normalAttachment{};
   normalAttachment.format = NORMAL_FORMAT;
   normalAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -265,10 +262,23 @@ void FrgGBuffer::createRenderPass() {
   normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   normalAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   normalAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  normalAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  normalAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-  // Attachment 2: Depth
+  // The attachments stay in their attachment layouts; FrgRenderGraph
+  // transitions them for the readers
+  normalAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  normalAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  // Attachment 1: Albedo (color)
+  VkAttachmentDescription albedoAttachment{};
+  albedoAttachment.format = ALBEDO_FORMAT;
+  albedoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  albedoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  albedoAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  albedoAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  // Attachment 2: Depth (sampled afterwards for position reconstruction)
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = depthFormat;
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -276,8 +286,10 @@ void FrgGBuffer::createRenderPass() {
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthAttachment.initialLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.finalLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
   // Color attachment references
   std::array<VkAttachmentReference, 2> colorRefs{};
@@ -298,33 +310,8 @@ void FrgGBuffer::createRenderPass() {
   subpass.pColorAttachments = colorRefs.data();
   subpass.pDepthStencilAttachment = &depthRef;
 
-  // Subpass dependencies for layout transitions
-  std::array<VkSubpassDependency, 2> dependencies{};
-
-  // Before G-buffer pass
-  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependencies[0].dstSubpass = 0;
-  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-  dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-  // After G-buffer pass (for reading in SSAO pass)
-  dependencies[1].srcSubpass = 0;
-  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
   std::array<VkAttachmentDescription, 3> attachments = {
-      positionAttachment, normalAttachment, depthAttachment};
+      normalAttachment, albedoAttachment, depthAttachment};
 
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -332,8 +319,6 @@ void FrgGBuffer::createRenderPass() {
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
                          &renderPass) != VK_SUCCESS) {
@@ -341,8 +326,47 @@ void FrgGBuffer::createRenderPass() {
   }
 }
 
-void FrgGBuffer::createFramebuffer() {
-  std::array<VkImageView, 3> attachments = {positionImageView, normalImageView,
+FrgGBuffer::GraphImages FrgGBuffer::importImages(FrgRenderGraph &graph) const {
+  // Rewritten every frame; earlier frames read them in the SSAO and
+  // lighting passes and test against the depth in the scene pass
+  constexpr VkPipelineStageFlags SHADER_STAGES =
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  GraphImages images{};
+  images.normal = graph.importImage("gbuffer normal", normalImage,
+                                    VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, SHADER_STAGES);
+  images.albedo = graph.importImage("gbuffer albedo", albedoImage,
+                                    VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, SHADER_STAGES);
+  // Layout transitions cover the stencil of combined formats as well
+  VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+  if (depthFormat != VK_FORMAT_D32_SFLOAT) {
+    depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+  images.depth = graph.importImage(
+      "gbuffer depth", depthImage, depthAspect, VK_IMAGE_LAYOUT_UNDEFINED,
+      SHADER_STAGES | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+          VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+  return images;
+}
+
+void FrgGBuffer::createTarget() {
+  target.renderPass = renderPass;
+  target.extent = extent;
+  target.colorCount = 2;
+  target.colorViews[0] = normalImageView;
+  target.colorFormats[0] = NORMAL_FORMAT;
+  target.colorViews[1] = albedoImageView;
+  target.colorFormats[1] = ALBEDO_FORMAT;
+  target.depthView = depthImageView;
+  target.depthFormat = depthFormat;
+  target.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  if (target.isDynamic()) {
+    return;
+  }
+
+  std::array<VkImageView, 3> attachments = {normalImageView, albedoImageView,
                                             depthImageView};
 
   VkFramebufferCreateInfo framebufferInfo{};
@@ -355,23 +379,23 @@ void FrgGBuffer::createFramebuffer() {
   framebufferInfo.layers = 1;
 
   if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr,
-                          &framebuffer) != VK_SUCCESS) {
+                          &target.framebuffer) != VK_SUCCESS) {
     throw std::runtime_error("Failed to create G-buffer framebuffer!");
   }
 }
 
-VkDescriptorImageInfo FrgGBuffer::getPositionDescriptor() const {
+VkDescriptorImageInfo FrgGBuffer::getNormalDescriptor() const {
   VkDescriptorImageInfo info{};
   info.sampler = sampler;
-  info.imageView = positionImageView;
+  info.imageView = normalImageView;
   info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
   return info;
 }
 
-VkDescriptorImageInfo FrgGBuffer::getNormalDescriptor() const {
+VkDescriptorImageInfo FrgGBuffer::getAlbedoDescriptor() const {
   VkDescriptorImageInfo info{};
   info.sampler = sampler;
-  info.imageView = normalImageView;
+  info.imageView = albedoImageView;
   info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
   return info;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "frg_device.hpp"
+#include "frg_render_graph.hpp"
+#include "frg_render_target.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -14,35 +16,59 @@ namespace frg {
  * G-Buffer for deferred rendering / SSAO
  *
  * Contains:
- * - Position texture (view-space, RGBA16F)
- * - Normal texture (view-space, RGBA16F)
+ * - Normal texture (view-space, octahedral-encoded into RG16F)
+ * - Albedo texture (RGBA8 sRGB, alpha marks covered pixels; deferred mode only)
  * - Depth texture (reuses existing depth format)
+ *
+ * There is no position target: readers reconstruct view-space position from
+ * depth and the camera projection (see shaders/gbuffer_common.glsl).
+ * Background pixels keep the depth clear value of 1.0.
+ *
+ * The render pass is recorded through FrgRenderGraph: the targets are
+ * written as attachments and transitioned for their readers by the graph.
+ * With dynamic rendering there is no render pass or framebuffer at all;
+ * getTarget() renders straight to the image views.
  */
 class FrgGBuffer {
 public:
-  FrgGBuffer(FrgDevice &device, VkExtent2D extent);
+  // Two-channel octahedral normal; also used by the downsampled SSAO targets
+  static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+
+  // dynamicRendering: requires FrgDevice::supportsDynamicRendering()
+  FrgGBuffer(FrgDevice &device, VkExtent2D extent,
+             bool dynamicRendering = false);
   ~FrgGBuffer();
 
   FrgGBuffer(const FrgGBuffer &) = delete;
   FrgGBuffer &operator=(const FrgGBuffer &) = delete;
 
-  // Recreate G-buffer for new window size
+  // Recreate the targets for a new size. The old ones are destroyed once the
+  // frames in flight are done with them; views handed out before are stale.
   void resize(VkExtent2D newExtent);
 
+  struct GraphImages {
+    FrgRenderGraph::Resource normal;
+    FrgRenderGraph::Resource albedo;
+    FrgRenderGraph::Resource depth;
+  };
+  GraphImages importImages(FrgRenderGraph &graph) const;
+
+  // Normal, albedo and depth, cleared on load
+  const FrgRenderTarget &getTarget() const { return target; }
+
   // Accessors
-  VkRenderPass getRenderPass() const { return renderPass; }
-  VkFramebuffer getFramebuffer() const { return framebuffer; }
   VkExtent2D getExtent() const { return extent; }
+  VkFormat getDepthFormat() const { return depthFormat; }
 
-  VkImageView getPositionImageView() const { return positionImageView; }
   VkImageView getNormalImageView() const { return normalImageView; }
+  VkImageView getAlbedoImageView() const { return albedoImageView; }
   VkImageView getDepthImageView() const { return depthImageView; }
 
   VkSampler getSampler() const { return sampler; }
 
   // Descriptor info for sampling in shaders
-  VkDescriptorImageInfo getPositionDescriptor() const;
   VkDescriptorImageInfo getNormalDescriptor() const;
+  VkDescriptorImageInfo getAlbedoDescriptor() const;
   VkDescriptorImageInfo getDepthDescriptor() const;
 
 private:
@@ -50,34 +76,35 @@ private:
   void createImageViews();
   void createSampler();
   void createRenderPass();
-  void createFramebuffer();
+  void createTarget();
+  void retireTargets();
   void cleanup();
 
   FrgDevice &device;
   VkExtent2D extent;
 
-  // Position attachment (view-space positions)
-  VkImage positionImage = VK_NULL_HANDLE;
-  VkDeviceMemory positionMemory = VK_NULL_HANDLE;
-  VkImageView positionImageView = VK_NULL_HANDLE;
-
   // Normal attachment (view-space normals)
   VkImage normalImage = VK_NULL_HANDLE;
   VkDeviceMemory normalMemory = VK_NULL_HANDLE;
   VkImageView normalImageView = VK_NULL_HANDLE;
 
+  // Albedo attachment (written only by the deferred G-buffer pipeline)
+  VkImage albedoImage = VK_NULL_HANDLE;
+  VkDeviceMemory albedoMemory = VK_NULL_HANDLE;
+  VkImageView albedoImageView = VK_NULL_HANDLE;
+
   // Depth attachment
   VkImage depthImage = VK_NULL_HANDLE;
   VkDeviceMemory depthMemory = VK_NULL_HANDLE;
   VkImageView depthImageView = VK_NULL_HANDLE;
 
   VkSampler sampler = VK_NULL_HANDLE;
+  // VK_NULL_HANDLE with dynamic rendering
   VkRenderPass renderPass = VK_NULL_HANDLE;
-  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+  FrgRenderTarget target;
 
   // Formats
-  static constexpr VkFormat POSITION_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
-  static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+  static constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
   VkFormat depthFormat;
 };
 
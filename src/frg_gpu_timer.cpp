@@ -0,0 +1,75 @@
+#include "frg_gpu_timer.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace frg {
+
+FrgGpuTimer::FrgGpuTimer(FrgDevice &device, uint32_t frameCount)
+    : device{device}, pending(frameCount, false) {
+  // Timestamps must be supported on the graphics/compute queue
+  if (!device.properties.limits.timestampComputeAndGraphics) {
+    return;
+  }
+  timestampPeriodNs =
+      static_cast<double>(device.properties.limits.timestampPeriod);
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = frameCount * 2; // begin + end per frame
+
+  if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &queryPool) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create timestamp query pool!");
+  }
+}
+
+FrgGpuTimer::~FrgGpuTimer() {
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device.device(), queryPool, nullptr);
+  }
+}
+
+void FrgGpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!isSupported()) {
+    return;
+  }
+
+  uint32_t first = frameIndex * 2;
+  vkCmdResetQueryPool(commandBuffer, queryPool, first, 2);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                      queryPool, first);
+}
+
+void FrgGpuTimer::end(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!isSupported()) {
+    return;
+  }
+
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                      queryPool, frameIndex * 2 + 1);
+  pending[frameIndex] = true;
+}
+
+bool FrgGpuTimer::resolve(uint32_t frameIndex, double &milliseconds) {
+  if (!isSupported() || !pending[frameIndex]) {
+    return false;
+  }
+
+  // The frame has been retired, so the results are available
+  std::array<uint64_t, 2> timestamps{};
+  if (vkGetQueryPoolResults(device.device(), queryPool, frameIndex * 2, 2,
+                            sizeof(timestamps), timestamps.data(),
+                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) !=
+      VK_SUCCESS) {
+    return false;
+  }
+  pending[frameIndex] = false;
+
+  milliseconds = static_cast<double>(timestamps[1] - timestamps[0]) *
+                 timestampPeriodNs / 1.0e6;
+  return true;
+}
+
+} // namespace frg
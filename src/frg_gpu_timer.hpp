@@ -0,0 +1,49 @@
+#pragma once
+
+#include "frg_device.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <vector>
+
+namespace frg {
+
+/**
+ * GPU Timer
+ *
+ * Measures the GPU time of one section of a frame with a pair of timestamp
+ * queries per frame in flight. A slot is only read back after the renderer
+ * has waited for that frame to retire, so reading never stalls.
+ *
+ * Usage per frame (after FrgRenderer::beginFrame):
+ *   timer.resolve(frameIndex, ms);  // previous result of this slot
+ *   timer.begin(commandBuffer, frameIndex);
+ *   ... commands to measure ...
+ *   timer.end(commandBuffer, frameIndex);
+ */
+class FrgGpuTimer {
+public:
+  FrgGpuTimer(FrgDevice &device, uint32_t frameCount);
+  ~FrgGpuTimer();
+
+  FrgGpuTimer(const FrgGpuTimer &) = delete;
+  FrgGpuTimer &operator=(const FrgGpuTimer &) = delete;
+
+  bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+
+  void begin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+  void end(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  // Returns false if nothing was recorded in this slot since the last call
+  bool resolve(uint32_t frameIndex, double &milliseconds);
+
+private:
+  FrgDevice &device;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  double timestampPeriodNs = 1.0;
+  std::vector<bool> pending;
+};
+
+} // namespace frg
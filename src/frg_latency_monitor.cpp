@@ -0,0 +1,156 @@
+#include "frg_latency_monitor.hpp"
+
+#include "frg_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+namespace frg {
+
+namespace {
+
+double toMilliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double average(const std::vector<double> &values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+} // namespace
+
+FrgLatencyMonitor::FrgLatencyMonitor(bool presentWait)
+    : presentWait{presentWait} {
+  latencies.reserve(REPORT_INTERVAL);
+  intervals.reserve(REPORT_INTERVAL);
+  if (presentWait) {
+    waiter = std::thread{&FrgLatencyMonitor::waiterLoop, this};
+  }
+}
+
+FrgLatencyMonitor::~FrgLatencyMonitor() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  pendingReady.notify_all();
+  if (waiter.joinable()) {
+    waiter.join();
+  }
+}
+
+void FrgLatencyMonitor::markInputSample() { inputTime = Clock::now(); }
+
+uint64_t FrgLatencyMonitor::nextPresentId() {
+  return presentWait ? ++presentCounter : 0;
+}
+
+void FrgLatencyMonitor::presented(uint64_t presentId) {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (presentId == 0) {
+    record(inputTime, Clock::now());
+    return;
+  }
+  pending.push_back({presentId, inputTime});
+  pendingReady.notify_one();
+}
+
+void FrgLatencyMonitor::setSwapChain(FrgSwapChain *newSwapChain) {
+  std::unique_lock<std::mutex> lock{mutex};
+  pending.clear();
+  swapChain = newSwapChain;
+  // The interval across a recreation is not a present interval
+  hasLastPresent = false;
+  waiterIdle.wait(lock, [this] { return !waiting; });
+}
+
+void FrgLatencyMonitor::waiterLoop() {
+  while (true) {
+    Pending next;
+    FrgSwapChain *target;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      pendingReady.wait(lock, [this] {
+        return stopping || (swapChain != nullptr && !pending.empty());
+      });
+      if (stopping) {
+        return;
+      }
+      next = pending.front();
+      target = swapChain;
+      waiting = true;
+    }
+
+    VkResult result = target->waitForPresent(next.presentId, WAIT_SLICE_NS);
+    Clock::time_point now = Clock::now();
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      waiting = false;
+      // setSwapChain may have dropped the entry in the meantime
+      bool current = !pending.empty() &&
+                     pending.front().presentId == next.presentId;
+      if (current && result != VK_TIMEOUT) {
+        pending.pop_front();
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+          record(next.inputTime, now);
+        }
+      }
+    }
+    waiterIdle.notify_all();
+  }
+}
+
+void FrgLatencyMonitor::record(Clock::time_point sampleTime,
+                               Clock::time_point presentTime) {
+  latencies.push_back(toMilliseconds(presentTime - sampleTime));
+  if (hasLastPresent) {
+    intervals.push_back(toMilliseconds(presentTime - lastPresentTime));
+  }
+  lastPresentTime = presentTime;
+  hasLastPresent = true;
+}
+
+void FrgLatencyMonitor::report() {
+  std::vector<double> latencyWindow;
+  std::vector<double> intervalWindow;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (latencies.size() < REPORT_INTERVAL) {
+      return;
+    }
+    latencyWindow.swap(latencies);
+    intervalWindow.swap(intervals);
+    latencies.reserve(REPORT_INTERVAL);
+    intervals.reserve(REPORT_INTERVAL);
+  }
+
+  double averageLatency = average(latencyWindow);
+  std::sort(latencyWindow.begin(), latencyWindow.end());
+  size_t p99Index = (latencyWindow.size() * 99) / 100;
+  double p99Latency =
+      latencyWindow[std::min(p99Index, latencyWindow.size() - 1)];
+
+  double averageInterval = average(intervalWindow);
+  double variance = 0.0;
+  for (double interval : intervalWindow) {
+    variance += (interval - averageInterval) * (interval - averageInterval);
+  }
+  if (!intervalWindow.empty()) {
+    variance /= intervalWindow.size();
+  }
+
+  std::cout << "Latency (" << (presentWait ? "present wait" : "CPU present")
+            << "): input to present " << averageLatency << " ms avg, "
+            << p99Latency << " ms p99; present interval " << averageInterval
+            << " ms avg, " << std::sqrt(variance) << " ms jitter"
+            << std::endl;
+}
+
+} // namespace frg
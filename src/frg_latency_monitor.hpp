@@ -0,0 +1,99 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace frg {
+
+class FrgSwapChain;
+
+/**
+ * Latency Monitor
+ *
+ * Measures how long a frame takes from the moment its input was sampled until
+ * it is presented, and how evenly presents are spaced (the present interval
+ * and its standard deviation, the jitter).
+ *
+ * With VK_KHR_present_wait every present carries an id and a waiter thread
+ * blocks on vkWaitForPresentKHR, so the present time is the time the image
+ * reached the display. The waiter sleeps on a condition variable while no
+ * present is outstanding and lets acquire and present go first (see
+ * FrgSwapChain::waitForPresent), so the frame loop never queues behind it
+ * for more than one WAIT_SLICE_NS. Without it the present time is taken on the CPU when
+ * vkQueuePresentKHR returns, which leaves out GPU and scan-out time and is a
+ * lower bound of the real latency.
+ *
+ * report() prints a summary every REPORT_INTERVAL presents.
+ */
+class FrgLatencyMonitor {
+public:
+  static constexpr uint32_t REPORT_INTERVAL = 600;
+
+  // presentWait: whether the device has VK_KHR_present_wait enabled
+  explicit FrgLatencyMonitor(bool presentWait);
+  ~FrgLatencyMonitor();
+
+  FrgLatencyMonitor(const FrgLatencyMonitor &) = delete;
+  FrgLatencyMonitor &operator=(const FrgLatencyMonitor &) = delete;
+
+  // Call right after polling input for a frame
+  void markInputSample();
+
+  // Id to present the next frame with, 0 when present times come from the
+  // CPU
+  uint64_t nextPresentId();
+  // Call right after the frame was handed to the presentation engine
+  void presented(uint64_t presentId);
+
+  // Swap chain the waiter thread waits on. Drops the presents still pending
+  // and returns once the waiter no longer uses the previous swap chain, so
+  // pass nullptr before destroying it.
+  void setSwapChain(FrgSwapChain *swapChain);
+
+  // Prints and resets the statistics once enough presents were measured
+  void report();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Pending {
+    uint64_t presentId;
+    Clock::time_point inputTime;
+  };
+
+  // Timeout of a single vkWaitForPresentKHR call. An acquire or present that
+  // arrives while the waiter holds the swap chain waits for at most this
+  // long, and the waiter does not wait again until it is done.
+  static constexpr uint64_t WAIT_SLICE_NS = 1'000'000;
+
+  void waiterLoop();
+  // Caller holds mutex
+  void record(Clock::time_point inputTime, Clock::time_point presentTime);
+
+  bool presentWait;
+  Clock::time_point inputTime = Clock::now();
+  uint64_t presentCounter = 0;
+
+  std::thread waiter;
+  std::mutex mutex;
+  std::condition_variable pendingReady;
+  std::condition_variable waiterIdle;
+  std::deque<Pending> pending;
+  FrgSwapChain *swapChain = nullptr;
+  bool waiting = false;
+  bool stopping = false;
+
+  // Milliseconds, since the last report
+  std::vector<double> latencies;
+  std::vector<double> intervals;
+  Clock::time_point lastPresentTime;
+  bool hasLastPresent = false;
+};
+
+} // namespace frg
@@ -14,20 +14,6 @@ Texture::Texture(FrgDevice &device, const std::string &type, const std::string &
     if (!pixels) {
         throw std::runtime_error("failed to load texture image!");
     }
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    device.createBuffer(
-        image_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer,
-        staging_buffer_memory
-    );
-    void *data;
-    vkMapMemory(device.device(), staging_buffer_memory, 0, image_size, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(image_size));
-    vkUnmapMemory(device.device(), staging_buffer_memory);
-    stbi_image_free(pixels);
 
     VkImageCreateInfo image_info{};
     image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -45,27 +31,14 @@ Texture::Texture(FrgDevice &device, const std::string &type, const std::string &
     image_info.samples = VK_SAMPLE_COUNT_1_BIT;
 
     device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image, texture_image_memory);
-    transition_image_layout(
-        texture_image,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
-    device.copyBufferToImage(
-        staging_buffer,
+    device.uploader().uploadImage(
         texture_image,
+        pixels,
+        image_size,
         static_cast<uint32_t>(tex_width),
-        static_cast<uint32_t>(tex_height),
-        1
-    );
-    transition_image_layout(
-        texture_image,
-        VK_FORMAT_R8G8B8_SRGB,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        static_cast<uint32_t>(tex_height)
     );
-    vkDestroyBuffer(device.device(), staging_buffer, nullptr);
-    vkFreeMemory(device.device(), staging_buffer_memory, nullptr);
+    stbi_image_free(pixels);
 
     VkImageViewCreateInfo view_info{};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -82,7 +55,6 @@ Texture::Texture(FrgDevice &device, const std::string &type, const std::string &
         throw std::runtime_error("failed to create texture image view!");
     }
 
-    texture_idx = LoadedTextures::assign_texture_idx(path);
     create_descriptor_image_info();
 }
 
@@ -92,65 +64,12 @@ void Texture::create_descriptor_image_info() {
     descriptor_image_info.sampler = device.textureSampler();
 }
 
-void Texture::transition_image_layout(
-    VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout
-) {
-
-    VkCommandBuffer command_buffer = device.beginSingleTimeCommands();
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = old_layout;
-    barrier.newLayout = new_layout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags source_stage;
-    VkPipelineStageFlags dst_stage;
-
-    if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (
-        old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    )
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        throw std::invalid_argument("unsupported layout transition!");
-    }
-
-    vkCmdPipelineBarrier(command_buffer, source_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    device.endSingleTimeCommands(command_buffer);
-}
-
 Texture::~Texture() {
     vkDestroyImageView(device.device(), texture_image_view, nullptr);
     vkDestroyImage(device.device(), texture_image, nullptr);
     vkFreeMemory(device.device(), texture_image_memory, nullptr);
 }
 
-uint32_t LoadedTextures::assign_texture_idx(const std::string &path) {
-    if (loaded_texture_names.find(path) != loaded_texture_names.end()) {
-        return loaded_texture_names[path];
-    }
-    loaded_texture_names.insert({path, texture_cntr++});
-    return loaded_texture_names[path];
-}
-
 std::vector<VkVertexInputBindingDescription> Vertex::get_binding_descriptions() {
     std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
     binding_descriptions[0].binding = 0;
@@ -251,47 +170,39 @@ void FrgMesh::create_vertex_buffer(VkBuffer &buffer, VkDeviceMemory &buffer_memo
     VkDeviceSize buffer_size = sizeof(vertices[0]) * vertex_count;
     frg_device.createBuffer(
         buffer_size,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         buffer,
         buffer_memory
     );
 
-    void *data;
-    vkMapMemory(frg_device.device(), vertex_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-    vkUnmapMemory(frg_device.device(), vertex_buffer_memory);
+    frg_device.uploader().uploadBuffer(
+        buffer,
+        vertices.data(),
+        buffer_size,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+    );
 }
 
 void FrgMesh::create_index_buffer(VkBuffer &buffer, VkDeviceMemory &buffer_memory) {
     VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
 
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_memory;
-    frg_device.createBuffer(
-        buffer_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        staging_buffer,
-        staging_memory
-    );
-    void *data;
-    vkMapMemory(frg_device.device(), staging_memory, 0, buffer_size, 0, &data);
-    memcpy(data, indices.data(), static_cast<size_t>(buffer_size));
-    vkUnmapMemory(frg_device.device(), staging_memory);
-
     frg_device.createBuffer(
         buffer_size,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        index_buffer,
-        index_buffer_memory
+        buffer,
+        buffer_memory
     );
 
-    frg_device.copyBuffer(staging_buffer, index_buffer, buffer_size);
-
-    vkDestroyBuffer(frg_device.device(), staging_buffer, nullptr);
-    vkFreeMemory(frg_device.device(), staging_memory, nullptr);
+    frg_device.uploader().uploadBuffer(
+        buffer,
+        indices.data(),
+        buffer_size,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_ACCESS_INDEX_READ_BIT
+    );
 }
 
 } // namespace frg
\ No newline at end of file
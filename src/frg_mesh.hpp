@@ -4,7 +4,6 @@
 
 #include <array>
 #include <glm/glm.hpp>
-#include <map>
 #include <memory>
 #include <optional>
 #include <stdexcept>
@@ -24,32 +23,24 @@ struct Vertex {
     static std::array<VkVertexInputAttributeDescription, 4> get_attribute_descriptions();
 };
 
-class LoadedTextures {
-  public:
-    static uint32_t assign_texture_idx(const std::string &path);
-
-  private:
-    inline static uint32_t texture_cntr = 0;
-    inline static std::map<std::string, uint32_t> loaded_texture_names{};
-};
-
 class Texture {
   public:
     Texture(FrgDevice &device, const std::string &type, const std::string &path);
     ~Texture();
     Texture(const Texture &) = delete;
     Texture &operator=(const Texture &) = delete;
-    void transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
     std::string type;
     std::string path;
 
     VkDescriptorImageInfo descriptor_image_info;
+    // Slot in the bindless texture table, assigned by FrgModel::register_textures
     uint32_t textureIdx() { return texture_idx; }
+    void setTextureIdx(uint32_t idx) { texture_idx = idx; }
 
   private:
     void create_descriptor_image_info();
 
-    uint32_t texture_idx;
+    uint32_t texture_idx = 0;
 
     FrgDevice &device;
     VkImage texture_image;
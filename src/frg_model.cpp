@@ -3,16 +3,30 @@
 namespace frg {
 FrgModel::FrgModel(FrgDevice &device, const std::string &path) : frg_device(device) { load_model(path); }
 void FrgModel::draw(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, SimplePushConstantData push) {
+    draw(command_buffer, pipeline_layout, push, nullptr);
+}
+
+void FrgModel::draw(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, SimplePushConstantData push,
+                    const std::function<void(MeshMaterial)> &bindMaterial) {
+    std::optional<MeshMaterial> boundMaterial;
     for (const auto &mesh : meshes) {
+        // The texture index describes this mesh only, it must not carry over to the next
+        MeshMaterial material = MeshMaterial::Untextured;
+        push.texture_idx = 0;
         std::optional<uint32_t> tex_idx = mesh->getTextureIndex();
         if (tex_idx.has_value()) {
             push.texture_idx = static_cast<int>(tex_idx.value());
-            push.flags += 10;
+            material = MeshMaterial::Diffuse;
             if (mesh->hasNormalTexture()) {
-                push.flags += 1;
+                material = MeshMaterial::DiffuseNormal;
             }
         }
 
+        if (bindMaterial && boundMaterial != material) {
+            bindMaterial(material);
+            boundMaterial = material;
+        }
+
         vkCmdPushConstants(
             command_buffer,
             pipeline_layout,
@@ -166,6 +180,49 @@ std::vector<VkDescriptorImageInfo> FrgModel::get_descriptors() {
     return descriptor_infos;
 }
 
+void FrgModel::register_textures(FrgDescriptor &descriptor) {
+    for (const auto &mesh : meshes) {
+        if (mesh->textures.empty())
+            continue;
+
+        std::vector<VkDescriptorImageInfo> image_infos{};
+        for (const auto &texture : mesh->textures) {
+            image_infos.emplace_back(texture->descriptor_image_info);
+        }
+        mesh->textureIndexStart = descriptor.add_textures(image_infos);
+        for (uint32_t i = 0; i < mesh->textures.size(); ++i) {
+            mesh->textures[i]->setTextureIdx(mesh->textureIndexStart + i);
+        }
+    }
+}
+
+void FrgModel::release_textures(FrgDescriptor &descriptor) {
+    for (const auto &mesh : meshes) {
+        if (mesh->textures.empty())
+            continue;
+        descriptor.release_textures(mesh->textureIndexStart, static_cast<uint32_t>(mesh->textures.size()));
+        // std::function needs a copyable capture
+        auto retired = std::make_shared<std::vector<std::unique_ptr<Texture>>>(std::move(mesh->textures));
+        frg_device.deletionQueue().retire([retired] {});
+        mesh->textures.clear();
+        mesh->textureIndexStart = 0;
+    }
+}
+
+void FrgModel::reload_textures(FrgDescriptor &descriptor) {
+    std::vector<std::vector<std::unique_ptr<Texture>>> reloaded(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        for (const auto &texture : meshes[i]->textures) {
+            reloaded[i].emplace_back(std::make_unique<Texture>(frg_device, texture->type, texture->path));
+        }
+    }
+    release_textures(descriptor);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        meshes[i]->textures = std::move(reloaded[i]);
+    }
+    register_textures(descriptor);
+}
+
 // Beware that this function takes ownership of the texture pointer passed in as
 // argument
 void FrgModel::add_texture_to_mesh(size_t idx, std::unique_ptr<Texture> &texture) {
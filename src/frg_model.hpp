@@ -1,5 +1,6 @@
 #pragma once
 
+#include "frg_descriptor.hpp"
 #include "frg_device.hpp"
 #include "frg_mesh.hpp"
 
@@ -13,6 +14,7 @@
 #include "assimp/scene.h"
 
 // std
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <set>
@@ -22,9 +24,7 @@
 
 namespace frg {
 
-// flags
-//  - tens -> number of textures (i.e. 0010 -> 1 texture, 0031 -> 3 textures)
-//  - ones -> does it have a normalmap (1 -> true, 0 -> false)
+// The material is not pushed, it selects a shader variant (see MeshMaterial)
 struct SimplePushConstantData {
   glm::mat4 transform{1.f};
   glm::mat4 modelMatrix{1.f};
@@ -33,14 +33,21 @@ struct SimplePushConstantData {
   glm::vec4 pointLightColor{1.f, 1.f, 1.f, 1.f}; // w is intensity
   glm::vec2 screenSize{800.f, 600.f};            // For SSAO UV calculation
   int texture_idx;
-  int flags;
-  int debugMode{0}; // 0=normal, 1=SSAO only, 2=normals, 3=depth
 };
+// What a mesh samples, for picking a shader variant
+enum class MeshMaterial : uint32_t { Untextured, Diffuse, DiffuseNormal };
+constexpr uint32_t MESH_MATERIAL_COUNT = 3;
+
 class FrgModel {
 public:
   FrgModel(FrgDevice &device, const std::string &path);
   void draw(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout,
             SimplePushConstantData push);
+  // Like draw, but calls bindMaterial before the first mesh and whenever the
+  // material changes, so the caller can switch shader variants
+  void draw(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout,
+            SimplePushConstantData push,
+            const std::function<void(MeshMaterial)> &bindMaterial);
 
   // For rendering passes without push constants (e.g., G-buffer)
   void bind(VkCommandBuffer command_buffer);
@@ -56,6 +63,17 @@ public:
   }
 
   void add_texture_to_mesh(size_t idx, std::unique_ptr<Texture> &texture);
+  // Writes each mesh's textures into a run of consecutive slots of the
+  // bindless table (the shaders find the normal map right after the diffuse
+  // map)
+  void register_textures(FrgDescriptor &descriptor);
+  // Evicts the textures while frames may still sample them: the slots go
+  // back to the table and the images are retired through the device's
+  // deletion queue. The meshes draw untextured afterwards.
+  void release_textures(FrgDescriptor &descriptor);
+  // Loads the textures again from their files into new slots and evicts
+  // the current ones
+  void reload_textures(FrgDescriptor &descriptor);
   std::vector<VkDescriptorImageInfo> get_descriptors();
   void set_texture_index_for_mesh(size_t mesh_idx, uint32_t index);
   std::vector<uint32_t> get_mesh_texture_indices() const;
@@ -70,8 +70,11 @@ void FrgParticleDispenser::cpy_host2dev(std::vector<VkBuffer> &buffers, std::vec
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             buffers[i],
-            buffers_memory[i]
+            buffers_memory[i],
+            true
         );
+        // Synchronous on purpose: the buffers are shared with the compute queue, which the uploader's
+        // transfer-to-graphics handover does not cover, and this runs once before the first frame
         m_device.copyBuffer(m_staging_buff, buffers[i], m_staging_buff_size);
     }
 }
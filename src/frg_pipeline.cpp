@@ -3,8 +3,10 @@
 #include "frg_model.hpp"
 // std
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
 namespace frg {
@@ -15,7 +17,14 @@ FrgPipeline::FrgPipeline(
     : frgDevice(device) {
   auto attr = Vertex::get_attribute_descriptions();
     std::vector<VkVertexInputAttributeDescription> inp_attr(attr.begin(), attr.end());
-    createGraphicsPipeline(vertFilePath, fragFilePath, configInfo, Vertex::get_binding_descriptions(), inp_attr);
+    std::vector<VkVertexInputBindingDescription> bindings = Vertex::get_binding_descriptions();
+
+    // The caller's config usually goes out of scope before the build runs
+    auto config = std::make_shared<PipelineConfigInfo>();
+    copyPipelineConfigInfo(configInfo, *config);
+    buildDone = frgDevice.pipelineCompiler().submit([this, vertFilePath, fragFilePath, config, bindings, inp_attr] {
+        createGraphicsPipeline(vertFilePath, fragFilePath, *config, bindings, inp_attr);
+    });
 }
 
 FrgPipeline::FrgPipeline(
@@ -32,12 +41,25 @@ FrgPipeline::FrgPipeline(
   create_shader_storage_buffers();
 }
 
+FrgPipeline::FrgPipeline(FrgDevice &device, const std::string &compFilePath, VkPipelineLayout pipelineLayout)
+    : frgDevice{device} {
+    buildDone = frgDevice.pipelineCompiler().submit([this, compFilePath, pipelineLayout] {
+        createComputePipeline(compFilePath, pipelineLayout);
+    });
+}
+
 FrgPipeline::~FrgPipeline() {
-  vkDestroyShaderModule(frgDevice.device(), vertShaderModule, nullptr);
-  vkDestroyShaderModule(frgDevice.device(), fragShaderModule, nullptr);
+  // The build writes into this object; a failed build left nothing to free
+  if (buildDone.valid())
+    buildDone.wait();
+  if (vertShaderModule != VK_NULL_HANDLE)
+    vkDestroyShaderModule(frgDevice.device(), vertShaderModule, nullptr);
+  if (fragShaderModule != VK_NULL_HANDLE)
+    vkDestroyShaderModule(frgDevice.device(), fragShaderModule, nullptr);
   if (compShaderModule != VK_NULL_HANDLE)
     vkDestroyShaderModule(frgDevice.device(), compShaderModule, nullptr);
-  vkDestroyPipeline(frgDevice.device(), graphicsPipeline, nullptr);
+  if (graphicsPipeline != VK_NULL_HANDLE)
+    vkDestroyPipeline(frgDevice.device(), graphicsPipeline, nullptr);
   if (computePipeline != VK_NULL_HANDLE)
     vkDestroyPipeline(frgDevice.device(), computePipeline, nullptr);
   if (computePipelineLayout != VK_NULL_HANDLE)
@@ -66,15 +88,6 @@ std::vector<char> FrgPipeline::readFile(const std::string &filePath) {
 }
 
 void FrgPipeline::createComputePipeline(const std::string &compFilePath, std::vector<VkDescriptorSetLayout> &layouts) {
-  auto compCode = readFile(compFilePath);
-  createShaderModule(compCode, &compShaderModule);
-
-  VkPipelineShaderStageCreateInfo comp_shader_stage_create_info{};
-    comp_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  comp_shader_stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-  comp_shader_stage_create_info.module = compShaderModule;
-  comp_shader_stage_create_info.pName = "main";
-
   VkPipelineLayoutCreateInfo pipeline_layout_info{};
   pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipeline_layout_info.setLayoutCount = 1;
@@ -86,12 +99,24 @@ void FrgPipeline::createComputePipeline(const std::string &compFilePath, std::ve
     throw std::runtime_error("failed to create compute pipeline layout!");
   }
 
+  createComputePipeline(compFilePath, computePipelineLayout);
+}
+
+void FrgPipeline::createComputePipeline(const std::string &compFilePath, VkPipelineLayout pipelineLayout) {
+  auto compCode = readFile(compFilePath);
+  createShaderModule(compCode, &compShaderModule);
+
+  VkPipelineShaderStageCreateInfo comp_shader_stage_create_info{};
+    comp_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  comp_shader_stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  comp_shader_stage_create_info.module = compShaderModule;
+  comp_shader_stage_create_info.pName = "main";
+
   VkComputePipelineCreateInfo pipeline_info{};
   pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-  pipeline_info.layout = computePipelineLayout;
+  pipeline_info.layout = pipelineLayout;
   pipeline_info.stage = comp_shader_stage_create_info;
-    if (vkCreateComputePipelines(frgDevice.device(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &computePipeline) !=
-        VK_SUCCESS)
+    if (frgDevice.pipelineCache().createComputePipeline(pipeline_info, &computePipeline) != VK_SUCCESS)
     {
     throw std::runtime_error("failed to create compute pipeline!");
   }
@@ -109,8 +134,9 @@ void FrgPipeline::createGraphicsPipeline(
         "configInfo"
     );
     assert(
-        configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no render pass provided in "
-                                                   "configInfo"
+        (configInfo.renderPass != VK_NULL_HANDLE || !configInfo.colorAttachmentFormats.empty() ||
+         configInfo.depthAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+        "Cannot create graphics pipeline: no render pass or attachment formats provided in configInfo"
     );
 
   auto vertCode = readFile(vertFilePath);
@@ -136,6 +162,16 @@ void FrgPipeline::createGraphicsPipeline(
   shaderStages[1].pNext = nullptr;
   shaderStages[1].pSpecializationInfo = nullptr;
 
+  VkSpecializationInfo fragSpecializationInfo{};
+  if (!configInfo.fragmentSpecializationEntries.empty()) {
+    fragSpecializationInfo.mapEntryCount =
+        static_cast<uint32_t>(configInfo.fragmentSpecializationEntries.size());
+    fragSpecializationInfo.pMapEntries = configInfo.fragmentSpecializationEntries.data();
+    fragSpecializationInfo.dataSize = configInfo.fragmentSpecializationData.size();
+    fragSpecializationInfo.pData = configInfo.fragmentSpecializationData.data();
+    shaderStages[1].pSpecializationInfo = &fragSpecializationInfo;
+  }
+
   // Use custom vertex input if provided, otherwise use default Vertex class
   std::vector<VkVertexInputBindingDescription> bindingDescriptions;
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
@@ -176,11 +212,19 @@ void FrgPipeline::createGraphicsPipeline(
   pipelineInfo.renderPass = configInfo.renderPass;
   pipelineInfo.subpass = configInfo.subpass;
 
+  VkPipelineRenderingCreateInfo renderingInfo{};
+  if (configInfo.renderPass == VK_NULL_HANDLE) {
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(configInfo.colorAttachmentFormats.size());
+    renderingInfo.pColorAttachmentFormats = configInfo.colorAttachmentFormats.data();
+    renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+    pipelineInfo.pNext = &renderingInfo;
+  }
+
   pipelineInfo.basePipelineIndex = -1;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(frgDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) !=
-        VK_SUCCESS)
+    if (frgDevice.pipelineCache().createGraphicsPipeline(pipelineInfo, &graphicsPipeline) != VK_SUCCESS)
     {
     throw std::runtime_error("failed to create graphics pipeline!");
   }
@@ -198,13 +242,68 @@ void FrgPipeline::createShaderModule(const std::vector<char> &code, VkShaderModu
 }
 
 void FrgPipeline::bind(VkCommandBuffer commandBuffer) {
+    wait();
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 }
 
 void FrgPipeline::bindCompute(VkCommandBuffer commandBuffer) {
+    wait();
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
 }
 
+bool FrgPipeline::isReady() const {
+    return !buildDone.valid() || buildDone.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+}
+
+void FrgPipeline::wait() const {
+    if (buildDone.valid()) {
+        buildDone.get();
+    }
+}
+
+void FrgPipeline::copyPipelineConfigInfo(const PipelineConfigInfo &src, PipelineConfigInfo &dst) {
+    dst.bindingDescriptions = src.bindingDescriptions;
+    dst.attributeDescriptions = src.attributeDescriptions;
+    dst.colorBlendAttachments = src.colorBlendAttachments;
+    dst.viewportInfo = src.viewportInfo;
+    dst.inputAssemblyInfo = src.inputAssemblyInfo;
+    dst.rasterizationInfo = src.rasterizationInfo;
+    dst.multisampleInfo = src.multisampleInfo;
+    dst.colorBlendAttachment = src.colorBlendAttachment;
+    dst.colorBlendInfo = src.colorBlendInfo;
+    dst.depthStencilInfo = src.depthStencilInfo;
+    dst.dynamicStateEnables = src.dynamicStateEnables;
+    dst.dynamicStateInfo = src.dynamicStateInfo;
+    dst.pipelineLayout = src.pipelineLayout;
+    dst.renderPass = src.renderPass;
+    dst.subpass = src.subpass;
+    dst.colorAttachmentFormats = src.colorAttachmentFormats;
+    dst.depthAttachmentFormat = src.depthAttachmentFormat;
+    dst.fragmentSpecializationEntries = src.fragmentSpecializationEntries;
+    dst.fragmentSpecializationData = src.fragmentSpecializationData;
+
+    if (src.colorBlendInfo.pAttachments == &src.colorBlendAttachment) {
+        dst.colorBlendInfo.pAttachments = &dst.colorBlendAttachment;
+    } else if (src.colorBlendInfo.pAttachments == src.colorBlendAttachments.data()) {
+        dst.colorBlendInfo.pAttachments = dst.colorBlendAttachments.data();
+    }
+    if (src.dynamicStateInfo.pDynamicStates == src.dynamicStateEnables.data()) {
+        dst.dynamicStateInfo.pDynamicStates = dst.dynamicStateEnables.data();
+    }
+}
+
+void FrgPipeline::setRenderTarget(PipelineConfigInfo &configInfo, const FrgRenderTarget &target) {
+    configInfo.renderPass = target.renderPass;
+    configInfo.colorAttachmentFormats.clear();
+    configInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+    if (target.isDynamic()) {
+        configInfo.colorAttachmentFormats.assign(
+            target.colorFormats.begin(), target.colorFormats.begin() + target.colorCount
+        );
+        configInfo.depthAttachmentFormat = target.depthFormat;
+    }
+}
+
 void FrgPipeline::defaultPipelineConfigInfo(PipelineConfigInfo &configInfo, bool compute) {
     configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   configInfo.inputAssemblyInfo.topology =
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "frg_device.hpp"
+#include "frg_render_target.hpp"
 #include "frg_swap_chain.hpp"
 
 // std
+#include <future>
 #include <string>
 #include <vector>
 
@@ -32,8 +34,19 @@ struct PipelineConfigInfo {
     VkPipelineLayout pipelineLayout = nullptr;
     VkRenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    // Attachment formats for dynamic rendering (renderPass == nullptr)
+    std::vector<VkFormat> colorAttachmentFormats{};
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+    // Fragment shader specialization constants (optional); the entries index
+    // into fragmentSpecializationData
+    std::vector<VkSpecializationMapEntry> fragmentSpecializationEntries{};
+    std::vector<uint8_t> fragmentSpecializationData{};
 };
 
+// Graphics and compute-only pipelines are built on the device's pipeline compiler:
+// construction returns right away and the first use (bind or handle access) waits
+// for the build. The particle pipeline is built synchronously.
 class FrgPipeline {
   public:
     FrgPipeline(
@@ -47,6 +60,9 @@ class FrgPipeline {
         std::vector<VkDescriptorSetLayout> &desc_set_layouts
     );
 
+    // Compute-only pipeline; the layout stays owned by the caller
+    FrgPipeline(FrgDevice &device, const std::string &compFilePath, VkPipelineLayout pipelineLayout);
+
     ~FrgPipeline();
 
     // Delete copy constructor and copy assignment operator
@@ -55,17 +71,32 @@ class FrgPipeline {
 
     void bind(VkCommandBuffer commandBuffer);
     void bindCompute(VkCommandBuffer commandBuffer);
+    // Whether the background build finished; never blocks
+    bool isReady() const;
+    // Blocks until the pipeline is built; rethrows build errors
+    void wait() const;
     static void defaultPipelineConfigInfo(PipelineConfigInfo &configInfo, bool compute = false);
+    // Render pass, or attachment formats, of the target the pipeline draws to
+    static void setRenderTarget(PipelineConfigInfo &configInfo, const FrgRenderTarget &target);
     void create_shader_storage_buffers();
     VkPipelineLayout getComputePipelineLayout() { return computePipelineLayout; }
-    VkPipeline getComputePipeline() { return computePipeline; }
-    VkPipeline getGraphicsPipeline() { return graphicsPipeline; }
+    VkPipeline getComputePipeline() {
+        wait();
+        return computePipeline;
+    }
+    VkPipeline getGraphicsPipeline() {
+        wait();
+        return graphicsPipeline;
+    }
     std::vector<VkBuffer> &getShaderStorageBuffers() { return shader_storage_buffers; }
     std::vector<VkDeviceMemory> &getShaderStorageBuffersMemory() { return shader_storage_buffers_memory; }
 
   private:
     static std::vector<char> readFile(const std::string &filePath);
+    // Deep copy that re-points the blend attachment and dynamic state arrays
+    static void copyPipelineConfigInfo(const PipelineConfigInfo &src, PipelineConfigInfo &dst);
     void createComputePipeline(const std::string &compFilePath, std::vector<VkDescriptorSetLayout> &layouts);
+    void createComputePipeline(const std::string &compFilePath, VkPipelineLayout pipelineLayout);
     void createGraphicsPipeline(
         const std::string &vertFilePath, const std::string &fragFilePath, const PipelineConfigInfo &configInfo,
         std::vector<VkVertexInputBindingDescription> input_binding_desc,
@@ -75,13 +106,15 @@ class FrgPipeline {
     void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule);
 
     FrgDevice &frgDevice;
-    VkPipeline graphicsPipeline;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
     VkPipeline computePipeline = VK_NULL_HANDLE;
     VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+    VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
     VkShaderModule compShaderModule = VK_NULL_HANDLE;
     std::vector<VkBuffer> shader_storage_buffers;
     std::vector<VkDeviceMemory> shader_storage_buffers_memory;
+    // Set while the pipeline is built in the background
+    std::shared_future<void> buildDone;
 };
 } // namespace frg
\ No newline at end of file
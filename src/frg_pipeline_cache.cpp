@@ -0,0 +1,237 @@
+#include "frg_pipeline_cache.hpp"
+
+// std
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace frg {
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+} // namespace
+
+FrgPipelineCache::FrgPipelineCache(VkDevice device,
+                                   const VkPhysicalDeviceProperties &properties,
+                                   bool feedback, std::string path)
+    : device{device}, properties{properties}, feedbackEnabled{feedback},
+      path{std::move(path)} {
+  std::string initialData = loadInitialData();
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = initialData.size();
+  cacheInfo.pInitialData = initialData.data();
+
+  if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) !=
+      VK_SUCCESS) {
+    // The driver may still reject a blob that passed our header check
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    warmStart = false;
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+  }
+}
+
+FrgPipelineCache::~FrgPipelineCache() {
+  save();
+  vkDestroyPipelineCache(device, cache, nullptr);
+}
+
+FrgPipelineCache::FileHeader FrgPipelineCache::makeHeader() const {
+  FileHeader header{};
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.vendorID = properties.vendorID;
+  header.deviceID = properties.deviceID;
+  header.driverVersion = properties.driverVersion;
+  std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+  return header;
+}
+
+bool FrgPipelineCache::isCompatible(const FileHeader &header) const {
+  FileHeader expected = makeHeader();
+  return header.magic == expected.magic &&
+         header.version == expected.version &&
+         header.vendorID == expected.vendorID &&
+         header.deviceID == expected.deviceID &&
+         header.driverVersion == expected.driverVersion &&
+         std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+std::string FrgPipelineCache::loadInitialData() {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    std::cout << "Pipeline cache: " << path << " not found, starting cold"
+              << std::endl;
+    return {};
+  }
+
+  FileHeader header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      !isCompatible(header)) {
+    std::cout << "Pipeline cache: " << path
+              << " is from another device or driver, starting cold"
+              << std::endl;
+    return {};
+  }
+
+  std::string data(header.dataSize, '\0');
+  if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+    std::cout << "Pipeline cache: " << path << " is truncated, starting cold"
+              << std::endl;
+    return {};
+  }
+
+  storedMissCount = header.missCount;
+  storedMissMs = header.missMs;
+  warmStart = !data.empty();
+  std::cout << "Pipeline cache: loaded " << data.size() << " bytes from "
+            << path << std::endl;
+  return data;
+}
+
+VkResult FrgPipelineCache::createGraphicsPipeline(
+    const VkGraphicsPipelineCreateInfo &info, VkPipeline *pipeline) {
+  VkGraphicsPipelineCreateInfo pipelineInfo = info;
+  std::vector<VkPipelineCreationFeedbackEXT> stageFeedback(info.stageCount);
+  VkPipelineCreationFeedbackEXT feedback{};
+  VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+  if (feedbackEnabled) {
+    feedbackInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    feedbackInfo.pNext = pipelineInfo.pNext;
+    feedbackInfo.pPipelineCreationFeedback = &feedback;
+    feedbackInfo.pipelineStageCreationFeedbackCount = info.stageCount;
+    feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedback.data();
+    pipelineInfo.pNext = &feedbackInfo;
+  }
+
+  auto start = Clock::now();
+  VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo,
+                                              nullptr, pipeline);
+  if (result == VK_SUCCESS) {
+    record(Milliseconds{Clock::now() - start}.count(), feedback);
+  }
+  return result;
+}
+
+VkResult FrgPipelineCache::createComputePipeline(
+    const VkComputePipelineCreateInfo &info, VkPipeline *pipeline) {
+  VkComputePipelineCreateInfo pipelineInfo = info;
+  VkPipelineCreationFeedbackEXT stageFeedback{};
+  VkPipelineCreationFeedbackEXT feedback{};
+  VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+  if (feedbackEnabled) {
+    feedbackInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    feedbackInfo.pNext = pipelineInfo.pNext;
+    feedbackInfo.pPipelineCreationFeedback = &feedback;
+    feedbackInfo.pipelineStageCreationFeedbackCount = 1;
+    feedbackInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+    pipelineInfo.pNext = &feedbackInfo;
+  }
+
+  auto start = Clock::now();
+  VkResult result = vkCreateComputePipelines(device, cache, 1, &pipelineInfo,
+                                             nullptr, pipeline);
+  if (result == VK_SUCCESS) {
+    record(Milliseconds{Clock::now() - start}.count(), feedback);
+  }
+  return result;
+}
+
+void FrgPipelineCache::record(double milliseconds,
+                              const VkPipelineCreationFeedbackEXT &feedback) {
+  constexpr VkPipelineCreationFeedbackFlagsEXT HIT_BIT =
+      VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT;
+  bool hit;
+  if (feedbackEnabled &&
+      (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) {
+    hit = (feedback.flags & HIT_BIT) != 0;
+  } else {
+    hit = warmStart;
+  }
+
+  std::lock_guard<std::mutex> lock{statsMutex};
+  pipelineCount++;
+  totalMs += milliseconds;
+  if (hit) {
+    hitCount++;
+    hitMs += milliseconds;
+  } else {
+    missCount++;
+    missMs += milliseconds;
+  }
+}
+
+bool FrgPipelineCache::save() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) !=
+      VK_SUCCESS) {
+    return false;
+  }
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) !=
+      VK_SUCCESS) {
+    return false;
+  }
+
+  FileHeader header = makeHeader();
+  header.dataSize = dataSize;
+  {
+    std::lock_guard<std::mutex> lock{statsMutex};
+    header.missCount = storedMissCount + missCount;
+    header.missMs = storedMissMs + missMs;
+  }
+
+  // Write next to the old file and swap, so a crash never leaves half a cache
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+        !file.write(data.data(), static_cast<std::streamsize>(dataSize))) {
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+  return !error;
+}
+
+void FrgPipelineCache::printStats() {
+  std::lock_guard<std::mutex> lock{statsMutex};
+  if (pipelineCount == 0) {
+    return;
+  }
+
+  std::cout << "Pipeline cache: " << pipelineCount << " pipelines in "
+            << totalMs << " ms, " << hitCount << " hits ("
+            << 100.0 * hitCount / pipelineCount << "%)";
+  if (!feedbackEnabled) {
+    std::cout << " [no creation feedback, warm start counted as hits]";
+  }
+
+  // Hits would have cost as much as an average miss
+  uint64_t misses = storedMissCount + missCount;
+  if (hitCount > 0 && misses > 0) {
+    double averageMissMs = (storedMissMs + missMs) / misses;
+    std::cout << ", ~" << hitCount * averageMissMs - hitMs << " ms saved";
+  }
+  std::cout << std::endl;
+}
+
+} // namespace frg
@@ -0,0 +1,106 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace frg {
+
+/**
+ * Pipeline Cache
+ *
+ * One VkPipelineCache shared by every pipeline the renderer creates, loaded
+ * from disk at startup and written back on shutdown, so warm launches skip the
+ * driver's shader compilation.
+ *
+ * The file starts with a small header of our own in front of the driver's
+ * blob. It records the vendor, device, driver version and pipeline cache UUID
+ * the blob was made with; if any of them changed, the file is ignored and the
+ * cache starts empty.
+ *
+ * Creation goes through createGraphicsPipeline/createComputePipeline, which
+ * time every pipeline and count cache hits. Hits come from
+ * VK_EXT_pipeline_creation_feedback when the device has it; otherwise every
+ * pipeline of a warm start counts as a hit. The average cost of a miss is
+ * kept in the file to estimate the time hits saved.
+ */
+class FrgPipelineCache {
+public:
+  static constexpr const char *DEFAULT_PATH = "pipeline_cache.bin";
+
+  // feedback: whether VK_EXT_pipeline_creation_feedback is enabled
+  FrgPipelineCache(VkDevice device,
+                   const VkPhysicalDeviceProperties &properties, bool feedback,
+                   std::string path = DEFAULT_PATH);
+  // Saves the cache
+  ~FrgPipelineCache();
+
+  FrgPipelineCache(const FrgPipelineCache &) = delete;
+  FrgPipelineCache &operator=(const FrgPipelineCache &) = delete;
+
+  VkPipelineCache handle() const { return cache; }
+
+  // Thin wrappers around vkCreate*Pipelines for a single pipeline; safe to
+  // call from several threads
+  VkResult createGraphicsPipeline(const VkGraphicsPipelineCreateInfo &info,
+                                  VkPipeline *pipeline);
+  VkResult createComputePipeline(const VkComputePipelineCreateInfo &info,
+                                 VkPipeline *pipeline);
+
+  // Writes the cache to disk; returns false if it could not be written
+  bool save();
+
+  // Pipelines created so far, cache hit rate and estimated time saved
+  void printStats();
+
+private:
+  // Prefix of the cache file
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    // Misses measured over all runs with this blob, for the saved-time
+    // estimate
+    uint64_t missCount;
+    double missMs;
+  };
+
+  static constexpr uint32_t FILE_MAGIC = 0x43475246; // "FRGC"
+  static constexpr uint32_t FILE_VERSION = 1;
+
+  FileHeader makeHeader() const;
+  bool isCompatible(const FileHeader &header) const;
+  std::string loadInitialData();
+  void record(double milliseconds,
+              const VkPipelineCreationFeedbackEXT &feedback);
+
+  VkDevice device;
+  VkPhysicalDeviceProperties properties;
+  bool feedbackEnabled;
+  std::string path;
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  // Whether a compatible blob was loaded; stands in for the hit flag when
+  // there is no creation feedback
+  bool warmStart = false;
+
+  std::mutex statsMutex;
+  uint32_t pipelineCount = 0;
+  uint32_t hitCount = 0;
+  double hitMs = 0.0;
+  double totalMs = 0.0;
+  // This run's misses, and the ones stored in the file
+  uint64_t missCount = 0;
+  double missMs = 0.0;
+  uint64_t storedMissCount = 0;
+  double storedMissMs = 0.0;
+};
+
+} // namespace frg
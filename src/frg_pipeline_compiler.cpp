@@ -0,0 +1,78 @@
+#include "frg_pipeline_compiler.hpp"
+
+// std
+#include <utility>
+
+namespace frg {
+
+FrgPipelineCompiler::FrgPipelineCompiler(uint32_t workerCount) {
+  if (workerCount == 0) {
+    uint32_t hardware = std::thread::hardware_concurrency();
+    workerCount = hardware > 1 ? hardware - 1 : 1;
+  }
+
+  workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; i++) {
+    workers.emplace_back(&FrgPipelineCompiler::workerLoop, this);
+  }
+}
+
+FrgPipelineCompiler::~FrgPipelineCompiler() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  jobReady.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+std::shared_future<void>
+FrgPipelineCompiler::submit(std::function<void()> job) {
+  std::packaged_task<void()> task{std::move(job)};
+  std::shared_future<void> done = task.get_future().share();
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    jobs.push_back(std::move(task));
+  }
+  jobReady.notify_one();
+  return done;
+}
+
+void FrgPipelineCompiler::waitIdle() {
+  std::unique_lock<std::mutex> lock{mutex};
+  idle.wait(lock, [this] { return jobs.empty() && running == 0; });
+}
+
+bool FrgPipelineCompiler::isIdle() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return jobs.empty() && running == 0;
+}
+
+void FrgPipelineCompiler::workerLoop() {
+  while (true) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+      // Drain the queue before stopping; owners may still wait on it
+      if (jobs.empty()) {
+        return;
+      }
+      task = std::move(jobs.front());
+      jobs.pop_front();
+      running++;
+    }
+
+    // Exceptions end up in the task's future
+    task();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (--running == 0 && jobs.empty()) {
+      idle.notify_all();
+    }
+  }
+}
+
+} // namespace frg
@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Pipeline Compiler
+ *
+ * Worker threads that build pipelines in the background. Each job reads its
+ * SPIR-V, creates the shader modules and the pipeline, so file loading and
+ * driver compilation of independent pipelines overlap with each other and
+ * with the rest of startup.
+ *
+ * Jobs run in submission order; the returned future becomes ready when the
+ * job finished and rethrows anything it threw.
+ */
+class FrgPipelineCompiler {
+public:
+  // workerCount 0 picks one worker per hardware thread, minus the caller
+  explicit FrgPipelineCompiler(uint32_t workerCount = 0);
+  // Finishes the queued jobs before joining
+  ~FrgPipelineCompiler();
+
+  FrgPipelineCompiler(const FrgPipelineCompiler &) = delete;
+  FrgPipelineCompiler &operator=(const FrgPipelineCompiler &) = delete;
+
+  std::shared_future<void> submit(std::function<void()> job);
+
+  // Blocks until every submitted job has finished
+  void waitIdle();
+  bool isIdle();
+
+private:
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable idle;
+  std::deque<std::packaged_task<void()>> jobs;
+  uint32_t running = 0;
+  bool stopping = false;
+};
+
+} // namespace frg
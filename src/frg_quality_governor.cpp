@@ -0,0 +1,64 @@
+#include "frg_quality_governor.hpp"
+
+#include "frg_ssao.hpp"
+
+// std
+#include <algorithm>
+
+namespace frg {
+
+FrgQualityGovernor::FrgQualityGovernor(double budgetMs) : budgetMs{budgetMs} {
+  // Cheapest knobs first: AO resolution and kernel size barely show once
+  // blurred, fewer particles is the most visible step
+  constexpr int FULL = FrgSSAO::KERNEL_SIZE;
+  levels = {
+      {FULL, 1, 1.0f},
+      {FULL, 2, 1.0f},
+      {FULL / 2, 2, 1.0f},
+      {FULL / 2, 2, 0.75f},
+      {FULL / 2, 4, 0.5f},
+      {FrgSSAO::MIN_KERNEL_SIZE, 4, 0.25f},
+  };
+}
+
+bool FrgQualityGovernor::update(double cpuMs, double gpuMs) {
+  if (cooldown > 0) {
+    --cooldown;
+    return false;
+  }
+
+  double frameMs = std::max(cpuMs, gpuMs);
+  if (!hasAverage) {
+    averageMs = frameMs;
+    hasAverage = true;
+  } else {
+    averageMs += (frameMs - averageMs) * SMOOTHING;
+  }
+
+  framesOver = averageMs > budgetMs * DOWNGRADE_RATIO ? framesOver + 1 : 0;
+  framesUnder = averageMs < budgetMs * UPGRADE_RATIO ? framesUnder + 1 : 0;
+
+  int next = levelIndex;
+  if (framesOver >= DOWNGRADE_FRAMES) {
+    next = std::min(levelIndex + 1, getLevelCount() - 1);
+  } else if (framesUnder >= UPGRADE_FRAMES) {
+    next = std::max(levelIndex - 1, 0);
+  }
+  if (next == levelIndex) {
+    return false;
+  }
+
+  reset(next);
+  return true;
+}
+
+void FrgQualityGovernor::reset(int level) {
+  levelIndex = std::clamp(level, 0, getLevelCount() - 1);
+  // The average spans the old settings; start over once they drained
+  hasAverage = false;
+  framesOver = 0;
+  framesUnder = 0;
+  cooldown = COOLDOWN_FRAMES;
+}
+
+} // namespace frg
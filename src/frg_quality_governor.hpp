@@ -0,0 +1,73 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Quality Governor
+ *
+ * Holds a frame-time budget by stepping through a fixed ladder of quality
+ * levels, from full quality (level 0) down to the cheapest settings.
+ *
+ * Each frame is fed the CPU time spent building it and the GPU time of its
+ * command buffer. CPU and GPU overlap, so the slower of the two sets the
+ * frame rate; that cost is smoothed with an exponential moving average.
+ *
+ * Hysteresis keeps the level from oscillating:
+ * - drop a level after the average stays over budget for DOWNGRADE_FRAMES
+ * - raise a level only after it stays under UPGRADE_RATIO of the budget for
+ *   the longer UPGRADE_FRAMES
+ * - ignore COOLDOWN_FRAMES after a change, while frames recorded with the
+ *   old settings are still in flight
+ */
+class FrgQualityGovernor {
+public:
+  struct QualityLevel {
+    int ssaoKernelSize;      // hemisphere samples (HBAO steps scale along)
+    uint32_t ssaoDivisor;    // SSAO resolution divisor
+    float particleFraction;  // share of the particles simulated and drawn
+  };
+
+  static constexpr double DOWNGRADE_RATIO = 1.0;
+  static constexpr double UPGRADE_RATIO = 0.75;
+  static constexpr int DOWNGRADE_FRAMES = 30;
+  static constexpr int UPGRADE_FRAMES = 180;
+  static constexpr int COOLDOWN_FRAMES = 60;
+  static constexpr double SMOOTHING = 0.1;
+
+  explicit FrgQualityGovernor(double budgetMs);
+
+  FrgQualityGovernor(const FrgQualityGovernor &) = delete;
+  FrgQualityGovernor &operator=(const FrgQualityGovernor &) = delete;
+
+  // Feed one frame's timings; returns true if the level changed. Pass a
+  // negative gpuMs when no GPU timing is available.
+  bool update(double cpuMs, double gpuMs);
+
+  // Restart measuring at the given level (e.g. after re-enabling)
+  void reset(int level);
+
+  const QualityLevel &getLevel() const { return levels[levelIndex]; }
+  int getLevelIndex() const { return levelIndex; }
+  int getLevelCount() const { return static_cast<int>(levels.size()); }
+
+  double getBudgetMs() const { return budgetMs; }
+  void setBudgetMs(double ms) { budgetMs = ms; }
+  double getAverageMs() const { return averageMs; }
+
+private:
+  std::vector<QualityLevel> levels;
+  double budgetMs;
+
+  int levelIndex = 0;
+  double averageMs = 0.0;
+  bool hasAverage = false;
+  int framesOver = 0;
+  int framesUnder = 0;
+  int cooldown = 0;
+};
+
+} // namespace frg
@@ -0,0 +1,377 @@
+#include "frg_render_graph.hpp"
+
+// std
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace frg {
+
+namespace {
+
+constexpr VkPipelineStageFlags DEPTH_TEST_STAGES =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+} // namespace
+
+void FrgRenderGraph::reset() {
+  images.clear();
+  memories.clear();
+  passes.clear();
+}
+
+FrgRenderGraph::Resource FrgRenderGraph::importImage(
+    const char *name, VkImage image, VkImageAspectFlags aspect,
+    VkImageLayout layout, VkPipelineStageFlags stages) {
+  Resource resource = static_cast<Resource>(images.size());
+  bool kept = layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+  images.push_back({name, image, aspect, layout, stages,
+                    static_cast<uint32_t>(memories.size()), layout});
+  // Earlier frames made a kept image's contents visible to its resting
+  // stages (see restoreRestingLayouts)
+  memories.push_back(
+      {stages, 0, stages, stages, kept ? resource : NO_RESOURCE});
+  return resource;
+}
+
+void FrgRenderGraph::alias(Resource a, Resource b) {
+  images[b].memory = images[a].memory;
+}
+
+void FrgRenderGraph::addPass(const char *name,
+                             const std::vector<Access> &accesses,
+                             Record record, bool output) {
+  Pass pass{name, {}, std::move(record), output};
+  for (const Access &access : accesses) {
+    if (access.resource == NO_RESOURCE) {
+      continue;
+    }
+    ResolvedAccess resolved = resolve(access);
+
+    bool merged = false;
+    for (ResolvedAccess &existing : pass.accesses) {
+      if (existing.resource != resolved.resource) {
+        continue;
+      }
+      if (existing.layout != resolved.layout) {
+        throw std::runtime_error(
+            "Render graph pass uses an image in two layouts!");
+      }
+      existing.stages |= resolved.stages;
+      existing.access |= resolved.access;
+      existing.write = existing.write || resolved.write;
+      merged = true;
+      break;
+    }
+    if (!merged) {
+      pass.accesses.push_back(resolved);
+    }
+  }
+  passes.push_back(std::move(pass));
+}
+
+FrgRenderGraph::ResolvedAccess
+FrgRenderGraph::resolve(const Access &access) const {
+  const Image &image = images[access.resource];
+  bool depth = (image.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+  VkImageLayout sampledLayout =
+      depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+            : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  ResolvedAccess resolved{};
+  resolved.resource = access.resource;
+  switch (access.usage) {
+  case Usage::ColorAttachment:
+    resolved.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    resolved.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    resolved.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    resolved.write = true;
+    break;
+  case Usage::DepthAttachment:
+    resolved.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    resolved.stages = DEPTH_TEST_STAGES;
+    resolved.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    resolved.write = true;
+    break;
+  case Usage::DepthTest:
+    resolved.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    resolved.stages = DEPTH_TEST_STAGES;
+    resolved.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    resolved.write = false;
+    break;
+  case Usage::SampledFragment:
+    resolved.layout = sampledLayout;
+    resolved.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    resolved.access = VK_ACCESS_SHADER_READ_BIT;
+    resolved.write = false;
+    break;
+  case Usage::SampledCompute:
+    resolved.layout = sampledLayout;
+    resolved.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    resolved.access = VK_ACCESS_SHADER_READ_BIT;
+    resolved.write = false;
+    break;
+  case Usage::StorageCompute:
+    resolved.layout = VK_IMAGE_LAYOUT_GENERAL;
+    resolved.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    resolved.access = VK_ACCESS_SHADER_WRITE_BIT;
+    resolved.write = true;
+    break;
+  }
+
+  if (image.restingLayout == VK_IMAGE_LAYOUT_GENERAL) {
+    resolved.layout = VK_IMAGE_LAYOUT_GENERAL;
+  }
+  return resolved;
+}
+
+void FrgRenderGraph::execute(VkCommandBuffer commandBuffer) {
+  cull();
+
+  barrierCount = 0;
+  for (Pass &pass : passes) {
+    if (pass.culled) {
+      continue;
+    }
+    BarrierBatch batch;
+    for (const ResolvedAccess &access : pass.accesses) {
+      prepare(access, batch);
+    }
+    flush(commandBuffer, batch);
+    pass.record(commandBuffer);
+  }
+  restoreRestingLayouts(commandBuffer);
+}
+
+void FrgRenderGraph::cull() {
+  // Walks back from the outputs: a pass is needed if it writes an image a
+  // later kept pass reads, or the last contents of a kept image
+  std::vector<bool> needed(images.size());
+  for (size_t i = 0; i < images.size(); i++) {
+    needed[i] = images[i].restingLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+  }
+
+  culledPassCount = 0;
+  for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass) {
+    bool keep = pass->output;
+    for (const ResolvedAccess &access : pass->accesses) {
+      keep = keep || (access.write && needed[access.resource]);
+    }
+    pass->culled = !keep;
+    if (!keep) {
+      culledPassCount++;
+      continue;
+    }
+    // Writes first: a pass that reads what it writes (depth attachments)
+    // still needs the earlier contents
+    for (const ResolvedAccess &access : pass->accesses) {
+      if (access.write) {
+        needed[access.resource] = false;
+      }
+    }
+    for (const ResolvedAccess &access : pass->accesses) {
+      if (!access.write) {
+        needed[access.resource] = true;
+      }
+    }
+  }
+}
+
+void FrgRenderGraph::prepare(const ResolvedAccess &access,
+                             BarrierBatch &batch) {
+  Image &image = images[access.resource];
+  Memory &memory = memories[image.memory];
+
+  if (access.write) {
+    VkPipelineStageFlags previous = memory.writeStages | memory.readStages;
+    bool owner = memory.contents == access.resource;
+    if (previous != 0 || image.layout != access.layout) {
+      // The pass overwrites the image, so a layout change may discard
+      VkImageLayout oldLayout = image.layout == access.layout
+                                    ? image.layout
+                                    : VK_IMAGE_LAYOUT_UNDEFINED;
+      addImageBarrier(batch, image, oldLayout, access.layout, previous,
+                      owner ? memory.writeAccess : 0, access.stages,
+                      access.access);
+    }
+    if (!owner && memory.writeAccess != 0) {
+      // The previous writes went through another image bound to the same
+      // memory, which the image barrier does not cover
+      batch.aliasSrcStages |= memory.writeStages;
+      batch.aliasSrcAccess |= memory.writeAccess;
+      batch.aliasDstStages |= access.stages;
+      batch.aliasDstAccess |= access.access;
+    }
+
+    memory.writeStages = access.stages;
+    memory.writeAccess = access.access;
+    memory.visibleStages = 0;
+    memory.readStages = 0;
+    memory.contents = access.resource;
+    image.layout = access.layout;
+    return;
+  }
+
+  if (memory.contents != access.resource) {
+    throw std::runtime_error(
+        "Render graph pass reads an image that was not written!");
+  }
+
+  if (image.layout != access.layout) {
+    addImageBarrier(batch, image, image.layout, access.layout,
+                    memory.writeStages | memory.readStages, memory.writeAccess,
+                    access.stages, access.access);
+
+    // Later accesses have to wait for the transition like for a write
+    memory.writeStages = access.stages;
+    memory.writeAccess = 0;
+    memory.visibleStages = access.stages;
+    memory.readStages = 0;
+    image.layout = access.layout;
+  } else if ((access.stages & ~memory.visibleStages) != 0) {
+    addImageBarrier(batch, image, image.layout, image.layout,
+                    memory.writeStages, memory.writeAccess, access.stages,
+                    access.access);
+    memory.visibleStages |= access.stages;
+  }
+  memory.readStages |= access.stages;
+}
+
+void FrgRenderGraph::addImageBarrier(BarrierBatch &batch, const Image &image,
+                                     VkImageLayout oldLayout,
+                                     VkImageLayout newLayout,
+                                     VkPipelineStageFlags srcStages,
+                                     VkAccessFlags srcAccess,
+                                     VkPipelineStageFlags dstStages,
+                                     VkAccessFlags dstAccess) {
+  // The legacy stage and access bits have the same values in the
+  // synchronization2 masks
+  VkImageMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = srcStages;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = dstStages;
+  barrier.dstAccessMask = dstAccess;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image.image;
+  barrier.subresourceRange.aspectMask = image.aspect;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  batch.imageBarriers.push_back(barrier);
+}
+
+void FrgRenderGraph::flush(VkCommandBuffer commandBuffer,
+                           const BarrierBatch &batch) {
+  if (batch.imageBarriers.empty() && batch.aliasSrcAccess == 0) {
+    return;
+  }
+  barrierCount++;
+  if (pipelineBarrier2 == nullptr) {
+    flushLegacy(commandBuffer, batch);
+    return;
+  }
+
+  VkMemoryBarrier2 aliasBarrier{};
+  aliasBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  aliasBarrier.srcStageMask = batch.aliasSrcStages;
+  aliasBarrier.srcAccessMask = batch.aliasSrcAccess;
+  aliasBarrier.dstStageMask = batch.aliasDstStages;
+  aliasBarrier.dstAccessMask = batch.aliasDstAccess;
+
+  // An empty src stage mask (first use this frame) waits for nothing
+  VkDependencyInfo dependencyInfo{};
+  dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dependencyInfo.memoryBarrierCount = batch.aliasSrcAccess != 0 ? 1 : 0;
+  dependencyInfo.pMemoryBarriers = &aliasBarrier;
+  dependencyInfo.imageMemoryBarrierCount =
+      static_cast<uint32_t>(batch.imageBarriers.size());
+  dependencyInfo.pImageMemoryBarriers = batch.imageBarriers.data();
+  pipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void FrgRenderGraph::flushLegacy(VkCommandBuffer commandBuffer,
+                                 const BarrierBatch &batch) {
+  VkPipelineStageFlags srcStages = batch.aliasSrcStages;
+  VkPipelineStageFlags dstStages = batch.aliasDstStages;
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  imageBarriers.reserve(batch.imageBarriers.size());
+  for (const VkImageMemoryBarrier2 &barrier2 : batch.imageBarriers) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+    barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+    barrier.oldLayout = barrier2.oldLayout;
+    barrier.newLayout = barrier2.newLayout;
+    barrier.srcQueueFamilyIndex = barrier2.srcQueueFamilyIndex;
+    barrier.dstQueueFamilyIndex = barrier2.dstQueueFamilyIndex;
+    barrier.image = barrier2.image;
+    barrier.subresourceRange = barrier2.subresourceRange;
+    imageBarriers.push_back(barrier);
+
+    srcStages |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask);
+    dstStages |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask);
+  }
+
+  VkMemoryBarrier aliasBarrier{};
+  aliasBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  aliasBarrier.srcAccessMask = batch.aliasSrcAccess;
+  aliasBarrier.dstAccessMask = batch.aliasDstAccess;
+  uint32_t memoryBarrierCount = batch.aliasSrcAccess != 0 ? 1 : 0;
+
+  // Nothing to wait for: the first use of an image this frame
+  if (srcStages == 0) {
+    srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  }
+  vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+                       memoryBarrierCount, &aliasBarrier, 0, nullptr,
+                       static_cast<uint32_t>(imageBarriers.size()),
+                       imageBarriers.data());
+}
+
+void FrgRenderGraph::restoreRestingLayouts(VkCommandBuffer commandBuffer) {
+  BarrierBatch batch;
+  for (const Image &image : images) {
+    if (image.restingLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+      continue;
+    }
+    const Memory &memory = memories[image.memory];
+    if (image.layout == image.restingLayout &&
+        (image.restingStages & ~memory.visibleStages) == 0) {
+      continue;
+    }
+    addImageBarrier(batch, image, image.layout, image.restingLayout,
+                    memory.writeStages | memory.readStages, memory.writeAccess,
+                    image.restingStages, VK_ACCESS_MEMORY_READ_BIT);
+  }
+  flush(commandBuffer, batch);
+
+  for (Image &image : images) {
+    if (image.restingLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+      image.layout = image.restingLayout;
+    }
+  }
+}
+
+void FrgRenderGraph::dumpPasses(std::ostream &out) const {
+  out << "Render graph:";
+  const char *separator = " ";
+  for (const Pass &pass : passes) {
+    if (pass.culled) {
+      continue;
+    }
+    out << separator << pass.name;
+    separator = " -> ";
+  }
+  out << " (" << barrierCount << " barriers, " << culledPassCount
+      << " passes culled)" << std::endl;
+}
+
+} // namespace frg
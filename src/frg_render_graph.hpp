@@ -0,0 +1,169 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Render Graph
+ *
+ * A frame is declared as a list of passes, each naming the images it reads
+ * and writes. execute() then
+ * - culls the passes whose results nothing reads. Passes marked as outputs
+ *   (e.g. the swap chain pass) are always kept, as is the last write of an
+ *   image that is kept across frames.
+ * - records the remaining passes in declaration order, each after a single
+ *   pipeline barrier with the layout transitions and dependencies its
+ *   accesses need. Accesses that do not conflict (reads after reads in the
+ *   same layout) get none.
+ * - orders images that share memory (see alias) as if they were one image.
+ *
+ * Render passes recorded through the graph keep their attachments in the
+ * attachment layout (initialLayout == finalLayout) and have no external
+ * subpass dependencies: the graph does the transitions around them.
+ * Attachment and storage writes overwrite the whole image, so a write
+ * discards the previous contents.
+ *
+ * Given vkCmdPipelineBarrier2 (synchronization2), every image barrier
+ * carries its own stage masks. Otherwise the barriers of a pass are merged
+ * into one vkCmdPipelineBarrier, which waits on the union of their stages.
+ *
+ * The graph is rebuilt every frame: reset, importImage, addPass, execute.
+ */
+class FrgRenderGraph {
+public:
+  using Resource = uint32_t;
+  static constexpr Resource NO_RESOURCE = UINT32_MAX;
+
+  // How a pass uses an image; fixes the layout, stages and access
+  enum class Usage {
+    ColorAttachment,
+    DepthAttachment,
+    // Depth attachment without depth writes
+    DepthTest,
+    SampledFragment,
+    SampledCompute,
+    // Written as a storage image
+    StorageCompute,
+  };
+
+  struct Access {
+    Resource resource;
+    Usage usage;
+  };
+
+  using Record = std::function<void(VkCommandBuffer)>;
+
+  // pipelineBarrier2: vkCmdPipelineBarrier2, or nullptr to record the
+  // barriers with vkCmdPipelineBarrier
+  explicit FrgRenderGraph(PFN_vkCmdPipelineBarrier2 pipelineBarrier2 = nullptr)
+      : pipelineBarrier2{pipelineBarrier2} {}
+
+  FrgRenderGraph(const FrgRenderGraph &) = delete;
+  FrgRenderGraph &operator=(const FrgRenderGraph &) = delete;
+
+  // Drops the previous frame's images and passes
+  void reset();
+
+  // layout: layout the image is in between frames, UNDEFINED if its
+  // contents are not kept. An image kept in GENERAL stays in GENERAL for
+  // every use. stages: stages of earlier frames that may still access the
+  // image; its first access this frame waits for them.
+  Resource importImage(const char *name, VkImage image,
+                       VkImageAspectFlags aspect, VkImageLayout layout,
+                       VkPipelineStageFlags stages);
+  // b is bound to the same memory as a, so their contents never live at the
+  // same time: b's first write waits for everything a did before it
+  void alias(Resource a, Resource b);
+
+  // Accesses of NO_RESOURCE are skipped, so optional inputs can be passed
+  // as they are
+  void addPass(const char *name, const std::vector<Access> &accesses,
+               Record record, bool output = false);
+
+  void execute(VkCommandBuffer commandBuffer);
+
+  // Statistics of the last execute
+  uint32_t getCulledPassCount() const { return culledPassCount; }
+  uint32_t getBarrierCount() const { return barrierCount; }
+  // Writes the passes the last execute recorded, for debugging
+  void dumpPasses(std::ostream &out) const;
+
+private:
+  struct Image {
+    const char *name;
+    VkImage image;
+    VkImageAspectFlags aspect;
+    VkImageLayout restingLayout;
+    VkPipelineStageFlags restingStages;
+    uint32_t memory;
+    VkImageLayout layout;
+  };
+
+  // Hazard state, shared by aliased images
+  struct Memory {
+    // Last write (or layout transition) and the stages it is visible to
+    VkPipelineStageFlags writeStages;
+    VkAccessFlags writeAccess;
+    VkPipelineStageFlags visibleStages;
+    // Reads since the last write
+    VkPipelineStageFlags readStages;
+    // Image whose contents the memory holds
+    Resource contents;
+  };
+
+  struct ResolvedAccess {
+    Resource resource;
+    VkImageLayout layout;
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    bool write;
+  };
+
+  struct Pass {
+    const char *name;
+    std::vector<ResolvedAccess> accesses;
+    Record record;
+    bool output;
+    bool culled = false;
+  };
+
+  // Collects one pass's barriers. The alias dependency becomes a global
+  // memory barrier.
+  struct BarrierBatch {
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    VkPipelineStageFlags aliasSrcStages = 0;
+    VkAccessFlags aliasSrcAccess = 0;
+    VkPipelineStageFlags aliasDstStages = 0;
+    VkAccessFlags aliasDstAccess = 0;
+  };
+
+  ResolvedAccess resolve(const Access &access) const;
+  void cull();
+  void prepare(const ResolvedAccess &access, BarrierBatch &batch);
+  void addImageBarrier(BarrierBatch &batch, const Image &image,
+                       VkImageLayout oldLayout, VkImageLayout newLayout,
+                       VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+  void flush(VkCommandBuffer commandBuffer, const BarrierBatch &batch);
+  void flushLegacy(VkCommandBuffer commandBuffer, const BarrierBatch &batch);
+  void restoreRestingLayouts(VkCommandBuffer commandBuffer);
+
+  PFN_vkCmdPipelineBarrier2 pipelineBarrier2;
+
+  std::vector<Image> images;
+  std::vector<Memory> memories;
+  std::vector<Pass> passes;
+
+  uint32_t culledPassCount = 0;
+  uint32_t barrierCount = 0;
+};
+
+} // namespace frg
@@ -0,0 +1,74 @@
+#include "frg_render_target.hpp"
+
+namespace frg {
+
+void FrgRenderTarget::begin(FrgDevice &device, VkCommandBuffer commandBuffer,
+                            const VkClearValue *clearValues,
+                            VkSubpassContents contents) const {
+  bool hasDepth = depthFormat != VK_FORMAT_UNDEFINED;
+  if (!isDynamic()) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = extent;
+    renderPassInfo.clearValueCount = colorCount + (hasDepth ? 1 : 0);
+    renderPassInfo.pClearValues = clearValues;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+    return;
+  }
+
+  auto attachmentInfo = [this](VkImageView view, VkImageLayout layout,
+                               const VkClearValue &clearValue) {
+    VkRenderingAttachmentInfo attachment{};
+    attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    attachment.imageView = view;
+    attachment.imageLayout = layout;
+    attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+    attachment.loadOp = loadOp;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.clearValue = clearValue;
+    return attachment;
+  };
+
+  std::array<VkRenderingAttachmentInfo, MAX_COLOR_ATTACHMENTS>
+      colorAttachments{};
+  for (uint32_t i = 0; i < colorCount; i++) {
+    colorAttachments[i] =
+        attachmentInfo(colorViews[i], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                       clearValues[i]);
+  }
+  VkRenderingAttachmentInfo depthAttachment{};
+  if (hasDepth) {
+    depthAttachment =
+        attachmentInfo(depthView,
+                       VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                       clearValues[colorCount]);
+  }
+
+  VkRenderingInfo renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+  }
+  renderingInfo.renderArea.offset = {0, 0};
+  renderingInfo.renderArea.extent = extent;
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = colorCount;
+  renderingInfo.pColorAttachments = colorAttachments.data();
+  // The stencil of combined formats is not used
+  renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+  device.cmdBeginRendering(commandBuffer, renderingInfo);
+}
+
+void FrgRenderTarget::end(FrgDevice &device,
+                          VkCommandBuffer commandBuffer) const {
+  if (isDynamic()) {
+    device.cmdEndRendering(commandBuffer);
+  } else {
+    vkCmdEndRenderPass(commandBuffer);
+  }
+}
+
+} // namespace frg
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "frg_device.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstdint>
+
+namespace frg {
+
+/**
+ * Render Target
+ *
+ * The attachments a pass renders to. With a render pass, the target is a
+ * render pass instance over framebuffer. Without one (renderPass ==
+ * VK_NULL_HANDLE, see FrgDevice::supportsDynamicRendering) it is recorded
+ * with vkCmdBeginRendering straight from the attachment views: there are no
+ * render pass or framebuffer objects, and resizing only replaces the views.
+ *
+ * Every attachment is loaded with loadOp, stored, and stays in its
+ * attachment layout, as the passes recorded through FrgRenderGraph expect.
+ */
+struct FrgRenderTarget {
+  static constexpr uint32_t MAX_COLOR_ATTACHMENTS = 4;
+
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  // VK_NULL_HANDLE if unknown (secondaries continuing a render pass)
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+
+  // Attachments in render pass order. The views are only needed without a
+  // render pass; the formats also describe the target to pipelines and
+  // secondaries.
+  uint32_t colorCount = 0;
+  std::array<VkImageView, MAX_COLOR_ATTACHMENTS> colorViews{};
+  std::array<VkFormat, MAX_COLOR_ATTACHMENTS> colorFormats{};
+  VkImageView depthView = VK_NULL_HANDLE;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+  bool isDynamic() const { return renderPass == VK_NULL_HANDLE; }
+
+  // Starts rendering to the whole target. clearValues: one per color
+  // attachment, then one for depth. With SECONDARY_COMMAND_BUFFERS contents
+  // the draws come from FrgCommandRecorder.
+  void begin(FrgDevice &device, VkCommandBuffer commandBuffer,
+             const VkClearValue *clearValues,
+             VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) const;
+  void end(FrgDevice &device, VkCommandBuffer commandBuffer) const;
+};
+
+} // namespace frg
@@ -1,12 +1,14 @@
 #include "frg_renderer.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
 
 namespace frg {
-FrgRenderer::FrgRenderer(FrgWindow &window, FrgDevice &device) : frgWindow{window}, frgDevice{device} {
+FrgRenderer::FrgRenderer(FrgWindow &window, FrgDevice &device)
+    : frgWindow{window}, frgDevice{device}, latencyMonitor{device.supportsPresentWait()} {
     recreateSwapChain();
     createCommandBuffers();
 }
@@ -20,19 +22,38 @@ void FrgRenderer::recreateSwapChain() {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(frgDevice.device());
+    // Presents of the old swap chain are no longer waited on
+    latencyMonitor.setSwapChain(nullptr);
 
     if (frgSwapChain == nullptr) {
-        frgSwapChain = std::make_unique<FrgSwapChain>(frgDevice, extent);
+        frgSwapChain = std::make_unique<FrgSwapChain>(frgDevice, extent, presentConfig);
     } else {
         std::shared_ptr<FrgSwapChain> oldSwapChain = std::move(frgSwapChain);
-        frgSwapChain = std::make_unique<FrgSwapChain>(frgDevice, extent, oldSwapChain);
+        frgSwapChain = std::make_unique<FrgSwapChain>(frgDevice, extent, oldSwapChain, presentConfig);
 
         if (!oldSwapChain->compareSwapFormats(*frgSwapChain.get())) {
             throw std::runtime_error("Swap chain image or depth format has changed!");
         }
+
+        // The new swap chain continues the old one's timelines, so the old one only has to outlive the frames
+        // already submitted to it. Presentation has no completion signal; its last present was queued before
+        // the next frame, which has to finish first as well.
+        frgDevice.deletionQueue().retire([oldSwapChain] {});
     }
-    createCommandBuffers();
+    if (sharedDepthView != VK_NULL_HANDLE) {
+        frgSwapChain->setSharedDepthView(sharedDepthView, sharedDepthExtent);
+    }
+    latencyMonitor.setSwapChain(frgSwapChain.get());
+}
+
+void FrgRenderer::setPresentConfig(const PresentConfig &config) {
+    assert(!isFrameStarted && "Cannot change the present config while frame in progress");
+    presentConfig = config;
+    presentConfig.framesInFlight =
+        std::clamp(presentConfig.framesInFlight, 1u, static_cast<uint32_t>(FrgSwapChain::MAX_FRAMES_IN_FLIGHT));
+    recreateSwapChain();
+    // The swap chain renumbers its slots when the count changed
+    currentFrameIndex = static_cast<int>(frgSwapChain->currentFrameSlot());
 }
 
 void FrgRenderer::createCommandBuffers() {
@@ -90,7 +111,19 @@ void FrgRenderer::endFrame(bool compute) {
         throw std::runtime_error("failed to end recording command buffer!");
     }
 
-    auto result = frgSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex, compute);
+    // Uploads recorded so far become visible to this frame and every later one
+    frgDevice.uploader().flush();
+    frgDevice.uploader().collect();
+
+    uint64_t presentId = latencyMonitor.nextPresentId();
+    auto result = frgSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex, compute, presentId);
+    latencyMonitor.presented(presentId);
+    latencyMonitor.report();
+
+    // Before a recreation below, so the old swap chain is retired after this frame
+    frgDevice.deletionQueue().advance(
+        frgSwapChain->submittedGraphicsValue(), frgSwapChain->completedGraphicsValue()
+    );
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frgWindow.wasWindowResized()) {
         frgWindow.resetWindowResizedFlag();
@@ -99,10 +132,17 @@ void FrgRenderer::endFrame(bool compute) {
         throw std::runtime_error("failed to submit command buffers!");
     }
     isFrameStarted = false;
-    currentFrameIndex = (currentFrameIndex + 1) % FrgSwapChain::MAX_FRAMES_IN_FLIGHT;
+    currentFrameIndex = (currentFrameIndex + 1) % frgSwapChain->framesInFlight();
+}
+
+void FrgRenderer::setSharedDepthView(VkImageView depthView, VkExtent2D depthExtent) {
+    sharedDepthView = depthView;
+    sharedDepthExtent = depthExtent;
+    frgSwapChain->setSharedDepthView(depthView, depthExtent);
 }
 
-void FrgRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void FrgRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, bool reuseDepth,
+                                           VkSubpassContents contents) {
     assert(isFrameStarted && "Cannot call beginSwapChainRenderPass if frame not in progress");
     assert(
         commandBuffer == getCurrentCommandBuffer() &&
@@ -111,8 +151,16 @@ void FrgRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
 
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = frgSwapChain->getRenderPass();
-    renderPassInfo.framebuffer = frgSwapChain->getFrameBuffer(currentImageIndex);
+    if (reuseDepth && canReuseDepth()) {
+        renderPassInfo.renderPass = frgSwapChain->getDepthLoadRenderPass();
+        renderPassInfo.framebuffer = frgSwapChain->getSharedDepthFrameBuffer(currentImageIndex);
+    } else {
+        renderPassInfo.renderPass = frgSwapChain->getRenderPass();
+        renderPassInfo.framebuffer = frgSwapChain->getFrameBuffer(currentImageIndex);
+    }
+
+    activeRenderPass = renderPassInfo.renderPass;
+    activeFramebuffer = renderPassInfo.framebuffer;
 
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = frgSwapChain->getSwapChainExtent();
@@ -123,7 +171,10 @@ void FrgRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+    if (contents != VK_SUBPASS_CONTENTS_INLINE) {
+        return;
+    }
 
     VkViewport viewport{};
     viewport.x = 0.0f;
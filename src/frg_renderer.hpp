@@ -2,6 +2,7 @@
 
 #include "frg_descriptor.hpp"
 #include "frg_device.hpp"
+#include "frg_latency_monitor.hpp"
 #include "frg_model.hpp"
 #include "frg_pipeline.hpp"
 #include "frg_swap_chain.hpp"
@@ -23,6 +24,7 @@ public:
 
   VkRenderPass getSwapChainRenderPass() const { return frgSwapChain->getRenderPass(); }
   VkExtent2D getSwapChainExtent() const { return frgSwapChain->getSwapChainExtent(); }
+  VkFormat getSwapChainImageFormat() const { return frgSwapChain->getSwapChainImageFormat(); }
   float getAspectRatio() const { return frgSwapChain->extentAspectRatio(); }
 
   bool isFrameInProgress() const { return isFrameStarted; }
@@ -37,15 +39,32 @@ public:
     return currentFrameIndex;
   }
 
+  // Frames recorded ahead of the GPU, at most FrgSwapChain::MAX_FRAMES_IN_FLIGHT
+  uint32_t getFramesInFlight() const { return frgSwapChain->framesInFlight(); }
+  // Recreates the swap chain with the new frames in flight, present mode and image count
+  void setPresentConfig(const PresentConfig &config);
+  // Start of the input-to-present latency of the next frame, call after polling input
+  void markInputSample() { latencyMonitor.markInputSample(); }
+
   VkCommandBuffer beginFrame();
   void endFrame(bool compute = false);
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  // reuseDepth loads the shared depth (see setSharedDepthView) instead of clearing the swap chain depth
+  // Secondary contents leave viewport and scissor to the secondary command buffers
+  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, bool reuseDepth = false,
+                                VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+  // Render pass and framebuffer of the current swap chain pass, for secondary inheritance
+  VkRenderPass getActiveRenderPass() const { return activeRenderPass; }
+  VkFramebuffer getActiveFramebuffer() const { return activeFramebuffer; }
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
     void renderComputePipeline(
         std::vector<VkCommandBuffer> &buffers, FrgDescriptor &desc, VkPipelineLayout pipe_layout, VkPipeline pipeline,
         size_t particle_count, UniformBufferObject &ubo, std::vector<void *> &ubos_mapped
     );
 
+  // Depth written by an earlier pass (the G-buffer) that the final pass may test against
+  void setSharedDepthView(VkImageView depthView, VkExtent2D depthExtent);
+  bool canReuseDepth() const { return frgSwapChain->hasSharedDepth(); }
+
   // Delegate to swapchain
     void delegateComputeBindAndDraw(VkCommandBuffer comm_buff, std::vector<VkBuffer> &ssbos, uint32_t point_count);
 
@@ -58,6 +77,14 @@ private:
   FrgDevice &frgDevice;
   std::unique_ptr<FrgSwapChain> frgSwapChain;
   std::vector<VkCommandBuffer> commandBuffers;
+  PresentConfig presentConfig;
+  FrgLatencyMonitor latencyMonitor;
+
+  VkImageView sharedDepthView{VK_NULL_HANDLE};
+  VkExtent2D sharedDepthExtent{0, 0};
+
+  VkRenderPass activeRenderPass{VK_NULL_HANDLE};
+  VkFramebuffer activeFramebuffer{VK_NULL_HANDLE};
 
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
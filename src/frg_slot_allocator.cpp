@@ -0,0 +1,60 @@
+#include "frg_slot_allocator.hpp"
+
+// std
+#include <cassert>
+#include <iterator>
+
+namespace frg {
+
+FrgSlotAllocator::FrgSlotAllocator(uint32_t capacity) : capacity{capacity} {
+  if (capacity > 0) {
+    freeRuns[0] = capacity;
+  }
+}
+
+std::optional<uint32_t> FrgSlotAllocator::allocate(uint32_t count) {
+  assert(count > 0 && "Cannot allocate an empty run of slots");
+  for (auto it = freeRuns.begin(); it != freeRuns.end(); ++it) {
+    if (it->second < count) {
+      continue;
+    }
+
+    uint32_t first = it->first;
+    uint32_t remaining = it->second - count;
+    freeRuns.erase(it);
+    if (remaining > 0) {
+      freeRuns[first + count] = remaining;
+    }
+    usedCount += count;
+    return first;
+  }
+  return std::nullopt;
+}
+
+void FrgSlotAllocator::free(uint32_t first, uint32_t count) {
+  assert(count > 0 && first + count <= capacity && "Slots out of range");
+  usedCount -= count;
+
+  auto next = freeRuns.lower_bound(first);
+  assert((next == freeRuns.end() || first + count <= next->first) &&
+         "Slots freed twice");
+
+  // Merge with the run right after
+  if (next != freeRuns.end() && first + count == next->first) {
+    count += next->second;
+    next = freeRuns.erase(next);
+  }
+  // And with the run right before
+  if (next != freeRuns.begin()) {
+    auto previous = std::prev(next);
+    assert(previous->first + previous->second <= first &&
+           "Slots freed twice");
+    if (previous->first + previous->second == first) {
+      previous->second += count;
+      return;
+    }
+  }
+  freeRuns[first] = count;
+}
+
+} // namespace frg
@@ -0,0 +1,36 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace frg {
+
+/**
+ * Slot Allocator
+ *
+ * Hands out runs of consecutive slots from a fixed-size table, e.g. the
+ * bindless texture array. Freed runs go on a free list ordered by position and
+ * merge with their free neighbours, so a table that is filled and emptied
+ * again does not fragment. Allocation is first fit.
+ */
+class FrgSlotAllocator {
+public:
+  explicit FrgSlotAllocator(uint32_t capacity);
+
+  // First slot of count consecutive free slots; empty when no run fits
+  std::optional<uint32_t> allocate(uint32_t count = 1);
+  void free(uint32_t first, uint32_t count = 1);
+
+  uint32_t getCapacity() const { return capacity; }
+  uint32_t getUsedCount() const { return usedCount; }
+
+private:
+  uint32_t capacity;
+  uint32_t usedCount = 0;
+  // First slot -> length of each free run
+  std::map<uint32_t, uint32_t> freeRuns;
+};
+
+} // namespace frg
@@ -1,7 +1,8 @@
 #include "frg_ssao.hpp"
 
+#include <algorithm>
 #include <array>
-#include <cstring>
+#include <cassert>
 #include <random>
 #include <stdexcept>
 
@@ -10,68 +11,122 @@ namespace frg {
 // Lerp helper function
 static float lerp(float a, float b, float t) { return a + t * (b - a); }
 
-FrgSSAO::FrgSSAO(FrgDevice &device, VkExtent2D extent)
-    : device{device}, extent{extent} {
+FrgSSAO::FrgSSAO(FrgDevice &device, VkExtent2D extent,
+                 uint32_t resolutionDivisor, bool dynamicRendering)
+    : device{device}, extent{extent},
+      resolutionDivisor{resolutionDivisor} {
+  assert(isValidResolutionDivisor(resolutionDivisor) &&
+         "SSAO resolution divisor must be 1, 2 or 4");
+  aoExtent = {std::max(extent.width / this->resolutionDivisor, 1u),
+              std::max(extent.height / this->resolutionDivisor, 1u)};
+
+  // Compute SSAO needs r8 storage images
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), SSAO_FORMAT,
+                                      &formatProperties);
+  computeSupported = device.supportsStorageImageExtendedFormats() &&
+                     (formatProperties.optimalTilingFeatures &
+                      VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+
   generateKernel();
   createKernelBuffer();
   createNoiseTexture();
   createSSAOImage();
   createBlurImage();
+  createLowResImages();
+  createHistoryImages();
+  createTransientImages();
+  createImportanceImage();
   createSamplers();
-  createSSAORenderPass();
-  createBlurRenderPass();
-  createFramebuffers();
+  if (!dynamicRendering) {
+    createSSAORenderPass();
+    createBlurRenderPass();
+    createDownsampleRenderPass();
+    createTemporalRenderPass();
+    createDeinterleaveRenderPass();
+  }
+  createTargets();
 }
 
 FrgSSAO::~FrgSSAO() { cleanup(); }
 
 void FrgSSAO::resize(VkExtent2D newExtent) {
-  vkDeviceWaitIdle(device.device());
-
-  // Only need to recreate size-dependent resources
-  VkDevice dev = device.device();
+  // Only need to recreate size-dependent resources; frames in flight keep
+  // using the old ones until they finish
+  retireTargets();
+  retireColorTarget(blurredImage, blurredMemory, blurredImageView);
+  retireColorTarget(ssaoImage, ssaoMemory, ssaoImageView);
+  retireLowResImages();
+  retireHistoryImages();
+  retireTransientImages();
+  retireImportanceImage();
 
-  if (blurFramebuffer != VK_NULL_HANDLE) {
-    vkDestroyFramebuffer(dev, blurFramebuffer, nullptr);
-  }
-  if (ssaoFramebuffer != VK_NULL_HANDLE) {
-    vkDestroyFramebuffer(dev, ssaoFramebuffer, nullptr);
-  }
+  extent = newExtent;
+  aoExtent = {std::max(extent.width / resolutionDivisor, 1u),
+              std::max(extent.height / resolutionDivisor, 1u)};
+  createSSAOImage();
+  createBlurImage();
+  createLowResImages();
+  createHistoryImages();
+  createTransientImages();
+  createImportanceImage();
+  createTargets();
+}
 
-  if (blurredImageView != VK_NULL_HANDLE) {
-    vkDestroyImageView(dev, blurredImageView, nullptr);
-  }
-  if (blurredImage != VK_NULL_HANDLE) {
-    vkDestroyImage(dev, blurredImage, nullptr);
-  }
-  if (blurredMemory != VK_NULL_HANDLE) {
-    vkFreeMemory(dev, blurredMemory, nullptr);
-  }
+void FrgSSAO::setResolutionDivisor(uint32_t divisor) {
+  assert(isValidResolutionDivisor(divisor) &&
+         "SSAO resolution divisor must be 1, 2 or 4");
+  if (divisor == resolutionDivisor) {
+    return;
+  }
+
+  // The full-res blurred image stays, so descriptors that sample the final
+  // AO (lighting passes) remain valid
+  retireTargets();
+  retireColorTarget(ssaoImage, ssaoMemory, ssaoImageView);
+  retireLowResImages();
+  retireHistoryImages();
+  retireTransientImages();
+  retireImportanceImage();
+
+  resolutionDivisor = divisor;
+  aoExtent = {std::max(extent.width / resolutionDivisor, 1u),
+              std::max(extent.height / resolutionDivisor, 1u)};
+  createSSAOImage();
+  createLowResImages();
+  createHistoryImages();
+  createTransientImages();
+  createImportanceImage();
+  createTargets();
+}
 
-  if (ssaoImageView != VK_NULL_HANDLE) {
-    vkDestroyImageView(dev, ssaoImageView, nullptr);
-  }
-  if (ssaoImage != VK_NULL_HANDLE) {
-    vkDestroyImage(dev, ssaoImage, nullptr);
-  }
-  if (ssaoMemory != VK_NULL_HANDLE) {
-    vkFreeMemory(dev, ssaoMemory, nullptr);
+void FrgSSAO::retireTargets() {
+  for (FrgRenderTarget *target :
+       {&ssaoTarget, &blurTempTarget, &blurTarget, &downsampleTarget,
+        &upsampleTarget, &historyTargets[0], &historyTargets[1],
+        &deinterleaveTarget, &deinterleavedSSAOTarget}) {
+    device.deletionQueue().retireFramebuffer(target->framebuffer);
   }
+}
 
-  extent = newExtent;
-  createSSAOImage();
-  createBlurImage();
-  createFramebuffers();
+void FrgSSAO::retireLowResImages() {
+  retireColorTarget(lowNormalImage, lowNormalMemory, lowNormalImageView);
+  retireColorTarget(lowDepthImage, lowDepthMemory, lowDepthImageView);
 }
 
 void FrgSSAO::cleanup() {
   VkDevice dev = device.device();
 
-  if (blurFramebuffer != VK_NULL_HANDLE) {
-    vkDestroyFramebuffer(dev, blurFramebuffer, nullptr);
+  // Size-dependent targets take the same deferred path as on resize
+  retireTargets();
+  if (deinterleaveRenderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(dev, deinterleaveRenderPass, nullptr);
+  }
+  if (temporalRenderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(dev, temporalRenderPass, nullptr);
   }
-  if (ssaoFramebuffer != VK_NULL_HANDLE) {
-    vkDestroyFramebuffer(dev, ssaoFramebuffer, nullptr);
+  if (downsampleRenderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(dev, downsampleRenderPass, nullptr);
   }
   if (blurRenderPass != VK_NULL_HANDLE) {
     vkDestroyRenderPass(dev, blurRenderPass, nullptr);
@@ -85,28 +140,16 @@ void FrgSSAO::cleanup() {
   if (noiseSampler != VK_NULL_HANDLE) {
     vkDestroySampler(dev, noiseSampler, nullptr);
   }
-
-  // Blurred image
-  if (blurredImageView != VK_NULL_HANDLE) {
-    vkDestroyImageView(dev, blurredImageView, nullptr);
-  }
-  if (blurredImage != VK_NULL_HANDLE) {
-    vkDestroyImage(dev, blurredImage, nullptr);
-  }
-  if (blurredMemory != VK_NULL_HANDLE) {
-    vkFreeMemory(dev, blurredMemory, nullptr);
+  if (pointSampler != VK_NULL_HANDLE) {
+    vkDestroySampler(dev, pointSampler, nullptr);
   }
 
-  // SSAO image
-  if (ssaoImageView != VK_NULL_HANDLE) {
-    vkDestroyImageView(dev, ssaoImageView, nullptr);
-  }
-  if (ssaoImage != VK_NULL_HANDLE) {
-    vkDestroyImage(dev, ssaoImage, nullptr);
-  }
-  if (ssaoMemory != VK_NULL_HANDLE) {
-    vkFreeMemory(dev, ssaoMemory, nullptr);
-  }
+  retireLowResImages();
+  retireHistoryImages();
+  retireTransientImages();
+  retireImportanceImage();
+  retireColorTarget(blurredImage, blurredMemory, blurredImageView);
+  retireColorTarget(ssaoImage, ssaoMemory, ssaoImageView);
 
   // Noise
   if (noiseImageView != VK_NULL_HANDLE) {
@@ -135,7 +178,8 @@ void FrgSSAO::generateKernel() {
   std::default_random_engine generator;
   std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
 
-  kernel.resize(KERNEL_SIZE);
+  // Unused slots up to MAX_KERNEL_SIZE stay zero
+  kernel.assign(MAX_KERNEL_SIZE, glm::vec4(0.0f));
 
   for (int i = 0; i < KERNEL_SIZE; ++i) {
     // Random point in hemisphere (tangent space, +z is up)
@@ -158,34 +202,19 @@ void FrgSSAO::generateKernel() {
 }
 
 void FrgSSAO::createKernelBuffer() {
-  VkDeviceSize bufferSize = sizeof(glm::vec4) * KERNEL_SIZE;
-
-  // Create staging buffer
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingMemory;
-  device.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                      stagingBuffer, stagingMemory);
-
-  // Copy kernel data to staging buffer
-  void *data;
-  vkMapMemory(device.device(), stagingMemory, 0, bufferSize, 0, &data);
-  memcpy(data, kernel.data(), bufferSize);
-  vkUnmapMemory(device.device(), stagingMemory);
-
-  // Create device-local buffer
+  VkDeviceSize bufferSize = sizeof(glm::vec4) * MAX_KERNEL_SIZE;
+
   device.createBuffer(
       bufferSize,
       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, kernelBuffer, kernelMemory);
 
-  // Copy from staging to device
-  device.copyBuffer(stagingBuffer, kernelBuffer, bufferSize);
-
-  // Cleanup staging
-  vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-  vkFreeMemory(device.device(), stagingMemory, nullptr);
+  // Read by the fragment and compute SSAO passes
+  device.uploader().uploadBuffer(
+      kernelBuffer, kernel.data(), bufferSize,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_ACCESS_UNIFORM_READ_BIT);
 }
 
 void FrgSSAO::createNoiseTexture() {
@@ -207,19 +236,6 @@ void FrgSSAO::createNoiseTexture() {
 
   VkDeviceSize imageSize = NOISE_SIZE * NOISE_SIZE * sizeof(glm::vec4);
 
-  // Create staging buffer
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingMemory;
-  device.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                      stagingBuffer, stagingMemory);
-
-  void *data;
-  vkMapMemory(device.device(), stagingMemory, 0, imageSize, 0, &data);
-  memcpy(data, noiseData.data(), imageSize);
-  vkUnmapMemory(device.device(), stagingMemory);
-
   // Create noise image
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -240,59 +256,10 @@ void FrgSSAO::createNoiseTexture() {
   device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                              noiseImage, noiseMemory);
 
-  // Transition image layout and copy data
-  VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
-  // Transition to transfer dst
-  VkImageMemoryBarrier barrier{};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = noiseImage;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-  barrier.srcAccessMask = 0;
-  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
-                       nullptr, 1, &barrier);
-
-  // Copy buffer to image
-  VkBufferImageCopy region{};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = 1;
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {NOISE_SIZE, NOISE_SIZE, 1};
-
-  vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, noiseImage,
-                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-  // Transition to shader read
-  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
-                       nullptr, 1, &barrier);
-
-  device.endSingleTimeCommands(commandBuffer);
-
-  // Cleanup staging
-  vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-  vkFreeMemory(device.device(), stagingMemory, nullptr);
+  device.uploader().uploadImage(noiseImage, noiseData.data(), imageSize,
+                                NOISE_SIZE, NOISE_SIZE,
+                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
   // Create image view
   VkImageViewCreateInfo viewInfo{};
@@ -312,78 +279,232 @@ void FrgSSAO::createNoiseTexture() {
   }
 }
 
-void FrgSSAO::createSSAOImage() {
+VkImageCreateInfo FrgSSAO::colorTargetInfo(VkExtent2D size, VkFormat format,
+                                           VkImageUsageFlags extraUsage) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
-  imageInfo.extent.width = extent.width;
-  imageInfo.extent.height = extent.height;
+  imageInfo.extent.width = size.width;
+  imageInfo.extent.height = size.height;
   imageInfo.extent.depth = 1;
   imageInfo.mipLevels = 1;
   imageInfo.arrayLayers = 1;
-  imageInfo.format = SSAO_FORMAT;
+  imageInfo.format = format;
   imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
   imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  imageInfo.usage =
-      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT | extraUsage;
   imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
   imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  return imageInfo;
+}
 
-  device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                             ssaoImage, ssaoMemory);
+void FrgSSAO::createColorTarget(VkExtent2D size, VkFormat format,
+                                VkImage &image, VkDeviceMemory &memory,
+                                VkImageView &view,
+                                VkImageUsageFlags extraUsage) {
+  device.createImageWithInfo(colorTargetInfo(size, format, extraUsage),
+                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image,
+                             memory);
+  createColorTargetView(image, format, view);
+}
 
+void FrgSSAO::createAliasedColorTargets(
+    const std::vector<AliasedTarget> &targets, VkDeviceMemory &memory) {
+  std::vector<VkImageCreateInfo> imageInfos;
+  for (const AliasedTarget &target : targets) {
+    imageInfos.push_back(
+        colorTargetInfo(target.size, target.format, target.extraUsage));
+  }
+  std::vector<VkImage> images;
+  device.createAliasedImages(imageInfos, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                             images, memory);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    *targets[i].image = images[i];
+    createColorTargetView(images[i], targets[i].format, *targets[i].view);
+  }
+}
+
+void FrgSSAO::createColorTargetView(VkImage image, VkFormat format,
+                                    VkImageView &view) {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-  viewInfo.image = ssaoImage;
+  viewInfo.image = image;
   viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-  viewInfo.format = SSAO_FORMAT;
+  viewInfo.format = format;
   viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   viewInfo.subresourceRange.baseMipLevel = 0;
   viewInfo.subresourceRange.levelCount = 1;
   viewInfo.subresourceRange.baseArrayLayer = 0;
   viewInfo.subresourceRange.layerCount = 1;
 
-  if (vkCreateImageView(device.device(), &viewInfo, nullptr, &ssaoImageView) !=
+  if (vkCreateImageView(device.device(), &viewInfo, nullptr, &view) !=
       VK_SUCCESS) {
-    throw std::runtime_error("Failed to create SSAO image view!");
+    throw std::runtime_error("Failed to create SSAO target image view!");
   }
 }
 
+void FrgSSAO::retireColorTarget(VkImage &image, VkDeviceMemory &memory,
+                                VkImageView &view) {
+  device.deletionQueue().retireImage(image, memory, view);
+}
+
+void FrgSSAO::createSSAOImage() {
+  // Raw occlusion and the horizontal blur run at the reduced AO resolution
+  createColorTarget(aoExtent, SSAO_FORMAT, ssaoImage, ssaoMemory,
+                    ssaoImageView,
+                    computeSupported ? VK_IMAGE_USAGE_STORAGE_BIT : 0);
+}
+
 void FrgSSAO::createBlurImage() {
-  VkImageCreateInfo imageInfo{};
-  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-  imageInfo.imageType = VK_IMAGE_TYPE_2D;
-  imageInfo.extent.width = extent.width;
-  imageInfo.extent.height = extent.height;
-  imageInfo.extent.depth = 1;
-  imageInfo.mipLevels = 1;
-  imageInfo.arrayLayers = 1;
-  imageInfo.format = SSAO_FORMAT;
-  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  imageInfo.usage =
-      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  // Final (upsampled) result always matches the G-buffer resolution
+  createColorTarget(extent, SSAO_FORMAT, blurredImage, blurredMemory,
+                    blurredImageView,
+                    computeSupported ? VK_IMAGE_USAGE_STORAGE_BIT : 0);
+}
 
-  device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                             blurredImage, blurredMemory);
+void FrgSSAO::createLowResImages() {
+  if (!isReducedResolution()) {
+    return;
+  }
 
-  VkImageViewCreateInfo viewInfo{};
-  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-  viewInfo.image = blurredImage;
-  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-  viewInfo.format = SSAO_FORMAT;
-  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  viewInfo.subresourceRange.baseMipLevel = 0;
-  viewInfo.subresourceRange.levelCount = 1;
-  viewInfo.subresourceRange.baseArrayLayer = 0;
-  viewInfo.subresourceRange.layerCount = 1;
+  createColorTarget(aoExtent, LOW_DEPTH_FORMAT, lowDepthImage, lowDepthMemory,
+                    lowDepthImageView);
+  createColorTarget(aoExtent, FrgGBuffer::NORMAL_FORMAT, lowNormalImage,
+                    lowNormalMemory, lowNormalImageView);
+}
+
+void FrgSSAO::createHistoryImages() {
+  for (size_t i = 0; i < historyImages.size(); ++i) {
+    createColorTarget(aoExtent, HISTORY_FORMAT, historyImages[i],
+                      historyMemories[i], historyImageViews[i]);
+  }
 
-  if (vkCreateImageView(device.device(), &viewInfo, nullptr,
-                        &blurredImageView) != VK_SUCCESS) {
-    throw std::runtime_error("Failed to create blurred SSAO image view!");
+  // The temporal pass always samples the previous history, even before it
+  // has been written, so both images start out shader-readable. Recorded
+  // for the next frame rather than waited on, as resizes happen mid-run.
+  for (VkImage image : historyImages) {
+    device.uploader().initializeImage(
+        image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
   }
+
+  historyIndex = 0;
+  historyValid = false;
+}
+
+void FrgSSAO::retireHistoryImages() {
+  for (size_t i = 0; i < historyImages.size(); ++i) {
+    retireColorTarget(historyImages[i], historyMemories[i],
+                      historyImageViews[i]);
+  }
+}
+
+VkExtent2D FrgSSAO::getDeinterleavedTileExtent() const {
+  return {(aoExtent.width + DEINTERLEAVE - 1) / DEINTERLEAVE,
+          (aoExtent.height + DEINTERLEAVE - 1) / DEINTERLEAVE};
+}
+
+VkExtent2D FrgSSAO::getDeinterleavedExtent() const {
+  VkExtent2D tile = getDeinterleavedTileExtent();
+  return {tile.width * DEINTERLEAVE, tile.height * DEINTERLEAVE};
+}
+
+void FrgSSAO::createTransientImages() {
+  // Pairs whose contents never live at the same time in any mode: the
+  // atlases are consumed by the SSAO and reinterleave passes before the
+  // blur starts, and the compute path uses neither atlas
+  VkExtent2D atlasExtent = getDeinterleavedExtent();
+  createAliasedColorTargets(
+      {{atlasExtent, LOW_DEPTH_FORMAT, &deinterleavedDepthImage,
+        &deinterleavedDepthImageView},
+       {aoExtent, SSAO_FORMAT, &blurTempImage, &blurTempImageView}},
+      transientMemories[0]);
+
+  std::vector<AliasedTarget> aoTargets{{atlasExtent, SSAO_FORMAT,
+                                        &deinterleavedAOImage,
+                                        &deinterleavedAOImageView}};
+  if (isReducedResolution()) {
+    aoTargets.push_back({aoExtent, SSAO_FORMAT, &blurLowImage,
+                         &blurLowImageView,
+                         computeSupported ? VK_IMAGE_USAGE_STORAGE_BIT : 0});
+  }
+  createAliasedColorTargets(aoTargets, transientMemories[1]);
+}
+
+void FrgSSAO::retireTransientImages() {
+  // The memory goes with the last image bound to it
+  VkDeviceMemory shared = VK_NULL_HANDLE;
+  retireColorTarget(blurLowImage, shared, blurLowImageView);
+  retireColorTarget(deinterleavedAOImage, transientMemories[1],
+                    deinterleavedAOImageView);
+  retireColorTarget(blurTempImage, shared, blurTempImageView);
+  retireColorTarget(deinterleavedDepthImage, transientMemories[0],
+                    deinterleavedDepthImageView);
+}
+
+FrgSSAO::GraphImages FrgSSAO::importImages(FrgRenderGraph &graph) const {
+  using Resource = FrgRenderGraph::Resource;
+  constexpr VkImageAspectFlags COLOR = VK_IMAGE_ASPECT_COLOR_BIT;
+  constexpr VkPipelineStageFlags SHADER_STAGES =
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  auto transient = [&](const char *name, VkImage image) -> Resource {
+    if (image == VK_NULL_HANDLE) {
+      return FrgRenderGraph::NO_RESOURCE;
+    }
+    return graph.importImage(name, image, COLOR, VK_IMAGE_LAYOUT_UNDEFINED,
+                             SHADER_STAGES);
+  };
+
+  GraphImages images{};
+  images.ssao = transient("ssao", ssaoImage);
+  images.blurred = transient("ssao blurred", blurredImage);
+  images.lowDepth = transient("ssao low depth", lowDepthImage);
+  images.lowNormal = transient("ssao low normal", lowNormalImage);
+  images.deinterleavedDepth =
+      transient("ssao deinterleaved depth", deinterleavedDepthImage);
+  images.blurTemp = transient("ssao blur temp", blurTempImage);
+  images.deinterleavedAO =
+      transient("ssao deinterleaved ao", deinterleavedAOImage);
+  images.blurLow = transient("ssao blur low", blurLowImage);
+  graph.alias(images.deinterleavedDepth, images.blurTemp);
+  if (images.blurLow != FrgRenderGraph::NO_RESOURCE) {
+    graph.alias(images.deinterleavedAO, images.blurLow);
+  }
+
+  // Kept across frames: the temporal pass reads last frame's history, and
+  // the importance map stays in GENERAL (see createImportanceImage)
+  for (size_t i = 0; i < historyImages.size(); ++i) {
+    images.history[i] = graph.importImage(
+        "ssao history", historyImages[i], COLOR,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  }
+  images.importance =
+      graph.importImage("ssao importance", importanceImage, COLOR,
+                        VK_IMAGE_LAYOUT_GENERAL, SHADER_STAGES);
+  return images;
+}
+
+VkExtent2D FrgSSAO::getImportanceExtent() const {
+  return {(aoExtent.width + ADAPTIVE_TILE - 1) / ADAPTIVE_TILE,
+          (aoExtent.height + ADAPTIVE_TILE - 1) / ADAPTIVE_TILE};
+}
+
+void FrgSSAO::createImportanceImage() {
+  createColorTarget(getImportanceExtent(), IMPORTANCE_FORMAT, importanceImage,
+                    importanceMemory, importanceImageView,
+                    VK_IMAGE_USAGE_STORAGE_BIT);
+
+  // Written by compute and sampled by SSAO every frame: stays in GENERAL
+  device.uploader().initializeImage(importanceImage, VK_IMAGE_LAYOUT_GENERAL,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void FrgSSAO::retireImportanceImage() {
+  retireColorTarget(importanceImage, importanceMemory, importanceImageView);
 }
 
 void FrgSSAO::createSamplers() {
@@ -411,6 +532,18 @@ void FrgSSAO::createSamplers() {
     throw std::runtime_error("Failed to create SSAO sampler!");
   }
 
+  // Sampler for low-res depth and octahedral normals: blending depths
+  // across an edge or packed normals yields values that exist nowhere in
+  // the scene, so fetch them unfiltered like the G-buffer does
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+  if (vkCreateSampler(device.device(), &samplerInfo, nullptr,
+                      &pointSampler) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO point sampler!");
+  }
+
   // Sampler for noise texture (repeat for tiling)
   VkSamplerCreateInfo noiseSamplerInfo{};
   noiseSamplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -444,8 +577,10 @@ void FrgSSAO::createSSAORenderPass() {
   attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  // The target stays in the attachment layout, FrgRenderGraph does the
+  // transitions around the pass (same for the other SSAO render passes)
+  attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
   VkAttachmentReference colorRef{};
   colorRef.attachment = 0;
@@ -456,32 +591,12 @@ void FrgSSAO::createSSAORenderPass() {
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &colorRef;
 
-  std::array<VkSubpassDependency, 2> dependencies{};
-
-  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependencies[0].dstSubpass = 0;
-  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-  dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-  dependencies[1].srcSubpass = 0;
-  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = 1;
   renderPassInfo.pAttachments = &attachment;
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
                          &ssaoRenderPass) != VK_SUCCESS) {
@@ -497,8 +612,8 @@ void FrgSSAO::createBlurRenderPass() {
   attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
   VkAttachmentReference colorRef{};
   colorRef.attachment = 0;
@@ -509,32 +624,12 @@ void FrgSSAO::createBlurRenderPass() {
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &colorRef;
 
-  std::array<VkSubpassDependency, 2> dependencies{};
-
-  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependencies[0].dstSubpass = 0;
-  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-  dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-  dependencies[1].srcSubpass = 0;
-  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = 1;
   renderPassInfo.pAttachments = &attachment;
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
                          &blurRenderPass) != VK_SUCCESS) {
@@ -542,42 +637,198 @@ void FrgSSAO::createBlurRenderPass() {
   }
 }
 
-void FrgSSAO::createFramebuffers() {
-  // SSAO framebuffer
-  {
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = ssaoRenderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = &ssaoImageView;
-    framebufferInfo.width = extent.width;
-    framebufferInfo.height = extent.height;
-    framebufferInfo.layers = 1;
+void FrgSSAO::createDownsampleRenderPass() {
+  // Two attachments: downsampled depth and normal
+  std::array<VkAttachmentDescription, 2> attachments{};
+  for (auto &attachment : attachments) {
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  }
+  attachments[0].format = LOW_DEPTH_FORMAT;
+  attachments[1].format = FrgGBuffer::NORMAL_FORMAT;
+
+  std::array<VkAttachmentReference, 2> colorRefs{};
+  colorRefs[0] = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  colorRefs[1] = {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
 
-    if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr,
-                            &ssaoFramebuffer) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create SSAO framebuffer!");
-    }
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+  subpass.pColorAttachments = colorRefs.data();
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
+                         &downsampleRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO downsample render pass!");
   }
+}
 
-  // Blur framebuffer
-  {
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = blurRenderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = &blurredImageView;
-    framebufferInfo.width = extent.width;
-    framebufferInfo.height = extent.height;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr,
-                            &blurFramebuffer) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create blur framebuffer!");
-    }
+void FrgSSAO::createTemporalRenderPass() {
+  // Every texel of the history is rewritten, so the old contents are dropped
+  VkAttachmentDescription attachment{};
+  attachment.format = HISTORY_FORMAT;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorRef{};
+  colorRef.attachment = 0;
+  colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorRef;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &attachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
+                         &temporalRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO temporal render pass!");
   }
 }
 
+void FrgSSAO::createDeinterleaveRenderPass() {
+  // Every atlas texel is written, so the old contents are dropped
+  VkAttachmentDescription attachment{};
+  attachment.format = LOW_DEPTH_FORMAT;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorRef{};
+  colorRef.attachment = 0;
+  colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorRef;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &attachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
+                         &deinterleaveRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO deinterleave render pass!");
+  }
+}
+
+VkFramebuffer FrgSSAO::createFramebuffer(VkRenderPass renderPass,
+                                         const std::vector<VkImageView> &views,
+                                         VkExtent2D size) {
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+  framebufferInfo.pAttachments = views.data();
+  framebufferInfo.width = size.width;
+  framebufferInfo.height = size.height;
+  framebufferInfo.layers = 1;
+
+  VkFramebuffer framebuffer;
+  if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr,
+                          &framebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO framebuffer!");
+  }
+  return framebuffer;
+}
+
+FrgRenderTarget FrgSSAO::createTarget(VkRenderPass renderPass,
+                                      VkAttachmentLoadOp loadOp,
+                                      const std::vector<VkFormat> &formats,
+                                      const std::vector<VkImageView> &views,
+                                      VkExtent2D size) {
+  FrgRenderTarget target;
+  target.renderPass = renderPass;
+  target.extent = size;
+  target.colorCount = static_cast<uint32_t>(formats.size());
+  target.loadOp = loadOp;
+  for (size_t i = 0; i < formats.size(); ++i) {
+    target.colorFormats[i] = formats[i];
+    target.colorViews[i] = i < views.size() ? views[i] : VK_NULL_HANDLE;
+  }
+  if (!target.isDynamic() && !views.empty()) {
+    target.framebuffer = createFramebuffer(renderPass, views, size);
+  }
+  return target;
+}
+
+void FrgSSAO::createTargets() {
+  // Load ops as in the render passes: the AO and blur targets clear to no
+  // occlusion, the others are overwritten completely
+  constexpr VkAttachmentLoadOp CLEAR = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  constexpr VkAttachmentLoadOp DONT_CARE = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+  // SSAO and blur run at the AO resolution
+  ssaoTarget = createTarget(ssaoRenderPass, CLEAR, {SSAO_FORMAT},
+                            {ssaoImageView}, aoExtent);
+  blurTempTarget = createTarget(blurRenderPass, CLEAR, {SSAO_FORMAT},
+                                {blurTempImageView}, aoExtent);
+  for (size_t i = 0; i < historyTargets.size(); ++i) {
+    historyTargets[i] =
+        createTarget(temporalRenderPass, DONT_CARE, {HISTORY_FORMAT},
+                     {historyImageViews[i]}, aoExtent);
+  }
+  deinterleaveTarget =
+      createTarget(deinterleaveRenderPass, DONT_CARE, {LOW_DEPTH_FORMAT},
+                   {deinterleavedDepthImageView}, getDeinterleavedExtent());
+  deinterleavedSSAOTarget =
+      createTarget(ssaoRenderPass, CLEAR, {SSAO_FORMAT},
+                   {deinterleavedAOImageView}, getDeinterleavedExtent());
+
+  std::vector<VkFormat> downsampleFormats = {LOW_DEPTH_FORMAT,
+                                             FrgGBuffer::NORMAL_FORMAT};
+  if (!isReducedResolution()) {
+    // Full resolution: blur writes the final result directly
+    blurTarget = createTarget(blurRenderPass, CLEAR, {SSAO_FORMAT},
+                              {blurredImageView}, aoExtent);
+    downsampleTarget = createTarget(downsampleRenderPass, DONT_CARE,
+                                    downsampleFormats, {}, aoExtent);
+    upsampleTarget =
+        createTarget(blurRenderPass, CLEAR, {SSAO_FORMAT}, {}, extent);
+    return;
+  }
+
+  downsampleTarget =
+      createTarget(downsampleRenderPass, DONT_CARE, downsampleFormats,
+                   {lowDepthImageView, lowNormalImageView}, aoExtent);
+  blurTarget = createTarget(blurRenderPass, CLEAR, {SSAO_FORMAT},
+                            {blurLowImageView}, aoExtent);
+
+  // Bilateral upsample writes the full-res result (blur target formats)
+  upsampleTarget = createTarget(blurRenderPass, CLEAR, {SSAO_FORMAT},
+                                {blurredImageView}, extent);
+}
+
 VkDescriptorImageInfo FrgSSAO::getSSAODescriptor() const {
   VkDescriptorImageInfo info{};
   info.sampler = sampler;
@@ -602,11 +853,92 @@ VkDescriptorImageInfo FrgSSAO::getNoiseDescriptor() const {
   return info;
 }
 
+VkDescriptorImageInfo FrgSSAO::getLowDepthDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = pointSampler;
+  info.imageView = lowDepthImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getLowNormalDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = pointSampler;
+  info.imageView = lowNormalImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getBlurLowDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = sampler;
+  info.imageView = blurLowImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getBlurTempDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = sampler;
+  info.imageView = blurTempImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getHistoryDescriptor(uint32_t index) const {
+  VkDescriptorImageInfo info{};
+  info.sampler = sampler;
+  info.imageView = historyImageViews[index];
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getImportanceDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = sampler;
+  info.imageView = importanceImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getDeinterleavedDepthDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = pointSampler;
+  info.imageView = deinterleavedDepthImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getDeinterleavedAODescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = sampler;
+  info.imageView = deinterleavedAOImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getSSAOStorageDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = VK_NULL_HANDLE;
+  info.imageView = ssaoImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+  return info;
+}
+
+VkDescriptorImageInfo FrgSSAO::getBlurStorageDescriptor() const {
+  VkDescriptorImageInfo info{};
+  info.sampler = VK_NULL_HANDLE;
+  info.imageView =
+      isReducedResolution() ? blurLowImageView : blurredImageView;
+  info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+  return info;
+}
+
 VkDescriptorBufferInfo FrgSSAO::getKernelDescriptor() const {
   VkDescriptorBufferInfo info{};
   info.buffer = kernelBuffer;
   info.offset = 0;
-  info.range = sizeof(glm::vec4) * KERNEL_SIZE;
+  info.range = sizeof(glm::vec4) * MAX_KERNEL_SIZE;
   return info;
 }
 
@@ -2,6 +2,8 @@
 
 #include "frg_device.hpp"
 #include "frg_gbuffer.hpp"
+#include "frg_render_graph.hpp"
+#include "frg_render_target.hpp"
 
 // libs
 #include <glm/glm.hpp>
@@ -10,6 +12,7 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
 #include <vector>
 
 namespace frg {
@@ -22,30 +25,157 @@ namespace frg {
  * 2. Create 4x4 noise texture for random rotations
  * 3. SSAO pass: calculate occlusion using G-buffer
  * 4. Blur pass: smooth the noisy SSAO output
+ *
+ * With a resolution divisor > 1, SSAO and blur run at 1/divisor resolution:
+ * a downsample pass first reduces the G-buffer to low-res depth/normal
+ * targets, and a depth/normal-aware bilateral upsample writes the full-res
+ * blurred result that the lighting pass reads.
+ *
+ * Temporal mode spreads the kernel over TEMPORAL_SLICES frames: each frame
+ * evaluates one interleaved slice, and a temporal pass blends it into a
+ * ping-pong history (AO + view depth) reprojected from the previous frame.
+ *
+ * Deinterleaved mode splits the AO-resolution depth into DEINTERLEAVE^2
+ * quarter-resolution layers, one per noise texel, packed as tiles of one
+ * atlas. SSAO runs per tile with a constant rotation, so neighbouring pixels
+ * fetch neighbouring depth texels, and a reinterleave pass writes the result
+ * back into the regular SSAO target.
+ *
+ * Adaptive sampling gives every ADAPTIVE_TILE^2 block of AO pixels its own
+ * sample count (importance map), from the block's depth/normal variance and
+ * projected kernel radius, so flat or distant regions take fewer samples.
+ *
+ * The render passes are recorded through FrgRenderGraph (importImages). The
+ * deinterleaved atlases share memory with the blur intermediates, which are
+ * only written after the atlases have been consumed.
+ *
+ * Every pass draws to one of the FrgRenderTargets below. With dynamic
+ * rendering they have no render passes or framebuffers, so resize and
+ * setResolutionDivisor only recreate images and views.
  */
 class FrgSSAO {
 public:
   // SSAO parameters
-  static constexpr int KERNEL_SIZE = 64;
+  // The edge-aware blur removes most of the noise, so half of the kernel
+  // slots are enough; the UBO keeps MAX_KERNEL_SIZE entries (shader layout)
+  static constexpr int MAX_KERNEL_SIZE = 64;
+  static constexpr int KERNEL_SIZE = 32;
   static constexpr int NOISE_SIZE = 4; // 4x4 noise texture
   static constexpr float RADIUS = 0.5f;
   static constexpr float BIAS = 0.025f;
 
-  FrgSSAO(FrgDevice &device, VkExtent2D extent);
+  // Horizon-based mode: directions * steps equals KERNEL_SIZE, so both modes
+  // fetch the same number of depth samples per pixel
+  static constexpr int HBAO_DIRECTIONS = 4;
+  static constexpr int HBAO_STEPS = 8;
+  static constexpr float HBAO_ANGLE_BIAS = 0.1f; // sine of the ignored cone
+
+  // Bilateral blur parameters (taps per pass = 2 * radius + 1)
+  static constexpr int DEFAULT_BLUR_RADIUS = 3;
+  static constexpr int MAX_BLUR_RADIUS = 8; // apron of ssao_blur.comp
+  static constexpr float BLUR_DEPTH_SIGMA = 0.05f; // relative to view depth
+
+  // Deinterleaved layers per axis (one per noise texel)
+  static constexpr uint32_t DEINTERLEAVE = NOISE_SIZE;
+
+  // Adaptive sampling: one importance texel per ADAPTIVE_TILE^2 AO pixels;
+  // flat regions drop to ADAPTIVE_MIN_SAMPLES of KERNEL_SIZE
+  static constexpr uint32_t ADAPTIVE_TILE = 4;
+  static constexpr int ADAPTIVE_MIN_SAMPLES = 8;
+
+  // Temporal accumulation parameters
+  static constexpr int TEMPORAL_SLICES = 8; // kernel samples per frame / 8
+  // Smallest runtime kernel (power of two); keeps a sample per temporal slice
+  static constexpr int MIN_KERNEL_SIZE = TEMPORAL_SLICES;
+  static constexpr float TEMPORAL_BLEND = 0.1f; // weight of the new frame
+  // Relative view-depth mismatch that rejects history (disocclusion)
+  static constexpr float TEMPORAL_DEPTH_TOLERANCE = 0.05f;
+
+  // dynamicRendering: requires FrgDevice::supportsDynamicRendering()
+  FrgSSAO(FrgDevice &device, VkExtent2D extent, uint32_t resolutionDivisor = 1,
+          bool dynamicRendering = false);
   ~FrgSSAO();
 
   FrgSSAO(const FrgSSAO &) = delete;
   FrgSSAO &operator=(const FrgSSAO &) = delete;
 
-  // Recreate for new window size
+  // Graph handles of the SSAO images for one frame. Images that do not
+  // exist in the current mode are FrgRenderGraph::NO_RESOURCE.
+  struct GraphImages {
+    FrgRenderGraph::Resource ssao;
+    FrgRenderGraph::Resource blurTemp;
+    FrgRenderGraph::Resource blurLow;
+    FrgRenderGraph::Resource blurred;
+    FrgRenderGraph::Resource lowDepth;
+    FrgRenderGraph::Resource lowNormal;
+    FrgRenderGraph::Resource deinterleavedDepth;
+    FrgRenderGraph::Resource deinterleavedAO;
+    FrgRenderGraph::Resource importance;
+    std::array<FrgRenderGraph::Resource, 2> history;
+  };
+  GraphImages importImages(FrgRenderGraph &graph) const;
+
+  // Recreate for new window size. Like setResolutionDivisor it does not wait
+  // for the device: replaced targets go to the deletion queue, and their
+  // descriptors have to be replaced (SSAORenderSystem::updateDescriptorSets).
   void resize(VkExtent2D newExtent);
 
+  // Switch between full (1), half (2) and quarter (4) resolution AO. Only the
+  // low-res targets are rebuilt; the blurred output keeps its image view.
+  void setResolutionDivisor(uint32_t divisor);
+  // The downsample and bilateral upsample passes only handle these
+  static constexpr bool isValidResolutionDivisor(uint32_t divisor) {
+    return divisor == 1 || divisor == 2 || divisor == 4;
+  }
+  uint32_t getResolutionDivisor() const { return resolutionDivisor; }
+  bool isReducedResolution() const { return resolutionDivisor > 1; }
+
+  // The compute path writes the AO targets as r8 storage images
+  bool supportsCompute() const { return computeSupported; }
+
+  // Ping-pong history for temporal SSAO. swapHistory() once per frame before
+  // the temporal pass; it then writes history[getHistoryIndex()] and reads
+  // the other one. The history is invalid until a frame has been written
+  // since it was (re)created or last invalidated.
+  void swapHistory() { historyIndex ^= 1; }
+  uint32_t getHistoryIndex() const { return historyIndex; }
+  bool isHistoryValid() const { return historyValid; }
+  void setHistoryValid(bool valid) { historyValid = valid; }
+
+  // Render targets. Targets of images the current mode does not have keep
+  // their formats (for pipeline creation) but no views.
+  const FrgRenderTarget &getSSAOTarget() const { return ssaoTarget; }
+  const FrgRenderTarget &getBlurTarget() const { return blurTarget; }
+  // Horizontal blur target (vertical pass then writes the blur target)
+  const FrgRenderTarget &getBlurTempTarget() const { return blurTempTarget; }
+  const FrgRenderTarget &getDownsampleTarget() const {
+    return downsampleTarget;
+  }
+  const FrgRenderTarget &getUpsampleTarget() const { return upsampleTarget; }
+  const FrgRenderTarget &getHistoryTarget() const {
+    return historyTargets[historyIndex];
+  }
+  // Depth atlas target, and the AO atlas (same formats as the SSAO target)
+  const FrgRenderTarget &getDeinterleaveTarget() const {
+    return deinterleaveTarget;
+  }
+  const FrgRenderTarget &getDeinterleavedSSAOTarget() const {
+    return deinterleavedSSAOTarget;
+  }
+  // Full-res blurred result; same formats as the blur target
+  const FrgRenderTarget &getOutputTarget() const {
+    return isReducedResolution() ? upsampleTarget : blurTarget;
+  }
+
   // Accessors
-  VkRenderPass getSSAORenderPass() const { return ssaoRenderPass; }
-  VkRenderPass getBlurRenderPass() const { return blurRenderPass; }
-  VkFramebuffer getSSAOFramebuffer() const { return ssaoFramebuffer; }
-  VkFramebuffer getBlurFramebuffer() const { return blurFramebuffer; }
+  // Full (output) extent and the extent SSAO/blur actually run at
   VkExtent2D getExtent() const { return extent; }
+  VkExtent2D getAOExtent() const { return aoExtent; }
+  // Size of one deinterleaved layer; the atlas is DEINTERLEAVE tiles of it
+  // per axis (AO extent rounded up to a multiple of DEINTERLEAVE)
+  VkExtent2D getDeinterleavedTileExtent() const;
+  VkExtent2D getDeinterleavedExtent() const;
+  VkExtent2D getImportanceExtent() const;
 
   // SSAO output (after blur)
   VkImageView getSSAOImageView() const { return ssaoImageView; }
@@ -65,6 +195,21 @@ public:
   VkDescriptorImageInfo getBlurredDescriptor() const;
   VkDescriptorImageInfo getNoiseDescriptor() const;
   VkDescriptorBufferInfo getKernelDescriptor() const;
+  // Low-res inputs/outputs (only valid when isReducedResolution())
+  VkDescriptorImageInfo getLowDepthDescriptor() const;
+  VkDescriptorImageInfo getLowNormalDescriptor() const;
+  VkDescriptorImageInfo getBlurLowDescriptor() const;
+  VkDescriptorImageInfo getBlurTempDescriptor() const;
+  // Temporal history (AO in r, linear view depth in g)
+  VkDescriptorImageInfo getHistoryDescriptor(uint32_t index) const;
+  // Per-tile sample counts, GENERAL layout (sampled and storage)
+  VkDescriptorImageInfo getImportanceDescriptor() const;
+  // Deinterleaved depth and AO atlases
+  VkDescriptorImageInfo getDeinterleavedDepthDescriptor() const;
+  VkDescriptorImageInfo getDeinterleavedAODescriptor() const;
+  // Storage image views in GENERAL layout (compute path only)
+  VkDescriptorImageInfo getSSAOStorageDescriptor() const;
+  VkDescriptorImageInfo getBlurStorageDescriptor() const;
 
 private:
   void generateKernel();
@@ -72,14 +217,59 @@ private:
   void createKernelBuffer();
   void createSSAOImage();
   void createBlurImage();
+  void createLowResImages();
+  void createHistoryImages();
+  void retireHistoryImages();
+  void createTransientImages();
+  void retireTransientImages();
+  void createImportanceImage();
+  void retireImportanceImage();
   void createSamplers();
   void createSSAORenderPass();
   void createBlurRenderPass();
-  void createFramebuffers();
+  void createDownsampleRenderPass();
+  void createTemporalRenderPass();
+  void createDeinterleaveRenderPass();
+  void createTargets();
+  void retireTargets();
+  void retireLowResImages();
   void cleanup();
 
+  struct AliasedTarget {
+    VkExtent2D size;
+    VkFormat format;
+    VkImage *image;
+    VkImageView *view;
+    VkImageUsageFlags extraUsage = 0;
+  };
+
+  static VkImageCreateInfo colorTargetInfo(VkExtent2D size, VkFormat format,
+                                           VkImageUsageFlags extraUsage);
+  void createColorTarget(VkExtent2D size, VkFormat format, VkImage &image,
+                         VkDeviceMemory &memory, VkImageView &view,
+                         VkImageUsageFlags extraUsage = 0);
+  // Binds all targets to the start of one allocation
+  void createAliasedColorTargets(const std::vector<AliasedTarget> &targets,
+                                 VkDeviceMemory &memory);
+  void createColorTargetView(VkImage image, VkFormat format,
+                             VkImageView &view);
+  void retireColorTarget(VkImage &image, VkDeviceMemory &memory,
+                         VkImageView &view);
+  VkFramebuffer createFramebuffer(VkRenderPass renderPass,
+                                  const std::vector<VkImageView> &views,
+                                  VkExtent2D size);
+  // The framebuffer is only created with a render pass and views
+  FrgRenderTarget createTarget(VkRenderPass renderPass,
+                               VkAttachmentLoadOp loadOp,
+                               const std::vector<VkFormat> &formats,
+                               const std::vector<VkImageView> &views,
+                               VkExtent2D size);
+
   FrgDevice &device;
   VkExtent2D extent;
+  VkExtent2D aoExtent;
+  uint32_t resolutionDivisor;
+  bool computeSupported = false;
 
   // Sample kernel (hemisphere samples in tangent space)
   std::vector<glm::vec4> kernel; // vec4 for std140 alignment
@@ -92,24 +282,81 @@ private:
   VkImageView noiseImageView = VK_NULL_HANDLE;
   VkSampler noiseSampler = VK_NULL_HANDLE;
 
+  // Downsampled G-buffer (reduced resolution only)
+  VkImage lowDepthImage = VK_NULL_HANDLE;
+  VkDeviceMemory lowDepthMemory = VK_NULL_HANDLE;
+  VkImageView lowDepthImageView = VK_NULL_HANDLE;
+  VkImage lowNormalImage = VK_NULL_HANDLE;
+  VkDeviceMemory lowNormalMemory = VK_NULL_HANDLE;
+  VkImageView lowNormalImageView = VK_NULL_HANDLE;
+
+  // Temporal history (AO resolution, ping-pong)
+  std::array<VkImage, 2> historyImages{};
+  std::array<VkDeviceMemory, 2> historyMemories{};
+  std::array<VkImageView, 2> historyImageViews{};
+  std::array<FrgRenderTarget, 2> historyTargets{};
+  uint32_t historyIndex = 0;
+  bool historyValid = false;
+
+  // Deinterleaved atlases (AO resolution rounded up to whole tiles)
+  VkImage deinterleavedDepthImage = VK_NULL_HANDLE;
+  VkImageView deinterleavedDepthImageView = VK_NULL_HANDLE;
+  VkImage deinterleavedAOImage = VK_NULL_HANDLE;
+  VkImageView deinterleavedAOImageView = VK_NULL_HANDLE;
+
+  // Memory of the aliased transients: depth atlas + blur temp, and AO atlas
+  // + low-res blur
+  std::array<VkDeviceMemory, 2> transientMemories{};
+
+  // Adaptive sampling importance map (sample count per tile, r32f)
+  VkImage importanceImage = VK_NULL_HANDLE;
+  VkDeviceMemory importanceMemory = VK_NULL_HANDLE;
+  VkImageView importanceImageView = VK_NULL_HANDLE;
+
+  // Low-res blur output before upsampling (reduced resolution only)
+  VkImage blurLowImage = VK_NULL_HANDLE;
+  VkImageView blurLowImageView = VK_NULL_HANDLE;
+
   // SSAO output texture
   VkImage ssaoImage = VK_NULL_HANDLE;
   VkDeviceMemory ssaoMemory = VK_NULL_HANDLE;
   VkImageView ssaoImageView = VK_NULL_HANDLE;
 
+  // Intermediate of the separable blur (AO resolution)
+  VkImage blurTempImage = VK_NULL_HANDLE;
+  VkImageView blurTempImageView = VK_NULL_HANDLE;
+
   // Blurred SSAO texture
   VkImage blurredImage = VK_NULL_HANDLE;
   VkDeviceMemory blurredMemory = VK_NULL_HANDLE;
   VkImageView blurredImageView = VK_NULL_HANDLE;
 
   VkSampler sampler = VK_NULL_HANDLE;
+  // Depth and packed normals must not be filtered (see createSamplers)
+  VkSampler pointSampler = VK_NULL_HANDLE;
+  // VK_NULL_HANDLE with dynamic rendering
   VkRenderPass ssaoRenderPass = VK_NULL_HANDLE;
   VkRenderPass blurRenderPass = VK_NULL_HANDLE;
-  VkFramebuffer ssaoFramebuffer = VK_NULL_HANDLE;
-  VkFramebuffer blurFramebuffer = VK_NULL_HANDLE;
+  VkRenderPass downsampleRenderPass = VK_NULL_HANDLE;
+  VkRenderPass temporalRenderPass = VK_NULL_HANDLE;
+  VkRenderPass deinterleaveRenderPass = VK_NULL_HANDLE;
+  FrgRenderTarget ssaoTarget;
+  FrgRenderTarget blurTarget;
+  FrgRenderTarget blurTempTarget;
+  FrgRenderTarget downsampleTarget;
+  FrgRenderTarget upsampleTarget;
+  FrgRenderTarget deinterleaveTarget;
+  FrgRenderTarget deinterleavedSSAOTarget;
 
   // Format for SSAO textures (single channel, 8-bit is enough for AO)
   static constexpr VkFormat SSAO_FORMAT = VK_FORMAT_R8_UNORM;
+  // Format for the downsampled depth (hardware depth copied as a color);
+  // the downsampled normal uses FrgGBuffer::NORMAL_FORMAT
+  static constexpr VkFormat LOW_DEPTH_FORMAT = VK_FORMAT_R32_SFLOAT;
+  // Importance map: r32f is a core storage format (no extended formats)
+  static constexpr VkFormat IMPORTANCE_FORMAT = VK_FORMAT_R32_SFLOAT;
+  // Temporal history: 16-bit AO so small per-frame blends do not quantize
+  static constexpr VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16_SFLOAT;
 };
 
 } // namespace frg
@@ -1,6 +1,7 @@
 #include "frg_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -8,15 +9,19 @@
 #include <limits>
 #include <set>
 #include <stdexcept>
+#include <utility>
 
 namespace frg {
 
-FrgSwapChain::FrgSwapChain(FrgDevice &deviceRef, VkExtent2D extent) : device{deviceRef}, windowExtent{extent} {
+FrgSwapChain::FrgSwapChain(FrgDevice &deviceRef, VkExtent2D extent, const PresentConfig &config)
+    : device{deviceRef}, windowExtent{extent}, config{config} {
     init();
 }
 
-FrgSwapChain::FrgSwapChain(FrgDevice &deviceRef, VkExtent2D extent, std::shared_ptr<FrgSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+FrgSwapChain::FrgSwapChain(
+    FrgDevice &deviceRef, VkExtent2D extent, std::shared_ptr<FrgSwapChain> previous, const PresentConfig &config
+)
+    : device{deviceRef}, windowExtent{extent}, config{config}, oldSwapChain{previous} {
     init();
 
     // set old swap chain to null pointer since it is not needed
@@ -24,19 +29,24 @@ FrgSwapChain::FrgSwapChain(FrgDevice &deviceRef, VkExtent2D extent, std::shared_
 }
 
 void FrgSwapChain::updateUniformBuffer(std::vector<void *> &ubos, const UniformBufferObject &obj) {
-    memcpy(ubos[currentFrame], &obj, sizeof(obj));
+    memcpy(ubos[computeSlot], &obj, sizeof(obj));
 }
 
 void FrgSwapChain::bindAndDrawCompute(VkCommandBuffer comm_buff, std::vector<VkBuffer> &ssbos, uint32_t point_count) {
+    // The particles of the previous compute submit, the current one is still simulating (see
+    // submitComputeCommandBuffer)
+    drawnSlot = (computeSlot + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
     VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(comm_buff, 0, 1, &ssbos[currentFrame], offsets);
+    vkCmdBindVertexBuffers(comm_buff, 0, 1, &ssbos[drawnSlot], offsets);
     vkCmdDraw(comm_buff, point_count, 1, 0, 0);
 }
 
 void FrgSwapChain::init() {
+    config.framesInFlight = std::clamp<uint32_t>(config.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
     createSwapChain();
     createImageViews();
     createRenderPass();
+    createDepthLoadRenderPass();
     createDepthResources();
     createFramebuffers();
     createSyncObjects();
@@ -63,15 +73,17 @@ FrgSwapChain::~FrgSwapChain() {
         vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
     }
 
+    destroySharedDepthFramebuffers();
+
     vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    vkDestroyRenderPass(device.device(), depthLoadRenderPass, nullptr);
 
     // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(device.device(), computeFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.device(), inFlightFences[i], nullptr);
-        vkDestroyFence(device.device(), inComputeFlightFences[i], nullptr);
+    for (auto semaphore : imageAvailableSemaphores) {
+        vkDestroySemaphore(device.device(), semaphore, nullptr);
     }
+    vkDestroySemaphore(device.device(), graphicsTimeline, nullptr);
+    vkDestroySemaphore(device.device(), computeTimeline, nullptr);
 
     for (size_t i = 0; i < swapChainImages.size(); ++i) {
         vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
@@ -79,65 +91,91 @@ FrgSwapChain::~FrgSwapChain() {
 }
 
 VkResult FrgSwapChain::acquireNextImage(uint32_t *imageIndex) {
-    vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-
-    VkResult result = vkAcquireNextImageKHR(
-        device.device(),
-        swapChain,
-        std::numeric_limits<uint64_t>::max(),
-        imageAvailableSemaphores[currentFrame], // must be a not signaled
-                                                // semaphore
-        VK_NULL_HANDLE,
-        imageIndex
-    );
+    // Retires everything the frame slot was last used for, so the slot's command buffers, uniform buffers and
+    // imageAvailable semaphore are free again
+    VkSemaphore timelines[] = {graphicsTimeline, computeTimeline};
+    uint64_t values[] = {frameGraphicsValues[currentFrame], frameComputeValues[currentFrame]};
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 2;
+    waitInfo.pSemaphores = timelines;
+    waitInfo.pValues = values;
+    if (vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait for frame in flight!");
+    }
+
+    VkResult result;
+    pendingFrameCalls++;
+    {
+        std::lock_guard<std::mutex> lock{swapChainMutex};
+        result = vkAcquireNextImageKHR(
+            device.device(),
+            swapChain,
+            std::numeric_limits<uint64_t>::max(),
+            imageAvailableSemaphores[currentFrame], // must be a not signaled
+                                                    // semaphore
+            VK_NULL_HANDLE,
+            imageIndex
+        );
+        pendingFrameCalls--;
+    }
+    frameCallsDone.notify_all();
 
     return result;
 }
 
-VkResult FrgSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex, bool has_compute) {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
-
+VkResult FrgSwapChain::submitCommandBuffers(
+    const VkCommandBuffer *buffers, uint32_t *imageIndex, bool has_compute, uint64_t presentId
+) {
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    std::vector<VkSemaphore> waitSemaphores;
-    std::vector<VkPipelineStageFlags> waitStages;
+    // Values are ignored for the binary semaphores
+    std::vector<VkSemaphore> waitSemaphores{imageAvailableSemaphores[currentFrame]};
+    std::vector<uint64_t> waitValues{0};
+    std::vector<VkPipelineStageFlags> waitStages{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
     if (has_compute) {
-        waitSemaphores.push_back(computeFinishedSemaphores[currentFrame]);
-        waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+        // The particles drawn this frame, written by the previous compute submit
+        waitSemaphores.push_back(computeTimeline);
+        waitValues.push_back(drawnComputeValue);
         waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
-        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-        submitInfo.waitSemaphoreCount = waitSemaphores.size();
-    } else {
-        waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
-
-        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-        submitInfo.waitSemaphoreCount = waitSemaphores.size();
     }
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
     submitInfo.pWaitSemaphores = waitSemaphores.data();
     submitInfo.pWaitDstStageMask = waitStages.data();
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = buffers;
 
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[*imageIndex]};
-    submitInfo.signalSemaphoreCount = 1;
+    uint64_t signalValues[] = {0, graphicsValue + 1};
+    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[*imageIndex], graphicsTimeline};
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    graphicsValue++;
+    frameGraphicsValues[currentFrame] = graphicsValue;
+    if (has_compute) {
+        // computeSlot has moved on since the frame was recorded, the compute submit comes first
+        slotGraphicsValues[drawnSlot] = graphicsValue;
+    }
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[*imageIndex];
 
     VkSwapchainKHR swapChains[] = {swapChain};
     presentInfo.swapchainCount = 1;
@@ -145,12 +183,34 @@ VkResult FrgSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint
 
     presentInfo.pImageIndices = imageIndex;
 
-    auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    VkPresentIdKHR presentIdInfo{};
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &presentId;
+    if (presentId != 0) {
+        presentInfo.pNext = &presentIdInfo;
+    }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    VkResult result;
+    pendingFrameCalls++;
+    {
+        std::lock_guard<std::mutex> lock{swapChainMutex};
+        result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+        pendingFrameCalls--;
+    }
+    frameCallsDone.notify_all();
+
+    currentFrame = (currentFrame + 1) % config.framesInFlight;
 
     return result;
 }
+
+VkResult FrgSwapChain::waitForPresent(uint64_t presentId, uint64_t timeout) {
+    // Decremented under the lock, so the predicate cannot miss the notify
+    std::unique_lock<std::mutex> lock{swapChainMutex};
+    frameCallsDone.wait(lock, [this] { return pendingFrameCalls == 0; });
+    return device.waitForPresent(swapChain, presentId, timeout);
+}
 // This function is a blashphemy - Aron
 void FrgSwapChain::submitComputeCommandBuffer(
     std::vector<VkCommandBuffer> &buffers, std::vector<void *> &ubos_mapped,
@@ -160,21 +220,46 @@ void FrgSwapChain::submitComputeCommandBuffer(
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    vkWaitForFences(device.device(), 1, &inComputeFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    // No host wait: the ring slot was last used MAX_FRAMES_IN_FLIGHT compute submits ago, at least as long ago as
+    // the frame acquireNextImage retired
     updateUniformBuffer(ubos_mapped, ubo);
-    vkResetFences(device.device(), 1, &inComputeFlightFences[currentFrame]);
-
-    vkResetCommandBuffer(buffers[currentFrame], 0);
-    renderFnc(buffers[currentFrame], layout, pipeline, particle_count, currentFrame);
 
+    vkResetCommandBuffer(buffers[computeSlot], 0);
+    renderFnc(buffers[computeSlot], layout, pipeline, particle_count, computeSlot);
+
+    // This submit reads the previous submit's output and overwrites computeSlot. The frame being recorded has
+    // already drawn the previous slot, so the last frame that drew computeSlot is MAX_FRAMES_IN_FLIGHT - 1 frames
+    // old; only that frame is waited on, the ones after it keep running on the graphics queue.
+    VkSemaphore wait_semaphores[] = {computeTimeline, graphicsTimeline};
+    uint64_t wait_values[] = {computeValue, slotGraphicsValues[computeSlot]};
+    VkPipelineStageFlags wait_stages[] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+    };
+    uint64_t signal_value = computeValue + 1;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.waitSemaphoreValueCount = 2;
+    timeline_info.pWaitSemaphoreValues = wait_values;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues = &signal_value;
+
+    submit_info.pNext = &timeline_info;
+    submit_info.waitSemaphoreCount = 2;
+    submit_info.pWaitSemaphores = wait_semaphores;
+    submit_info.pWaitDstStageMask = wait_stages;
     submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &buffers[currentFrame];
+    submit_info.pCommandBuffers = &buffers[computeSlot];
     submit_info.signalSemaphoreCount = 1;
-    submit_info.pSignalSemaphores = &computeFinishedSemaphores[currentFrame];
+    submit_info.pSignalSemaphores = &computeTimeline;
 
-    if (vkQueueSubmit(device.computeQueue(), 1, &submit_info, inComputeFlightFences[currentFrame]) != VK_SUCCESS) {
+    if (vkQueueSubmit(device.computeQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit compute command buffer!");
     }
+    drawnComputeValue = computeValue;
+    computeValue = signal_value;
+    frameComputeValues[currentFrame] = computeValue;
+    computeSlot = (computeSlot + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
 void FrgSwapChain::createSwapChain() {
@@ -184,10 +269,7 @@ void FrgSwapChain::createSwapChain() {
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    uint32_t imageCount = chooseImageCount(swapChainSupport.capabilities);
 
     VkSwapchainCreateInfoKHR createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -318,6 +400,113 @@ void FrgSwapChain::createRenderPass() {
     }
 }
 
+void FrgSwapChain::createDepthLoadRenderPass() {
+    // Must stay compatible with renderPass (same formats and sample counts) so the same pipelines work in both
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = findDepthFormat();
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // The G-buffer pass leaves its depth in read-only layout for sampling; hand it back the same way
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    // Test-only (no pipeline in this pass writes depth), so the deferred
+    // lighting pass can sample the same depth to reconstruct positions
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    VkAttachmentDescription colorAttachment = {};
+    colorAttachment.format = getSwapChainImageFormat();
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkAttachmentReference colorAttachmentRef = {};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // Wait for the G-buffer depth writes before testing against them
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstSubpass = 0;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                              VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+
+    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &depthLoadRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth load render pass!");
+    }
+}
+
+void FrgSwapChain::setSharedDepthView(VkImageView depthView, VkExtent2D depthExtent) {
+    // Frames in flight may still render into the old ones
+    for (auto &framebuffer : sharedDepthFramebuffers) {
+        device.deletionQueue().retireFramebuffer(framebuffer);
+    }
+    sharedDepthFramebuffers.clear();
+
+    if (depthView == VK_NULL_HANDLE || depthExtent.width != swapChainExtent.width ||
+        depthExtent.height != swapChainExtent.height)
+    {
+        return;
+    }
+
+    sharedDepthFramebuffers.resize(imageCount());
+    for (size_t i = 0; i < imageCount(); i++) {
+        std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthView};
+
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = depthLoadRenderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = swapChainExtent.width;
+        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &sharedDepthFramebuffers[i]) !=
+            VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shared depth framebuffer!");
+        }
+    }
+}
+
+void FrgSwapChain::destroySharedDepthFramebuffers() {
+    for (auto framebuffer : sharedDepthFramebuffers) {
+        vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+    }
+    sharedDepthFramebuffers.clear();
+}
+
 void FrgSwapChain::createFramebuffers() {
     swapChainFramebuffers.resize(imageCount());
     for (size_t i = 0; i < imageCount(); i++) {
@@ -386,36 +575,82 @@ void FrgSwapChain::createDepthResources() {
 }
 
 void FrgSwapChain::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(config.framesInFlight);
     renderFinishedSemaphores.resize(swapChainImages.size());
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
-    computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inComputeFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    if (oldSwapChain != nullptr) {
+        adoptTimelines(*oldSwapChain);
+    } else {
+        createTimelines();
+    }
 
     for (size_t i = 0; i < swapChainImages.size(); ++i) {
         if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &computeFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS ||
-            vkCreateFence(device.device(), &fenceInfo, nullptr, &inComputeFlightFences[i]) != VK_SUCCESS)
-        {
+    for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
+        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
 }
 
+void FrgSwapChain::createTimelines() {
+    // Value 0 is signaled from the start, so the first frames do not wait
+    frameGraphicsValues.assign(config.framesInFlight, 0);
+    frameComputeValues.assign(config.framesInFlight, 0);
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkSemaphoreTypeCreateInfo timelineTypeInfo = {};
+    timelineTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineTypeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo timelineInfo = semaphoreInfo;
+    timelineInfo.pNext = &timelineTypeInfo;
+
+    if (vkCreateSemaphore(device.device(), &timelineInfo, nullptr, &graphicsTimeline) != VK_SUCCESS ||
+        vkCreateSemaphore(device.device(), &timelineInfo, nullptr, &computeTimeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timeline semaphores!");
+    }
+}
+
+void FrgSwapChain::adoptTimelines(FrgSwapChain &previous) {
+    graphicsTimeline = std::exchange(previous.graphicsTimeline, VK_NULL_HANDLE);
+    computeTimeline = std::exchange(previous.computeTimeline, VK_NULL_HANDLE);
+    graphicsValue = previous.graphicsValue;
+    computeValue = previous.computeValue;
+    drawnComputeValue = previous.drawnComputeValue;
+    slotGraphicsValues = previous.slotGraphicsValues;
+    computeSlot = previous.computeSlot;
+
+    if (previous.frameGraphicsValues.size() == config.framesInFlight) {
+        frameGraphicsValues = previous.frameGraphicsValues;
+        frameComputeValues = previous.frameComputeValues;
+        currentFrame = previous.currentFrame;
+    } else {
+        // Slots are renumbered, so every slot waits for the last frame once
+        frameGraphicsValues.assign(config.framesInFlight, graphicsValue);
+        frameComputeValues.assign(config.framesInFlight, computeValue);
+        currentFrame = 0;
+    }
+}
+
+uint64_t FrgSwapChain::completedGraphicsValue() const {
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(device.device(), graphicsTimeline, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to read graphics timeline!");
+    }
+    return value;
+}
+
 VkSurfaceFormatKHR FrgSwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats) {
     for (const auto &availableFormat : availableFormats) {
         if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB &&
@@ -429,22 +664,38 @@ VkSurfaceFormatKHR FrgSwapChain::chooseSwapSurfaceFormat(const std::vector<VkSur
 }
 
 VkPresentModeKHR FrgSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
+    activePresentMode = VK_PRESENT_MODE_FIFO_KHR;
     for (const auto &availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            std::cout << "Present mode: Mailbox" << std::endl;
-            return availablePresentMode;
+        if (availablePresentMode == config.presentMode) {
+            activePresentMode = availablePresentMode;
         }
     }
 
-    // for (const auto &availablePresentMode : availablePresentModes) {
-    //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" << std::endl;
-    //     return availablePresentMode;
-    //   }
-    // }
+    switch (activePresentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        std::cout << "Present mode: Immediate";
+        break;
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        std::cout << "Present mode: Mailbox";
+        break;
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        std::cout << "Present mode: V-Sync (relaxed)";
+        break;
+    default:
+        std::cout << "Present mode: V-Sync";
+        break;
+    }
+    std::cout << ", " << config.framesInFlight << " frames in flight" << std::endl;
+    return activePresentMode;
+}
 
-    std::cout << "Present mode: V-Sync" << std::endl;
-    return VK_PRESENT_MODE_FIFO_KHR;
+uint32_t FrgSwapChain::chooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities) {
+    uint32_t imageCount = config.imageCount > 0 ? config.imageCount : capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+    return imageCount;
 }
 
 VkExtent2D FrgSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
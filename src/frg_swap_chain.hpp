@@ -7,19 +7,37 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace frg {
 
+// Latency versus throughput trade-offs, chosen per deployment (see FrgRenderer::setPresentConfig)
+struct PresentConfig {
+    // Frames the CPU may record ahead of the GPU, 1 to FrgSwapChain::MAX_FRAMES_IN_FLIGHT
+    uint32_t framesInFlight = 2;
+    // Falls back to FIFO if the surface does not support it
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    // Swap chain images to ask for, clamped to the surface limits; 0 = one more than the minimum
+    uint32_t imageCount = 0;
+};
+
 class FrgSwapChain {
   public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // Upper bound for PresentConfig::framesInFlight; per-frame resources are allocated for this many frames
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
 
-    FrgSwapChain(FrgDevice &deviceRef, VkExtent2D windowExtent);
-    FrgSwapChain(FrgDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<FrgSwapChain> previous);
+    FrgSwapChain(FrgDevice &deviceRef, VkExtent2D windowExtent, const PresentConfig &config = {});
+    FrgSwapChain(
+        FrgDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<FrgSwapChain> previous,
+        const PresentConfig &config = {}
+    );
     ~FrgSwapChain();
 
     FrgSwapChain(const FrgSwapChain &) = delete;
@@ -27,20 +45,47 @@ class FrgSwapChain {
 
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
     VkRenderPass getRenderPass() { return renderPass; }
+    VkFramebuffer getSharedDepthFrameBuffer(int index) { return sharedDepthFramebuffers[index]; }
+    VkRenderPass getDepthLoadRenderPass() { return depthLoadRenderPass; }
+    bool hasSharedDepth() const { return !sharedDepthFramebuffers.empty(); }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
+    uint32_t framesInFlight() const { return config.framesInFlight; }
+    // Frame slot the next acquireNextImage waits for and submitCommandBuffers uses
+    size_t currentFrameSlot() const { return currentFrame; }
+    VkPresentModeKHR presentMode() const { return activePresentMode; }
 
     float extentAspectRatio() {
         return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
     }
     VkFormat findDepthFormat();
 
+    // Frame pacing runs on one timeline semaphore per queue. Every graphics submit signals the next value of
+    // graphicsTimeline and every compute submit the next value of computeTimeline; the queues wait for each
+    // other's values on the GPU. The host only waits in acquireNextImage, for the values of the frame that last
+    // used the current frame slot, i.e. when it is framesInFlight frames ahead.
+    //
+    // Particles are drawn one compute submit behind: a frame draws what the previous frame's compute submit
+    // wrote, so on an async compute queue the simulation runs alongside the next frame's graphics work. The
+    // particle buffers form a ring of MAX_FRAMES_IN_FLIGHT, independent of framesInFlight.
+    //
+    // A swap chain created from a previous one takes over its timelines and values, so frames still in flight
+    // on the old one are waited on as usual and recreation does not have to idle the device.
     VkResult acquireNextImage(uint32_t *imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex, bool has_compute = false);
+    // presentId: VK_KHR_present_id value for the present, 0 for none
+    VkResult submitCommandBuffers(
+        const VkCommandBuffer *buffers, uint32_t *imageIndex, bool has_compute = false, uint64_t presentId = 0
+    );
+    // Graphics timeline value of the last submitted frame, and the value the GPU has reached
+    uint64_t submittedGraphicsValue() const { return graphicsValue; }
+    uint64_t completedGraphicsValue() const;
+    // vkWaitForPresentKHR from another thread; needs FrgDevice::supportsPresentWait. Holds the swap chain for up
+    // to timeout, and only starts waiting while no acquire or present is pending.
+    VkResult waitForPresent(uint64_t presentId, uint64_t timeout);
     void submitComputeCommandBuffer(
         std::vector<VkCommandBuffer> &buffers, std::vector<void *> &ubos_mapped,
         std::function<void(VkCommandBuffer, VkPipelineLayout, VkPipeline, size_t, size_t)> renderFnc,
@@ -51,6 +96,10 @@ class FrgSwapChain {
                otherSwapChain.swapChainImageFormat == swapChainImageFormat;
     }
 
+    // Pairs every swap chain image with an externally owned depth view (the G-buffer depth) so the final pass
+    // can load it instead of clearing its own. Ignored if the extents do not match.
+    void setSharedDepthView(VkImageView depthView, VkExtent2D depthExtent);
+
     void updateUniformBuffer(std::vector<void *> &ubos, const UniformBufferObject &obj);
     void bindAndDrawCompute(VkCommandBuffer comm_buff, std::vector<VkBuffer> &ssbos, uint32_t point_count);
 
@@ -60,12 +109,17 @@ class FrgSwapChain {
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
+    void createDepthLoadRenderPass();
     void createFramebuffers();
+    void destroySharedDepthFramebuffers();
     void createSyncObjects();
+    void createTimelines();
+    void adoptTimelines(FrgSwapChain &previous);
 
     // Helper functions
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes);
+    uint32_t chooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
     VkFormat swapChainImageFormat;
@@ -75,6 +129,10 @@ class FrgSwapChain {
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
 
+    // Same attachments as renderPass, but depth is loaded from a previous pass and never cleared
+    VkRenderPass depthLoadRenderPass = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> sharedDepthFramebuffers;
+
     std::vector<VkImage> depthImages;
     std::vector<VkDeviceMemory> depthImageMemorys;
     std::vector<VkImageView> depthImageViews;
@@ -83,17 +141,38 @@ class FrgSwapChain {
 
     FrgDevice &device;
     VkExtent2D windowExtent;
+    PresentConfig config;
+    VkPresentModeKHR activePresentMode = VK_PRESENT_MODE_FIFO_KHR;
 
     VkSwapchainKHR swapChain;
     std::shared_ptr<FrgSwapChain> oldSwapChain;
+    // The swap chain is externally synchronized between the frame loop and present waits. Acquire and present
+    // announce themselves in pendingFrameCalls first, and a present wait does not start until they are done.
+    std::mutex swapChainMutex;
+    std::condition_variable frameCallsDone;
+    std::atomic<uint32_t> pendingFrameCalls{0};
 
+    // Binary, the presentation engine does not take timeline semaphores
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkSemaphore> computeFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> inComputeFlightFences;
-    std::vector<VkFence> imagesInFlight;
+
+    VkSemaphore graphicsTimeline = VK_NULL_HANDLE;
+    VkSemaphore computeTimeline = VK_NULL_HANDLE;
+    // Last value signaled on each timeline
+    uint64_t graphicsValue = 0;
+    uint64_t computeValue = 0;
+    // Compute value whose particles the next graphics submit draws
+    uint64_t drawnComputeValue = 0;
+    // Values that retire each frame slot
+    std::vector<uint64_t> frameGraphicsValues;
+    std::vector<uint64_t> frameComputeValues;
     size_t currentFrame = 0;
+    // Particle buffer, uniform buffer and command buffer the next compute submit uses
+    size_t computeSlot = 0;
+    // Particle buffer the frame being recorded draws (see bindAndDrawCompute)
+    size_t drawnSlot = 0;
+    // Graphics value of the last frame that drew each particle buffer, 0 if none did
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> slotGraphicsValues{};
 };
 
 } // namespace frg
@@ -0,0 +1,105 @@
+#include "frg_thread_pool.hpp"
+
+// std
+#include <algorithm>
+
+namespace frg {
+
+FrgThreadPool::FrgThreadPool(uint32_t workerCount) {
+  if (workerCount == 0) {
+    uint32_t hardware = std::thread::hardware_concurrency();
+    workerCount = hardware > 1 ? hardware - 1 : 1;
+  }
+
+  workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; i++) {
+    workers.emplace_back(&FrgThreadPool::workerLoop, this, i);
+  }
+}
+
+FrgThreadPool::~FrgThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  workReady.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+uint32_t FrgThreadPool::chunkCount(size_t count, size_t minPerWorker) const {
+  size_t chunks = count / std::max<size_t>(minPerWorker, 1);
+  return static_cast<uint32_t>(
+      std::clamp<size_t>(chunks, 1, workers.size()));
+}
+
+void FrgThreadPool::parallelFor(size_t count, size_t minPerWorker,
+                                const RangeFn &fn) {
+  if (count == 0) {
+    return;
+  }
+
+  uint32_t chunks = chunkCount(count, minPerWorker);
+  if (chunks == 1) {
+    // Not worth a hand-off; worker 0 is idle while the caller waits anyway
+    fn(0, 0, count);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock{mutex};
+  job = &fn;
+  jobCount = count;
+  jobChunks = chunks;
+  remaining = chunks;
+  firstError = nullptr;
+  generation++;
+  workReady.notify_all();
+  workDone.wait(lock, [this] { return remaining == 0; });
+  job = nullptr;
+
+  if (firstError) {
+    std::rethrow_exception(firstError);
+  }
+}
+
+void FrgThreadPool::workerLoop(uint32_t worker) {
+  uint64_t seen = 0;
+  while (true) {
+    const RangeFn *fn;
+    size_t begin;
+    size_t end;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      workReady.wait(lock,
+                     [&] { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+      if (worker >= jobChunks) {
+        continue;
+      }
+      fn = job;
+      begin = jobCount * worker / jobChunks;
+      end = jobCount * (worker + 1) / jobChunks;
+    }
+
+    std::exception_ptr error;
+    try {
+      (*fn)(worker, begin, end);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (error && !firstError) {
+      firstError = error;
+    }
+    if (--remaining == 0) {
+      workDone.notify_one();
+    }
+  }
+}
+
+} // namespace frg
@@ -0,0 +1,66 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace frg {
+
+/**
+ * Thread Pool
+ *
+ * A fixed set of worker threads that run one parallel-for at a time. The
+ * range is split into contiguous chunks, one per worker, and the calling
+ * thread blocks until every chunk is done. Each chunk is handed the index of
+ * the worker running it, so callers can keep per-worker state (e.g. command
+ * pools) without locking.
+ */
+class FrgThreadPool {
+public:
+  // Runs items [begin, end) on the given worker
+  using RangeFn =
+      std::function<void(uint32_t worker, size_t begin, size_t end)>;
+
+  // workerCount 0 picks one worker per hardware thread, minus the caller
+  explicit FrgThreadPool(uint32_t workerCount = 0);
+  ~FrgThreadPool();
+
+  FrgThreadPool(const FrgThreadPool &) = delete;
+  FrgThreadPool &operator=(const FrgThreadPool &) = delete;
+
+  uint32_t getWorkerCount() const {
+    return static_cast<uint32_t>(workers.size());
+  }
+
+  // Number of chunks parallelFor splits count items into, never handing a
+  // worker fewer than minPerWorker items
+  uint32_t chunkCount(size_t count, size_t minPerWorker) const;
+
+  // Splits [0, count) across the workers and waits for all of them. Not
+  // reentrant: call from one thread at a time.
+  void parallelFor(size_t count, size_t minPerWorker, const RangeFn &fn);
+
+private:
+  void workerLoop(uint32_t worker);
+
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable workReady;
+  std::condition_variable workDone;
+  const RangeFn *job = nullptr;
+  size_t jobCount = 0;
+  uint32_t jobChunks = 0;
+  uint64_t generation = 0;
+  uint32_t remaining = 0;
+  std::exception_ptr firstError; // rethrown on the calling thread
+  bool stopping = false;
+};
+
+} // namespace frg
@@ -0,0 +1,347 @@
+#include "frg_uploader.hpp"
+
+#include "frg_device.hpp"
+
+// std
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace frg {
+
+FrgUploader::FrgUploader(FrgDevice &device, uint32_t transferFamily,
+                         uint32_t graphicsFamily, VkQueue transferQueue,
+                         VkQueue graphicsQueue)
+    : device{device}, transferFamily{transferFamily},
+      graphicsFamily{graphicsFamily}, transferQueue{transferQueue},
+      graphicsQueue{graphicsQueue} {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = transferFamily;
+  if (vkCreateCommandPool(device.device(), &poolInfo, nullptr,
+                          &transferPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload command pool!");
+  }
+  if (hasDedicatedQueue()) {
+    poolInfo.queueFamilyIndex = graphicsFamily;
+    if (vkCreateCommandPool(device.device(), &poolInfo, nullptr,
+                            &acquirePool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload command pool!");
+    }
+  }
+
+  VkSemaphoreTypeCreateInfo typeInfo{};
+  typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeInfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+  if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
+                        &timeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload semaphore!");
+  }
+}
+
+FrgUploader::~FrgUploader() {
+  waitIdle();
+  collect();
+  // Its destination may already be gone, so it is not submitted
+  release(open);
+
+  vkDestroySemaphore(device.device(), timeline, nullptr);
+  vkDestroyCommandPool(device.device(), transferPool, nullptr);
+  if (acquirePool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(device.device(), acquirePool, nullptr);
+  }
+}
+
+void FrgUploader::uploadBuffer(VkBuffer buffer, const void *data,
+                               VkDeviceSize size,
+                               VkPipelineStageFlags dstStage,
+                               VkAccessFlags dstAccess) {
+  std::lock_guard<std::mutex> lock{mutex};
+  beginBatch();
+
+  VkBufferCopy region{};
+  region.size = size;
+  vkCmdCopyBuffer(open.transferCommands, stage(data, size), buffer, 1,
+                  &region);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+
+  if (!hasDedicatedQueue()) {
+    vkCmdPipelineBarrier(open.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    return;
+  }
+
+  // Release and acquire must name the same families
+  barrier.srcQueueFamilyIndex = transferFamily;
+  barrier.dstQueueFamilyIndex = graphicsFamily;
+
+  VkBufferMemoryBarrier releaseBarrier = barrier;
+  releaseBarrier.dstAccessMask = 0;
+  vkCmdPipelineBarrier(open.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1,
+                       &releaseBarrier, 0, nullptr);
+
+  VkBufferMemoryBarrier acquireBarrier = barrier;
+  acquireBarrier.srcAccessMask = 0;
+  vkCmdPipelineBarrier(open.acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       dstStage, 0, 0, nullptr, 1, &acquireBarrier, 0,
+                       nullptr);
+}
+
+void FrgUploader::uploadImage(VkImage image, const void *pixels,
+                              VkDeviceSize size, uint32_t width,
+                              uint32_t height, VkPipelineStageFlags dstStage) {
+  std::lock_guard<std::mutex> lock{mutex};
+  beginBatch();
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+
+  // Nothing to preserve, so no ownership to take over either
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(open.transferCommands,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(open.transferCommands, stage(pixels, size), image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  if (!hasDedicatedQueue()) {
+    vkCmdPipelineBarrier(open.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    return;
+  }
+
+  // The layout transition happens once, between release and acquire
+  barrier.srcQueueFamilyIndex = transferFamily;
+  barrier.dstQueueFamilyIndex = graphicsFamily;
+
+  VkImageMemoryBarrier releaseBarrier = barrier;
+  releaseBarrier.dstAccessMask = 0;
+  vkCmdPipelineBarrier(open.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &releaseBarrier);
+
+  VkImageMemoryBarrier acquireBarrier = barrier;
+  acquireBarrier.srcAccessMask = 0;
+  vkCmdPipelineBarrier(open.acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       dstStage, 0, 0, nullptr, 0, nullptr, 1,
+                       &acquireBarrier);
+}
+
+void FrgUploader::initializeImage(VkImage image, VkImageLayout layout,
+                                  VkPipelineStageFlags dstStage,
+                                  VkAccessFlags dstAccess) {
+  std::lock_guard<std::mutex> lock{mutex};
+  beginBatch();
+
+  // Nothing to preserve, so the graphics queue takes the image as it is
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = dstAccess;
+
+  VkCommandBuffer commands = hasDedicatedQueue() ? open.acquireCommands
+                                                 : open.transferCommands;
+  vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage,
+                       0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void FrgUploader::flush() {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (open.transferCommands == VK_NULL_HANDLE) {
+    return;
+  }
+
+  if (vkEndCommandBuffer(open.transferCommands) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  uint64_t transferValue = timelineValue + 1;
+  VkTimelineSemaphoreSubmitInfo transferTimeline{};
+  transferTimeline.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  transferTimeline.signalSemaphoreValueCount = 1;
+  transferTimeline.pSignalSemaphoreValues = &transferValue;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &transferTimeline;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &open.transferCommands;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &timeline;
+  if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to submit uploads!");
+  }
+  timelineValue = transferValue;
+
+  if (open.acquireCommands != VK_NULL_HANDLE) {
+    if (vkEndCommandBuffer(open.acquireCommands) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    uint64_t acquireValue = timelineValue + 1;
+    VkTimelineSemaphoreSubmitInfo acquireTimeline{};
+    acquireTimeline.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    acquireTimeline.waitSemaphoreValueCount = 1;
+    acquireTimeline.pWaitSemaphoreValues = &transferValue;
+    acquireTimeline.signalSemaphoreValueCount = 1;
+    acquireTimeline.pSignalSemaphoreValues = &acquireValue;
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo acquireInfo{};
+    acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireInfo.pNext = &acquireTimeline;
+    acquireInfo.waitSemaphoreCount = 1;
+    acquireInfo.pWaitSemaphores = &timeline;
+    acquireInfo.pWaitDstStageMask = &waitStage;
+    acquireInfo.commandBufferCount = 1;
+    acquireInfo.pCommandBuffers = &open.acquireCommands;
+    acquireInfo.signalSemaphoreCount = 1;
+    acquireInfo.pSignalSemaphores = &timeline;
+    if (vkQueueSubmit(graphicsQueue, 1, &acquireInfo, VK_NULL_HANDLE) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit upload acquires!");
+    }
+    timelineValue = acquireValue;
+  }
+
+  open.value = timelineValue;
+  inFlight.push_back(std::move(open));
+  open = Batch{};
+}
+
+void FrgUploader::collect() {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint64_t finished = 0;
+  vkGetSemaphoreCounterValue(device.device(), timeline, &finished);
+  while (!inFlight.empty() && inFlight.front().value <= finished) {
+    release(inFlight.front());
+    inFlight.pop_front();
+  }
+}
+
+void FrgUploader::waitIdle() {
+  uint64_t value;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    value = timelineValue;
+  }
+
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &timeline;
+  waitInfo.pValues = &value;
+  vkWaitSemaphores(device.device(), &waitInfo,
+                   std::numeric_limits<uint64_t>::max());
+}
+
+VkBuffer FrgUploader::stage(const void *data, VkDeviceSize size) {
+  StagingBuffer staging;
+  device.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      staging.buffer, staging.memory);
+
+  void *mapped;
+  vkMapMemory(device.device(), staging.memory, 0, size, 0, &mapped);
+  std::memcpy(mapped, data, static_cast<size_t>(size));
+  vkUnmapMemory(device.device(), staging.memory);
+
+  open.staging.push_back(staging);
+  return staging.buffer;
+}
+
+void FrgUploader::beginBatch() {
+  if (open.transferCommands != VK_NULL_HANDLE) {
+    return;
+  }
+  open.transferCommands = allocateCommands(transferPool);
+  if (hasDedicatedQueue()) {
+    open.acquireCommands = allocateCommands(acquirePool);
+  }
+}
+
+VkCommandBuffer FrgUploader::allocateCommands(VkCommandPool pool) {
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = pool;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer commandBuffer;
+  if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate upload command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin upload command buffer!");
+  }
+  return commandBuffer;
+}
+
+void FrgUploader::release(Batch &batch) {
+  for (auto &staging : batch.staging) {
+    vkDestroyBuffer(device.device(), staging.buffer, nullptr);
+    vkFreeMemory(device.device(), staging.memory, nullptr);
+  }
+  batch.staging.clear();
+
+  if (batch.transferCommands != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(device.device(), transferPool, 1,
+                         &batch.transferCommands);
+  }
+  if (batch.acquireCommands != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(device.device(), acquirePool, 1,
+                         &batch.acquireCommands);
+  }
+  batch = Batch{};
+}
+
+} // namespace frg
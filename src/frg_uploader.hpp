@@ -0,0 +1,104 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace frg {
+
+class FrgDevice;
+
+/**
+ * Uploader
+ *
+ * Copies data into device-local buffers and images without blocking the
+ * caller or the graphics queue. Uploads are staged right away and recorded
+ * into a batch; flush() submits the batch to the transfer queue, which runs
+ * next to rendering on devices with a transfer-only queue family.
+ *
+ * With a dedicated family every resource is released by the transfer queue
+ * and acquired by the graphics queue in a small submit that waits for the
+ * batch on a timeline semaphore. Without one the batch runs on the graphics
+ * queue and a plain barrier makes the data visible. Either way the data is
+ * visible to everything submitted to the graphics queue after the flush, so
+ * a resource may be used by any frame submitted after its upload was
+ * flushed (FrgRenderer flushes before every frame).
+ *
+ * Staging buffers are freed by collect() once their batch has finished.
+ */
+class FrgUploader {
+public:
+  FrgUploader(FrgDevice &device, uint32_t transferFamily,
+              uint32_t graphicsFamily, VkQueue transferQueue,
+              VkQueue graphicsQueue);
+  // Waits for the submitted batches; a batch that was never flushed is
+  // dropped
+  ~FrgUploader();
+
+  FrgUploader(const FrgUploader &) = delete;
+  FrgUploader &operator=(const FrgUploader &) = delete;
+
+  // dstStage/dstAccess: how the graphics queue reads the buffer afterwards
+  void uploadBuffer(VkBuffer buffer, const void *data, VkDeviceSize size,
+                    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+  // Single mip and layer color image, UNDEFINED before the upload and
+  // SHADER_READ_ONLY_OPTIMAL for the shaders in dstStage after it
+  void uploadImage(
+      VkImage image, const void *pixels, VkDeviceSize size, uint32_t width,
+      uint32_t height,
+      VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  // Moves a new single mip and layer color image from UNDEFINED to layout on
+  // the graphics queue, without any data; dstStage/dstAccess as above
+  void initializeImage(VkImage image, VkImageLayout layout,
+                       VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+  // Submits the recorded uploads; cheap if there are none
+  void flush();
+  // Frees the staging buffers of finished batches without waiting
+  void collect();
+  void waitIdle();
+
+  bool hasDedicatedQueue() const { return transferFamily != graphicsFamily; }
+
+private:
+  struct StagingBuffer {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+  };
+
+  struct Batch {
+    VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+    // Ownership acquires on the graphics queue, dedicated family only
+    VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+    std::vector<StagingBuffer> staging;
+    // Timeline value signaled once the batch is visible to graphics
+    uint64_t value = 0;
+  };
+
+  VkBuffer stage(const void *data, VkDeviceSize size);
+  void beginBatch();
+  VkCommandBuffer allocateCommands(VkCommandPool pool);
+  void release(Batch &batch);
+
+  FrgDevice &device;
+  uint32_t transferFamily;
+  uint32_t graphicsFamily;
+  VkQueue transferQueue;
+  VkQueue graphicsQueue;
+
+  VkCommandPool transferPool = VK_NULL_HANDLE;
+  VkCommandPool acquirePool = VK_NULL_HANDLE;
+  VkSemaphore timeline = VK_NULL_HANDLE;
+  uint64_t timelineValue = 0;
+
+  std::mutex mutex;
+  Batch open;
+  std::deque<Batch> inFlight;
+};
+
+} // namespace frg
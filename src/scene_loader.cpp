@@ -1,4 +1,5 @@
 #include "scene_loader.hpp"
+#include "frg_ssao.hpp"
 #include <iostream>
 #include <tinyxml2.h>
 
@@ -33,6 +34,66 @@ void SceneLoader::load(FrgDevice &device, const std::string &filepath,
     tinyxml2::XMLElement *ssao = settings->FirstChildElement("SSAO");
     if (ssao) {
       sceneSettings.ssaoEnabled = ssao->BoolAttribute("enabled", true);
+      uint32_t divisor = ssao->UnsignedAttribute("divisor", 1);
+      if (FrgSSAO::isValidResolutionDivisor(divisor)) {
+        sceneSettings.ssaoResolutionDivisor = divisor;
+      } else {
+        std::cerr << "Ignoring SSAO divisor " << divisor
+                  << " (expected 1, 2 or 4) in scene file: " << filepath
+                  << std::endl;
+        sceneSettings.ssaoResolutionDivisor = 1;
+      }
+      sceneSettings.ssaoCompute = ssao->BoolAttribute("compute", false);
+      sceneSettings.ssaoBlurRadius = ssao->IntAttribute("blurRadius", 3);
+      sceneSettings.ssaoTemporal = ssao->BoolAttribute("temporal", false);
+      const char *method = ssao->Attribute("method");
+      sceneSettings.ssaoHorizon = method && std::string(method) == "horizon";
+      sceneSettings.ssaoDeinterleaved =
+          ssao->BoolAttribute("deinterleaved", false);
+      sceneSettings.ssaoAdaptive = ssao->BoolAttribute("adaptive", false);
+    }
+    tinyxml2::XMLElement *deferred = settings->FirstChildElement("Deferred");
+    if (deferred) {
+      sceneSettings.deferredShading = deferred->BoolAttribute("enabled", false);
+    }
+    tinyxml2::XMLElement *upscale = settings->FirstChildElement("Upscale");
+    if (upscale) {
+      sceneSettings.upscaleEnabled = upscale->BoolAttribute("enabled", false);
+      sceneSettings.upscaleScale = upscale->FloatAttribute("scale", 0.67f);
+    }
+    tinyxml2::XMLElement *governor = settings->FirstChildElement("Governor");
+    if (governor) {
+      sceneSettings.governorEnabled = governor->BoolAttribute("enabled", false);
+      sceneSettings.governorBudgetMs =
+          governor->FloatAttribute("budgetMs", 16.6f);
+    }
+    tinyxml2::XMLElement *recording = settings->FirstChildElement("Recording");
+    if (recording) {
+      sceneSettings.parallelRecording =
+          recording->BoolAttribute("parallel", false);
+      sceneSettings.recordingThreads = recording->IntAttribute("threads", 0);
+    }
+    tinyxml2::XMLElement *present = settings->FirstChildElement("Present");
+    if (present) {
+      const char *mode = present->Attribute("mode");
+      std::string modeName = mode ? mode : "mailbox";
+      if (modeName == "fifo") {
+        sceneSettings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+      } else if (modeName == "fifo_relaxed") {
+        sceneSettings.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+      } else if (modeName == "immediate") {
+        sceneSettings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+      } else {
+        sceneSettings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+      }
+      sceneSettings.framesInFlight =
+          present->UnsignedAttribute("framesInFlight", 2);
+      sceneSettings.swapChainImages = present->UnsignedAttribute("images", 0);
+    }
+    tinyxml2::XMLElement *rendering = settings->FirstChildElement("Rendering");
+    if (rendering) {
+      sceneSettings.dynamicRendering =
+          rendering->BoolAttribute("dynamic", false);
     }
     tinyxml2::XMLElement *debug = settings->FirstChildElement("DebugMode");
     if (debug) {
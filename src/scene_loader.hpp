@@ -12,6 +12,24 @@ namespace frg {
 struct SceneSettings {
   bool autoCamera{true};
   bool ssaoEnabled{true};
+  uint32_t ssaoResolutionDivisor{1}; // 1 = full, 2 = half, 4 = quarter
+  bool ssaoCompute{false};           // compute-shader SSAO + blur
+  int ssaoBlurRadius{3};             // bilateral blur taps per side
+  bool ssaoTemporal{false};          // accumulate kernel slices over frames
+  bool ssaoHorizon{false};           // horizon-based AO instead of hemisphere
+  bool ssaoDeinterleaved{false};     // cache-friendly layered SSAO
+  bool ssaoAdaptive{false};          // per-pixel sample count
+  bool deferredShading{false};
+  bool upscaleEnabled{false};        // render below output res, upscale
+  float upscaleScale{0.67f};         // internal / output resolution
+  bool governorEnabled{false};       // adapt quality to the frame budget
+  float governorBudgetMs{16.6f};     // target CPU/GPU frame time
+  bool parallelRecording{false};     // record draws on worker threads
+  int recordingThreads{0};           // worker count, 0 = hardware threads
+  uint32_t framesInFlight{2};        // 1 to MAX_FRAMES_IN_FLIGHT
+  VkPresentModeKHR presentMode{VK_PRESENT_MODE_MAILBOX_KHR};
+  uint32_t swapChainImages{0};       // 0 = minimum + 1
+  bool dynamicRendering{false};      // Vulkan 1.3 path, if supported
   int debugMode{0};
 };
 
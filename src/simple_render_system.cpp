@@ -9,6 +9,7 @@
 // std
 #include <array>
 #include <cassert>
+#include <cstddef>
 #include <stdexcept>
 
 namespace frg {
@@ -23,6 +24,8 @@ SimpleRenderSystem::SimpleRenderSystem(FrgDevice &device, VkRenderPass renderPas
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
+  // Background builds may still reference the layouts destroyed below
+  frgDevice.pipelineCompiler().waitIdle();
   vkDestroyPipelineLayout(frgDevice.device(), pipelineLayout, nullptr);
   if (computeGraphicsPipelineLayout != VK_NULL_HANDLE)
         vkDestroyPipelineLayout(frgDevice.device(), computeGraphicsPipelineLayout, nullptr);
@@ -59,8 +62,11 @@ void SimpleRenderSystem::createPipelineLayout() {
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = frgDescriptor.descriptorSetCount();
-  pipelineLayoutInfo.pSetLayouts = frgDescriptor.descriptorSetLayout();
+  // Set 1 holds the SSAO texture, which is replaced on resize
+  std::array<VkDescriptorSetLayout, 2> setLayouts = {
+      *frgDescriptor.descriptorSetLayout(), frgDescriptor.ssaoSetLayout()};
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
   pipelineLayoutInfo.pushConstantRangeCount = 1;
   pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
@@ -89,14 +95,65 @@ void SimpleRenderSystem::createComputeGraphicsPipelineLayout() {
   }
 }
 
+uint32_t SimpleRenderSystem::ShaderVariant::key() const {
+  return static_cast<uint32_t>(material) | (ssao ? 1u << 2 : 0u) |
+         (depthEqual ? 1u << 3 : 0u) | (static_cast<uint32_t>(debugMode) << 4);
+}
+
 void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
     assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
+  this->renderPass = renderPass;
+  // Every material, with and without SSAO, for both depth modes. The debug
+  // modes are queued behind the normal ones so they do not delay the first
+  // frame; switching to one never waits for a driver compile.
+  for (int debugMode = 0; debugMode < DEBUG_MODE_COUNT; debugMode++) {
+    for (uint32_t material = 0; material < MESH_MATERIAL_COUNT; material++) {
+      for (bool ssao : {true, false}) {
+        for (bool depthEqual : {false, true}) {
+          ShaderVariant variant{static_cast<MeshMaterial>(material), ssao,
+                                debugMode, depthEqual};
+          variants[variant.key()] = createVariant(variant);
+        }
+      }
+    }
+  }
+}
+
+std::unique_ptr<FrgPipeline> SimpleRenderSystem::createVariant(const ShaderVariant &variant) {
+  // Matches the constant_ids in triangle.frag
+  struct SpecializationData {
+    int32_t textureCount;
+    VkBool32 normalMap;
+    VkBool32 useSSAO;
+    int32_t debugMode;
+  } data{};
+  data.textureCount = variant.material == MeshMaterial::Untextured ? 0 : 1;
+  data.normalMap = variant.material == MeshMaterial::DiffuseNormal ? VK_TRUE : VK_FALSE;
+  data.useSSAO = variant.ssao ? VK_TRUE : VK_FALSE;
+  data.debugMode = variant.debugMode;
+
   PipelineConfigInfo pipelineConfig{};
   FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  frgPipeline = std::make_unique<FrgPipeline>(
+  pipelineConfig.fragmentSpecializationEntries = {
+      {0, offsetof(SpecializationData, textureCount), sizeof(int32_t)},
+      {1, offsetof(SpecializationData, normalMap), sizeof(VkBool32)},
+      {2, offsetof(SpecializationData, useSSAO), sizeof(VkBool32)},
+      {3, offsetof(SpecializationData, debugMode), sizeof(int32_t)},
+  };
+  auto bytes = reinterpret_cast<const uint8_t *>(&data);
+  pipelineConfig.fragmentSpecializationData.assign(bytes, bytes + sizeof(data));
+
+  if (variant.depthEqual) {
+    // Depth was laid down by the G-buffer pass with an identical transform, so
+    // shade only the surviving fragment of each pixel
+    pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  }
+
+  return std::make_unique<FrgPipeline>(
         frgDevice,
         "shaders/triangle.vert.spv",
         "shaders/triangle.frag.spv",
@@ -104,11 +161,24 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
     );
 }
 
+FrgPipeline &SimpleRenderSystem::getVariant(
+    const ShaderVariant &variant) const {
+  FrgPipeline &pipeline = *variants.at(variant.key());
+  if (variant.debugMode != 0 && !pipeline.isReady()) {
+    ShaderVariant normal = variant;
+    normal.debugMode = 0;
+    return *variants.at(normal.key());
+  }
+  return pipeline;
+}
+
 void SimpleRenderSystem::createComputePipeline(VkRenderPass renderPass) {
     assert(computeGraphicsPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
   PipelineConfigInfo pipelineConfig{};
   FrgPipeline::defaultPipelineConfigInfo(pipelineConfig, true);
+  // Particles also draw into the shared G-buffer depth, which is read-only there
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = computeGraphicsPipelineLayout;
   std::vector<VkDescriptorSetLayout> inp_layouts;
@@ -144,15 +214,8 @@ void SimpleRenderSystem::createUniformBuffers() {
   }
 }
 
-void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer,
-                                           std::vector<FrgGameObject> &gameObjects,
-                                           const FrgCamera &camera, float frameTime,
-                                           VkExtent2D screenSize, int debugMode) {
-  frgPipeline->bind(commandBuffer);
-  auto projectionView = camera.getProjectionMatrix() * camera.getViewMatrix();
-
+void SimpleRenderSystem::animateLights(float frameTime) {
   // Track total time for orbit animation
-  static float totalTime = 0.f;
   totalTime += frameTime;
 
   // Update light position based on orbit animation
@@ -165,8 +228,52 @@ void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer,
   if (lightManager.getPointLightCount() > 0) {
     lightManager.updatePointLight(0, lightPos);
   }
+}
+
+void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer,
+                                           std::vector<FrgGameObject> &gameObjects,
+                                           const FrgCamera &camera, float frameTime,
+                                           VkExtent2D screenSize, int debugMode,
+                                           bool depthPrepass, bool ssao) {
+  animateLights(frameTime);
+  renderGameObjectRange(commandBuffer, gameObjects, 0, gameObjects.size(),
+                        camera, screenSize, debugMode, depthPrepass, ssao);
+}
 
-  for (auto &gameObject : gameObjects) {
+void SimpleRenderSystem::renderGameObjectRange(
+    VkCommandBuffer commandBuffer, std::vector<FrgGameObject> &gameObjects,
+    size_t begin, size_t end, const FrgCamera &camera, VkExtent2D screenSize,
+    int debugMode, bool depthPrepass, bool ssao) {
+  // Look the variants up once per range rather than per mesh
+  std::array<FrgPipeline *, MESH_MATERIAL_COUNT> pipelines;
+  for (uint32_t material = 0; material < MESH_MATERIAL_COUNT; material++) {
+    pipelines[material] = &getVariant(
+        {static_cast<MeshMaterial>(material), ssao, debugMode, depthPrepass});
+  }
+  // Consecutive objects often share a material; keep their pipeline bound
+  FrgPipeline *bound = nullptr;
+  auto bindMaterial = [&](MeshMaterial material) {
+    FrgPipeline *pipeline = pipelines[static_cast<uint32_t>(material)];
+    if (pipeline != bound) {
+      pipeline->bind(commandBuffer);
+      bound = pipeline;
+    }
+  };
+
+  // Every variant shares the layout, so the sets stay bound across switches
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelineLayout, 0, frgDescriptor.descriptorSetCount(),
+                          frgDescriptor.descriptorSet(), 0, nullptr);
+  if (ssao && frgDescriptor.hasSSAOTexture()) {
+    VkDescriptorSet ssaoSet = frgDescriptor.ssaoDescriptorSet();
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pipelineLayout, 1, 1, &ssaoSet, 0, nullptr);
+  }
+  auto projectionView = camera.getProjectionMatrix() * camera.getViewMatrix();
+  LightData lightData = lightManager.getLightData();
+
+  for (size_t i = begin; i < end; i++) {
+    auto &gameObject = gameObjects[i];
     SimplePushConstantData push{};
     auto modelMat = gameObject.transform.mat4();
     push.transform = projectionView * modelMat;
@@ -174,26 +281,13 @@ void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer,
     push.normalMat = gameObject.transform.normalMat();
         push.screenSize =
             glm::vec2(static_cast<float>(screenSize.width), static_cast<float>(screenSize.height));
-    push.debugMode = debugMode;
 
-    // Get light data from manager
-    LightData lightData = lightManager.getLightData();
     if (lightData.pointLightCount > 0) {
       push.pointLightPosition = lightData.pointLights[0].position;
       push.pointLightColor = lightData.pointLights[0].color;
     }
 
-        vkCmdBindDescriptorSets(
-            commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout,
-            0,
-                            frgDescriptor.descriptorSetCount(),
-            frgDescriptor.descriptorSet(),
-            0,
-            nullptr
-        );
-    gameObject.model->draw(commandBuffer, pipelineLayout, push);
+    gameObject.model->draw(commandBuffer, pipelineLayout, push, bindMaterial);
   }
 }
 } // namespace frg
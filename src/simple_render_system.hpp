@@ -10,12 +10,17 @@
 #include "frg_pipeline.hpp"
 #include "frg_renderer.hpp"
 // std
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace frg {
 class SimpleRenderSystem {
 public:
+  // 0=normal, 1=SSAO only, 2=normals, 3=depth
+  static constexpr int DEBUG_MODE_COUNT = 4;
+
   SimpleRenderSystem(FrgDevice &device, VkRenderPass renderPass,
                      FrgDescriptor &descriptor, LightManager &lightManager);
   ~SimpleRenderSystem();
@@ -28,10 +33,20 @@ public:
   void renderGameObjects(VkCommandBuffer commandBuffer,
                          std::vector<FrgGameObject> &gameObjects,
                          const FrgCamera &camera, float frameTime,
-                         VkExtent2D screenSize, int debugMode = 0);
+                         VkExtent2D screenSize, int debugMode = 0,
+                         bool depthPrepass = false, bool ssao = true);
+  // Records gameObjects [begin, end) without advancing the lights, so ranges
+  // can be recorded on several threads; call animateLights once beforehand
+  void renderGameObjectRange(VkCommandBuffer commandBuffer,
+                             std::vector<FrgGameObject> &gameObjects,
+                             size_t begin, size_t end, const FrgCamera &camera,
+                             VkExtent2D screenSize, int debugMode = 0,
+                             bool depthPrepass = false, bool ssao = true);
 
   // Lighting interface
   LightManager &getLightManager() { return lightManager; }
+  // Advances the orbiting point light; renderGameObjects calls this itself
+  void animateLights(float frameTime);
   VkPipelineLayout getComputePipelineLayout() {
     return frgComputePipeline->getComputePipelineLayout();
   }
@@ -50,9 +65,25 @@ public:
   void bindComputeGraphicsPipeline(VkCommandBuffer buff);
 
 private:
+  // One permutation of triangle.frag, fixed through specialization constants
+  struct ShaderVariant {
+    MeshMaterial material = MeshMaterial::Diffuse;
+    bool ssao = true;
+    int debugMode = 0;
+    // Depth EQUAL, no writes: used when the G-buffer depth is already bound
+    bool depthEqual = false;
+
+    uint32_t key() const;
+  };
+
   void createPipelineLayout();
   void createComputeGraphicsPipelineLayout();
+  // Queues every variant, the debugMode 0 ones first
   void createPipeline(VkRenderPass renderPass);
+  std::unique_ptr<FrgPipeline> createVariant(const ShaderVariant &variant);
+  // Falls back to the debugMode 0 variant while a debug variant is still
+  // building. Safe to call from recording threads.
+  FrgPipeline &getVariant(const ShaderVariant &variant) const;
   void createComputePipeline(VkRenderPass renderPass);
   void createUniformBuffers();
 
@@ -60,12 +91,17 @@ private:
   FrgDescriptor &frgDescriptor;
   LightManager &lightManager;
 
-  std::unique_ptr<FrgPipeline> frgPipeline;
+  VkRenderPass renderPass;
+  // Filled once by createPipeline, read-only afterwards
+  std::unordered_map<uint32_t, std::unique_ptr<FrgPipeline>> variants;
   std::unique_ptr<FrgPipeline> frgComputePipeline;
   VkPipelineLayout pipelineLayout;
   VkPipelineLayout computeGraphicsPipelineLayout;
   std::vector<VkBuffer> ubos;
   std::vector<VkDeviceMemory> ubos_memory;
   std::vector<void *> ubos_mapped;
+
+  // Total time for the light orbit animation
+  float totalTime{0.f};
 };
 } // namespace frg
\ No newline at end of file
@@ -1,7 +1,15 @@
 #include "ssao_render_system.hpp"
 
+#include "frg_swap_chain.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 namespace frg {
@@ -10,30 +18,93 @@ SSAORenderSystem::SSAORenderSystem(FrgDevice &device, FrgGBuffer &gbuffer,
                                    FrgSSAO &ssao)
     : frgDevice{device}, gbuffer{gbuffer}, ssao{ssao} {
   createDescriptorSetLayouts();
-  createDescriptorPool();
+  createSampleStatsBuffers();
   createDescriptorSets();
   createGBufferPipelineLayout();
   createGBufferPipeline();
   createSSAOPipelineLayout();
   createSSAOPipeline();
+  createHBAOPipelineLayout();
+  createHBAOPipeline();
   createBlurPipelineLayout();
   createBlurPipeline();
+  createDownsamplePipelineLayout();
+  createDownsamplePipeline();
+  createUpsamplePipelineLayout();
+  createUpsamplePipeline();
+  createDeinterleavePipelineLayout();
+  createDeinterleavePipelines();
+  createTemporalPipelineLayout();
+  createTemporalPipeline();
+  createImportancePipelineLayout();
+  createImportancePipeline();
+  createComputePipelineLayouts();
+  createComputePipelines();
 }
 
 SSAORenderSystem::~SSAORenderSystem() {
+  // Background builds may still reference the layouts destroyed below
+  frgDevice.pipelineCompiler().waitIdle();
   VkDevice dev = frgDevice.device();
 
+  if (blurComputePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, blurComputePipelineLayout, nullptr);
+  }
+  if (ssaoComputePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, ssaoComputePipelineLayout, nullptr);
+  }
+  if (temporalPipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, temporalPipelineLayout, nullptr);
+  }
+  if (deinterleavePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, deinterleavePipelineLayout, nullptr);
+  }
+  if (importancePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, importancePipelineLayout, nullptr);
+  }
+  for (size_t i = 0; i < sampleStatsBuffers.size(); ++i) {
+    vkDestroyBuffer(dev, sampleStatsBuffers[i], nullptr);
+    vkFreeMemory(dev, sampleStatsMemory[i], nullptr);
+  }
+  if (upsamplePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, upsamplePipelineLayout, nullptr);
+  }
+  if (downsamplePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, downsamplePipelineLayout, nullptr);
+  }
   if (blurPipelineLayout != VK_NULL_HANDLE) {
     vkDestroyPipelineLayout(dev, blurPipelineLayout, nullptr);
   }
+  if (hbaoPipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, hbaoPipelineLayout, nullptr);
+  }
   if (ssaoPipelineLayout != VK_NULL_HANDLE) {
     vkDestroyPipelineLayout(dev, ssaoPipelineLayout, nullptr);
   }
   if (gbufferPipelineLayout != VK_NULL_HANDLE) {
     vkDestroyPipelineLayout(dev, gbufferPipelineLayout, nullptr);
   }
-  if (descriptorPool != VK_NULL_HANDLE) {
-    vkDestroyDescriptorPool(dev, descriptorPool, nullptr);
+  if (blurComputeDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, blurComputeDescriptorSetLayout, nullptr);
+  }
+  if (ssaoComputeDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, ssaoComputeDescriptorSetLayout, nullptr);
+  }
+  if (temporalDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, temporalDescriptorSetLayout, nullptr);
+  }
+  if (importanceDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, importanceDescriptorSetLayout, nullptr);
+  }
+  if (deinterleaveDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, deinterleaveDescriptorSetLayout,
+                                 nullptr);
+  }
+  if (upsampleDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, upsampleDescriptorSetLayout, nullptr);
+  }
+  if (downsampleDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, downsampleDescriptorSetLayout, nullptr);
   }
   if (blurDescriptorSetLayout != VK_NULL_HANDLE) {
     vkDestroyDescriptorSetLayout(dev, blurDescriptorSetLayout, nullptr);
@@ -45,12 +116,13 @@ SSAORenderSystem::~SSAORenderSystem() {
 
 void SSAORenderSystem::createDescriptorSetLayouts() {
   // SSAO descriptor set layout
-  // Binding 0: gPosition   (sampler2D)
+  // Binding 0: gDepth      (sampler2D)
   // Binding 1: gNormal     (sampler2D)
   // Binding 2: texNoise    (sampler2D)
   // Binding 3: kernel      (uniform buffer)
+  // Binding 4: importance  (sampler2D, adaptive sample counts)
   {
-    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
 
     bindings[0].binding = 0;
     bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -72,6 +144,11 @@ void SSAORenderSystem::createDescriptorSetLayouts() {
     bindings[3].descriptorCount = 1;
     bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+    bindings[4].binding = 4;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[4].descriptorCount = 1;
+    bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -85,6 +162,112 @@ void SSAORenderSystem::createDescriptorSetLayouts() {
 
   // Blur descriptor set layout
   // Binding 0: ssaoInput (sampler2D)
+  // Binding 1: gDepth    (sampler2D, AO resolution)
+  // Binding 2: gNormal   (sampler2D, AO resolution)
+  {
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &blurDescriptorSetLayout) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create blur descriptor set layout!");
+    }
+  }
+
+  // Downsample descriptor set layout
+  // Binding 0: gDepth    (sampler2D)
+  // Binding 1: gNormal   (sampler2D)
+  {
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &downsampleDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create SSAO downsample descriptor set layout!");
+    }
+  }
+
+  // Upsample descriptor set layout
+  // Binding 0: aoLow     (sampler2D)
+  // Binding 1: lowDepth  (sampler2D)
+  // Binding 2: lowNormal (sampler2D)
+  // Binding 3: gDepth    (sampler2D)
+  // Binding 4: gNormal   (sampler2D)
+  {
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &upsampleDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create SSAO upsample descriptor set layout!");
+    }
+  }
+
+  // Importance descriptor set layout
+  // Binding 0: gDepth        (sampler2D, AO resolution)
+  // Binding 1: gNormal       (sampler2D, AO resolution)
+  // Binding 2: importanceMap (r32f storage image)
+  // Binding 3: stats         (storage buffer)
+  {
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &importanceDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create SSAO importance descriptor set layout!");
+    }
+  }
+
+  // Deinterleave / reinterleave descriptor set layout
+  // Binding 0: input (sampler2D, AO-resolution depth or the AO atlas)
   {
     VkDescriptorSetLayoutBinding binding{};
     binding.binding = 0;
@@ -98,117 +281,327 @@ void SSAORenderSystem::createDescriptorSetLayouts() {
     layoutInfo.pBindings = &binding;
 
     if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
-                                    &blurDescriptorSetLayout) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create blur descriptor set layout!");
+                                    &deinterleaveDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create SSAO deinterleave descriptor set layout!");
     }
   }
-}
 
-void SSAORenderSystem::createDescriptorPool() {
-  std::array<VkDescriptorPoolSize, 2> poolSizes{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[0].descriptorCount = 5; // 3 for SSAO + 1 for blur + extra
-  poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[1].descriptorCount = 1; // kernel buffer
+  // Temporal descriptor set layout
+  // Binding 0: ssaoInput (sampler2D, this frame's partial AO)
+  // Binding 1: gDepth    (sampler2D, AO resolution)
+  // Binding 2: history   (sampler2D, previous frame's accumulation)
+  {
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
 
-  VkDescriptorPoolCreateInfo poolInfo{};
-  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-  poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = 2; // SSAO + blur
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
 
-  if (vkCreateDescriptorPool(frgDevice.device(), &poolInfo, nullptr,
-                             &descriptorPool) != VK_SUCCESS) {
-    throw std::runtime_error("Failed to create SSAO descriptor pool!");
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &temporalDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create SSAO temporal descriptor set layout!");
+    }
   }
-}
 
-void SSAORenderSystem::createDescriptorSets() {
-  // Allocate SSAO descriptor set
+  // Compute SSAO descriptor set layout
+  // Binding 0-3: same as the SSAO set
+  // Binding 4:   ssaoOutput (r8 storage image)
   {
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &ssaoDescriptorSetLayout;
-
-    if (vkAllocateDescriptorSets(frgDevice.device(), &allocInfo,
-                                 &ssaoDescriptorSet) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to allocate SSAO descriptor set!");
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     }
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 
-    // Update descriptor set
-    VkDescriptorImageInfo positionInfo = gbuffer.getPositionDescriptor();
-    VkDescriptorImageInfo normalInfo = gbuffer.getNormalDescriptor();
-    VkDescriptorImageInfo noiseInfo = ssao.getNoiseDescriptor();
-    VkDescriptorBufferInfo kernelInfo = ssao.getKernelDescriptor();
-
-    std::array<VkWriteDescriptorSet, 4> writes{};
-
-    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[0].dstSet = ssaoDescriptorSet;
-    writes[0].dstBinding = 0;
-    writes[0].dstArrayElement = 0;
-    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    writes[0].descriptorCount = 1;
-    writes[0].pImageInfo = &positionInfo;
-
-    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[1].dstSet = ssaoDescriptorSet;
-    writes[1].dstBinding = 1;
-    writes[1].dstArrayElement = 0;
-    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    writes[1].descriptorCount = 1;
-    writes[1].pImageInfo = &normalInfo;
-
-    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[2].dstSet = ssaoDescriptorSet;
-    writes[2].dstBinding = 2;
-    writes[2].dstArrayElement = 0;
-    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    writes[2].descriptorCount = 1;
-    writes[2].pImageInfo = &noiseInfo;
-
-    writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[3].dstSet = ssaoDescriptorSet;
-    writes[3].dstBinding = 3;
-    writes[3].dstArrayElement = 0;
-    writes[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    writes[3].descriptorCount = 1;
-    writes[3].pBufferInfo = &kernelInfo;
-
-    vkUpdateDescriptorSets(frgDevice.device(),
-                           static_cast<uint32_t>(writes.size()), writes.data(),
-                           0, nullptr);
-  }
-
-  // Allocate blur descriptor set
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &ssaoComputeDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create compute SSAO descriptor set layout!");
+    }
+  }
+
+  // Compute blur descriptor set layout
+  // Binding 0-2: same as the blur set
+  // Binding 3:   blurOutput (r8 storage image)
   {
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &blurDescriptorSetLayout;
-
-    if (vkAllocateDescriptorSets(frgDevice.device(), &allocInfo,
-                                 &blurDescriptorSet) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to allocate blur descriptor set!");
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                    &blurComputeDescriptorSetLayout) !=
+        VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create compute blur descriptor set layout!");
+    }
+  }
+}
+
+void SSAORenderSystem::createSampleStatsBuffers() {
+  VkDeviceSize bufferSize = sizeof(SampleStats);
+
+  sampleStatsBuffers.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+  sampleStatsMemory.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+  sampleStatsMapped.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+  sampleStatsPending.assign(FrgSwapChain::MAX_FRAMES_IN_FLIGHT, false);
+
+  // Host-visible: the CPU reads the totals once the frame was retired
+  for (size_t i = 0; i < sampleStatsBuffers.size(); ++i) {
+    frgDevice.createBuffer(bufferSize,
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           sampleStatsBuffers[i], sampleStatsMemory[i]);
+    vkMapMemory(frgDevice.device(), sampleStatsMemory[i], 0, bufferSize, 0,
+                &sampleStatsMapped[i]);
+  }
+}
+
+std::array<std::pair<VkDescriptorSetLayout, VkDescriptorSet *>, 14>
+SSAORenderSystem::descriptorSetSlots() {
+  return {{{ssaoDescriptorSetLayout, &ssaoDescriptorSet},
+           {blurDescriptorSetLayout, &blurHorizontalDescriptorSet},
+           {blurDescriptorSetLayout, &blurVerticalDescriptorSet},
+           {downsampleDescriptorSetLayout, &downsampleDescriptorSet},
+           {upsampleDescriptorSetLayout, &upsampleDescriptorSet},
+           {ssaoComputeDescriptorSetLayout, &ssaoComputeDescriptorSet},
+           {blurComputeDescriptorSetLayout, &blurComputeDescriptorSet},
+           {temporalDescriptorSetLayout, &temporalDescriptorSets[0]},
+           {temporalDescriptorSetLayout, &temporalDescriptorSets[1]},
+           {blurDescriptorSetLayout, &blurTemporalDescriptorSets[0]},
+           {blurDescriptorSetLayout, &blurTemporalDescriptorSets[1]},
+           {deinterleaveDescriptorSetLayout, &deinterleaveDescriptorSet},
+           {deinterleaveDescriptorSetLayout, &reinterleaveDescriptorSet},
+           {ssaoDescriptorSetLayout, &ssaoDeinterleavedDescriptorSet}}};
+}
+
+void SSAORenderSystem::createDescriptorSets() {
+  FrgDescriptorAllocator &allocator = frgDevice.descriptorAllocator();
+  for (auto &[layout, set] : descriptorSetSlots()) {
+    *set = allocator.allocate(layout);
+  }
+
+  importanceDescriptorSets.resize(FrgSwapChain::MAX_FRAMES_IN_FLIGHT);
+  allocator.allocate(importanceDescriptorSetLayout, importanceDescriptorSets);
+
+  writeDescriptorSets();
+}
+
+void SSAORenderSystem::retireDescriptorSets() {
+  std::vector<std::pair<VkDescriptorSetLayout, VkDescriptorSet>> retired;
+  for (auto &[layout, set] : descriptorSetSlots()) {
+    retired.emplace_back(layout, *set);
+  }
+  for (VkDescriptorSet set : importanceDescriptorSets) {
+    retired.emplace_back(importanceDescriptorSetLayout, set);
+  }
+
+  FrgDescriptorAllocator &allocator = frgDevice.descriptorAllocator();
+  frgDevice.deletionQueue().retire([&allocator, retired] {
+    for (auto &[layout, set] : retired) {
+      allocator.release(layout, set);
     }
+  });
+}
 
-    // Update descriptor set
-    VkDescriptorImageInfo ssaoInfo = ssao.getSSAODescriptor();
+void SSAORenderSystem::updateDescriptorSets() {
+  retireDescriptorSets();
+  createDescriptorSets();
+}
 
+void SSAORenderSystem::writeDescriptorSets() {
+  bool reduced = ssao.isReducedResolution();
+
+  // SSAO reads the downsampled G-buffer when running at reduced resolution
+  VkDescriptorImageInfo depthInfo =
+      reduced ? ssao.getLowDepthDescriptor() : gbuffer.getDepthDescriptor();
+  VkDescriptorImageInfo normalInfo =
+      reduced ? ssao.getLowNormalDescriptor() : gbuffer.getNormalDescriptor();
+  VkDescriptorImageInfo noiseInfo = ssao.getNoiseDescriptor();
+  VkDescriptorBufferInfo kernelInfo = ssao.getKernelDescriptor();
+  VkDescriptorImageInfo ssaoInfo = ssao.getSSAODescriptor();
+  VkDescriptorImageInfo blurTempInfo = ssao.getBlurTempDescriptor();
+
+  VkDescriptorImageInfo gDepthInfo = gbuffer.getDepthDescriptor();
+  VkDescriptorImageInfo gNormalInfo = gbuffer.getNormalDescriptor();
+  VkDescriptorImageInfo blurLowInfo = ssao.getBlurLowDescriptor();
+  VkDescriptorImageInfo lowDepthInfo = ssao.getLowDepthDescriptor();
+  VkDescriptorImageInfo lowNormalInfo = ssao.getLowNormalDescriptor();
+  VkDescriptorImageInfo ssaoStorageInfo = ssao.getSSAOStorageDescriptor();
+  VkDescriptorImageInfo blurStorageInfo = ssao.getBlurStorageDescriptor();
+  VkDescriptorImageInfo importanceInfo = ssao.getImportanceDescriptor();
+  VkDescriptorImageInfo depthAtlasInfo =
+      ssao.getDeinterleavedDepthDescriptor();
+  VkDescriptorImageInfo aoAtlasInfo = ssao.getDeinterleavedAODescriptor();
+  std::array<VkDescriptorImageInfo, 2> historyInfos = {
+      ssao.getHistoryDescriptor(0), ssao.getHistoryDescriptor(1)};
+
+  auto imageWrite = [](VkDescriptorSet set, uint32_t binding,
+                       const VkDescriptorImageInfo *info) {
     VkWriteDescriptorSet write{};
     write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.dstSet = blurDescriptorSet;
-    write.dstBinding = 0;
+    write.dstSet = set;
+    write.dstBinding = binding;
     write.dstArrayElement = 0;
     write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     write.descriptorCount = 1;
-    write.pImageInfo = &ssaoInfo;
+    write.pImageInfo = info;
+    return write;
+  };
+
+  std::vector<VkWriteDescriptorSet> writes;
+
+  // SSAO set
+  writes.push_back(imageWrite(ssaoDescriptorSet, 0, &depthInfo));
+  writes.push_back(imageWrite(ssaoDescriptorSet, 1, &normalInfo));
+  writes.push_back(imageWrite(ssaoDescriptorSet, 2, &noiseInfo));
+
+  VkWriteDescriptorSet kernelWrite{};
+  kernelWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  kernelWrite.dstSet = ssaoDescriptorSet;
+  kernelWrite.dstBinding = 3;
+  kernelWrite.dstArrayElement = 0;
+  kernelWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  kernelWrite.descriptorCount = 1;
+  kernelWrite.pBufferInfo = &kernelInfo;
+  writes.push_back(kernelWrite);
+  writes.push_back(imageWrite(ssaoDescriptorSet, 4, &importanceInfo));
+
+  // Blur sets: horizontal reads raw SSAO, vertical reads the intermediate.
+  // Both weight taps by the AO-resolution depth/normal.
+  writes.push_back(imageWrite(blurHorizontalDescriptorSet, 0, &ssaoInfo));
+  writes.push_back(imageWrite(blurHorizontalDescriptorSet, 1, &depthInfo));
+  writes.push_back(imageWrite(blurHorizontalDescriptorSet, 2, &normalInfo));
+  writes.push_back(imageWrite(blurVerticalDescriptorSet, 0, &blurTempInfo));
+  writes.push_back(imageWrite(blurVerticalDescriptorSet, 1, &depthInfo));
+  writes.push_back(imageWrite(blurVerticalDescriptorSet, 2, &normalInfo));
+
+  // Deinterleaved SSAO: split the SSAO set's depth, run SSAO on the atlas,
+  // gather the AO atlas back
+  writes.push_back(imageWrite(deinterleaveDescriptorSet, 0, &depthInfo));
+  writes.push_back(
+      imageWrite(ssaoDeinterleavedDescriptorSet, 0, &depthAtlasInfo));
+  writes.push_back(imageWrite(ssaoDeinterleavedDescriptorSet, 1, &normalInfo));
+  writes.push_back(imageWrite(ssaoDeinterleavedDescriptorSet, 2, &noiseInfo));
+  VkWriteDescriptorSet deinterleavedKernelWrite = kernelWrite;
+  deinterleavedKernelWrite.dstSet = ssaoDeinterleavedDescriptorSet;
+  writes.push_back(deinterleavedKernelWrite);
+  writes.push_back(
+      imageWrite(ssaoDeinterleavedDescriptorSet, 4, &importanceInfo));
+  writes.push_back(imageWrite(reinterleaveDescriptorSet, 0, &aoAtlasInfo));
+
+  // Importance sets: same inputs as SSAO, one stats buffer per frame
+  std::vector<VkDescriptorBufferInfo> statsInfos(sampleStatsBuffers.size());
+  for (size_t i = 0; i < importanceDescriptorSets.size(); i++) {
+    writes.push_back(imageWrite(importanceDescriptorSets[i], 0, &depthInfo));
+    writes.push_back(imageWrite(importanceDescriptorSets[i], 1, &normalInfo));
+
+    VkWriteDescriptorSet importanceStorageWrite =
+        imageWrite(importanceDescriptorSets[i], 2, &importanceInfo);
+    importanceStorageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes.push_back(importanceStorageWrite);
+
+    statsInfos[i].buffer = sampleStatsBuffers[i];
+    statsInfos[i].offset = 0;
+    statsInfos[i].range = sizeof(SampleStats);
+
+    VkWriteDescriptorSet statsWrite{};
+    statsWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    statsWrite.dstSet = importanceDescriptorSets[i];
+    statsWrite.dstBinding = 3;
+    statsWrite.dstArrayElement = 0;
+    statsWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    statsWrite.descriptorCount = 1;
+    statsWrite.pBufferInfo = &statsInfos[i];
+    writes.push_back(statsWrite);
+  }
+
+  // Temporal set i writes history i and reads history 1 - i; the matching
+  // horizontal blur set then reads history i instead of the raw SSAO
+  for (uint32_t i = 0; i < 2; i++) {
+    writes.push_back(imageWrite(temporalDescriptorSets[i], 0, &ssaoInfo));
+    writes.push_back(imageWrite(temporalDescriptorSets[i], 1, &depthInfo));
+    writes.push_back(
+        imageWrite(temporalDescriptorSets[i], 2, &historyInfos[1 - i]));
+    writes.push_back(
+        imageWrite(blurTemporalDescriptorSets[i], 0, &historyInfos[i]));
+    writes.push_back(imageWrite(blurTemporalDescriptorSets[i], 1, &depthInfo));
+    writes.push_back(
+        imageWrite(blurTemporalDescriptorSets[i], 2, &normalInfo));
+  }
 
-    vkUpdateDescriptorSets(frgDevice.device(), 1, &write, 0, nullptr);
+  // Downsample/upsample sets only reference valid views at reduced resolution
+  if (reduced) {
+    writes.push_back(imageWrite(downsampleDescriptorSet, 0, &gDepthInfo));
+    writes.push_back(imageWrite(downsampleDescriptorSet, 1, &gNormalInfo));
+
+    writes.push_back(imageWrite(upsampleDescriptorSet, 0, &blurLowInfo));
+    writes.push_back(imageWrite(upsampleDescriptorSet, 1, &lowDepthInfo));
+    writes.push_back(imageWrite(upsampleDescriptorSet, 2, &lowNormalInfo));
+    writes.push_back(imageWrite(upsampleDescriptorSet, 3, &gDepthInfo));
+    writes.push_back(imageWrite(upsampleDescriptorSet, 4, &gNormalInfo));
+  }
+
+  // Compute sets mirror the SSAO/blur sets plus their storage outputs
+  if (ssao.supportsCompute()) {
+    writes.push_back(imageWrite(ssaoComputeDescriptorSet, 0, &depthInfo));
+    writes.push_back(imageWrite(ssaoComputeDescriptorSet, 1, &normalInfo));
+    writes.push_back(imageWrite(ssaoComputeDescriptorSet, 2, &noiseInfo));
+
+    VkWriteDescriptorSet computeKernelWrite = kernelWrite;
+    computeKernelWrite.dstSet = ssaoComputeDescriptorSet;
+    writes.push_back(computeKernelWrite);
+
+    VkWriteDescriptorSet ssaoStorageWrite =
+        imageWrite(ssaoComputeDescriptorSet, 4, &ssaoStorageInfo);
+    ssaoStorageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes.push_back(ssaoStorageWrite);
+
+    writes.push_back(imageWrite(blurComputeDescriptorSet, 0, &ssaoInfo));
+    writes.push_back(imageWrite(blurComputeDescriptorSet, 1, &depthInfo));
+    writes.push_back(imageWrite(blurComputeDescriptorSet, 2, &normalInfo));
+
+    VkWriteDescriptorSet blurStorageWrite =
+        imageWrite(blurComputeDescriptorSet, 3, &blurStorageInfo);
+    blurStorageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes.push_back(blurStorageWrite);
   }
+
+  vkUpdateDescriptorSets(frgDevice.device(),
+                         static_cast<uint32_t>(writes.size()), writes.data(),
+                         0, nullptr);
 }
 
 void SSAORenderSystem::createGBufferPipelineLayout() {
@@ -237,20 +630,21 @@ void SSAORenderSystem::createGBufferPipeline() {
   PipelineConfigInfo pipelineConfig{};
   FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
 
-  // G-buffer has 2 color attachments (position + normal)
+  // G-buffer has 2 color attachments (normal + albedo); this pipeline only
+  // feeds SSAO, so albedo keeps its clear value
   pipelineConfig.colorBlendAttachments.resize(2);
   pipelineConfig.colorBlendAttachments[0].colorWriteMask =
-      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT;
   pipelineConfig.colorBlendAttachments[0].blendEnable = VK_FALSE;
   pipelineConfig.colorBlendAttachments[1] =
       pipelineConfig.colorBlendAttachments[0];
+  pipelineConfig.colorBlendAttachments[1].colorWriteMask = 0;
 
   pipelineConfig.colorBlendInfo.attachmentCount = 2;
   pipelineConfig.colorBlendInfo.pAttachments =
       pipelineConfig.colorBlendAttachments.data();
 
-  pipelineConfig.renderPass = gbuffer.getRenderPass();
+  FrgPipeline::setRenderTarget(pipelineConfig, gbuffer.getTarget());
   pipelineConfig.pipelineLayout = gbufferPipelineLayout;
 
   gbufferPipeline =
@@ -292,7 +686,7 @@ void SSAORenderSystem::createSSAOPipeline() {
   pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
   pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
 
-  pipelineConfig.renderPass = ssao.getSSAORenderPass();
+  FrgPipeline::setRenderTarget(pipelineConfig, ssao.getSSAOTarget());
   pipelineConfig.pipelineLayout = ssaoPipelineLayout;
 
   ssaoPipeline =
@@ -300,13 +694,61 @@ void SSAORenderSystem::createSSAOPipeline() {
                                     "shaders/ssao.frag.spv", pipelineConfig);
 }
 
+void SSAORenderSystem::createHBAOPipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(HBAOPushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &ssaoDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &hbaoPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create HBAO pipeline layout!");
+  }
+}
+
+void SSAORenderSystem::createHBAOPipeline() {
+  assert(hbaoPipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen quad - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // No depth testing for fullscreen pass
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  // Drop-in replacement for the SSAO pipeline
+  FrgPipeline::setRenderTarget(pipelineConfig, ssao.getSSAOTarget());
+  pipelineConfig.pipelineLayout = hbaoPipelineLayout;
+
+  hbaoPipeline =
+      std::make_unique<FrgPipeline>(frgDevice, "shaders/ssao.vert.spv",
+                                    "shaders/hbao.frag.spv", pipelineConfig);
+}
+
 void SSAORenderSystem::createBlurPipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(BlurPushConstants);
+
   VkPipelineLayoutCreateInfo layoutInfo{};
   layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   layoutInfo.setLayoutCount = 1;
   layoutInfo.pSetLayouts = &blurDescriptorSetLayout;
-  layoutInfo.pushConstantRangeCount = 0;
-  layoutInfo.pPushConstantRanges = nullptr;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
 
   if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
                              &blurPipelineLayout) != VK_SUCCESS) {
@@ -329,7 +771,7 @@ void SSAORenderSystem::createBlurPipeline() {
   pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
   pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
 
-  pipelineConfig.renderPass = ssao.getBlurRenderPass();
+  FrgPipeline::setRenderTarget(pipelineConfig, ssao.getBlurTarget());
   pipelineConfig.pipelineLayout = blurPipelineLayout;
 
   // Reuse ssao.vert for blur pass
@@ -338,25 +780,322 @@ void SSAORenderSystem::createBlurPipeline() {
       pipelineConfig);
 }
 
-void SSAORenderSystem::beginGBufferPass(VkCommandBuffer commandBuffer) {
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = gbuffer.getRenderPass();
-  renderPassInfo.framebuffer = gbuffer.getFramebuffer();
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = gbuffer.getExtent();
+void SSAORenderSystem::createDownsamplePipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(DownsamplePushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &downsampleDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &downsamplePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create SSAO downsample pipeline layout!");
+  }
+}
+
+void SSAORenderSystem::createDownsamplePipeline() {
+  assert(downsamplePipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen quad - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // No depth testing for fullscreen pass
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  // Two color attachments (low-res depth + normal)
+  pipelineConfig.colorBlendAttachments.resize(2);
+  pipelineConfig.colorBlendAttachments[1] =
+      pipelineConfig.colorBlendAttachments[0];
+  pipelineConfig.colorBlendInfo.attachmentCount = 2;
+  pipelineConfig.colorBlendInfo.pAttachments =
+      pipelineConfig.colorBlendAttachments.data();
+
+  FrgPipeline::setRenderTarget(pipelineConfig,
+                               ssao.getDownsampleTarget());
+  pipelineConfig.pipelineLayout = downsamplePipelineLayout;
+
+  downsamplePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/ssao_downsample.frag.spv",
+      pipelineConfig);
+}
+
+void SSAORenderSystem::createUpsamplePipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(UpsamplePushConstants);
 
-  // Clear values for position, normal, and depth
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &upsampleDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &upsamplePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO upsample pipeline layout!");
+  }
+}
+
+void SSAORenderSystem::createUpsamplePipeline() {
+  assert(upsamplePipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen quad - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // No depth testing for fullscreen pass
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  // Writes the full-res blurred image
+  FrgPipeline::setRenderTarget(pipelineConfig, ssao.getUpsampleTarget());
+  pipelineConfig.pipelineLayout = upsamplePipelineLayout;
+
+  upsamplePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/ssao_upsample.frag.spv",
+      pipelineConfig);
+}
+
+void SSAORenderSystem::createDeinterleavePipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(DeinterleavePushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &deinterleaveDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &deinterleavePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create SSAO deinterleave pipeline layout!");
+  }
+}
+
+void SSAORenderSystem::createDeinterleavePipelines() {
+  assert(deinterleavePipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen quad - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // No depth testing for fullscreen pass
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  FrgPipeline::setRenderTarget(pipelineConfig,
+                               ssao.getDeinterleaveTarget());
+  pipelineConfig.pipelineLayout = deinterleavePipelineLayout;
+  deinterleavePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/ssao_deinterleave.frag.spv",
+      pipelineConfig);
+
+  // The AO atlas and the reinterleaved result are both SSAO-format targets
+  FrgPipeline::setRenderTarget(pipelineConfig, ssao.getSSAOTarget());
+  pipelineConfig.pipelineLayout = ssaoPipelineLayout;
+  deinterleavedSSAOPipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv",
+      "shaders/ssao_deinterleaved.frag.spv", pipelineConfig);
+
+  pipelineConfig.pipelineLayout = deinterleavePipelineLayout;
+  reinterleavePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/ssao_reinterleave.frag.spv",
+      pipelineConfig);
+}
+
+void SSAORenderSystem::createTemporalPipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(TemporalPushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &temporalDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &temporalPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create SSAO temporal pipeline layout!");
+  }
+}
+
+void SSAORenderSystem::createTemporalPipeline() {
+  assert(temporalPipelineLayout != nullptr &&
+         "Cannot create pipeline before layout!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen quad - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // No depth testing for fullscreen pass
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  FrgPipeline::setRenderTarget(pipelineConfig, ssao.getHistoryTarget());
+  pipelineConfig.pipelineLayout = temporalPipelineLayout;
+
+  temporalPipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/ssao_temporal.frag.spv",
+      pipelineConfig);
+}
+
+void SSAORenderSystem::createImportancePipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ImportancePushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &importanceDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &importancePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create SSAO importance pipeline layout!");
+  }
+}
+
+void SSAORenderSystem::createImportancePipeline() {
+  // r32f storage is core, so this works without extended formats
+  importancePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao_importance.comp.spv", importancePipelineLayout);
+}
+
+void SSAORenderSystem::createComputePipelineLayouts() {
+  // SSAO: same push constants as the fragment path
+  {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(SSAOPushConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &ssaoComputeDescriptorSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                               &ssaoComputePipelineLayout) != VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create compute SSAO pipeline layout!");
+    }
+  }
+
+  // Blur
+  {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(BlurPushConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &blurComputeDescriptorSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                               &blurComputePipelineLayout) != VK_SUCCESS) {
+      throw std::runtime_error(
+          "Failed to create compute blur pipeline layout!");
+    }
+  }
+}
+
+void SSAORenderSystem::createComputePipelines() {
+  // The shaders write r8 storage images; skip if the device cannot
+  if (!ssao.supportsCompute()) {
+    return;
+  }
+
+  ssaoComputePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.comp.spv", ssaoComputePipelineLayout);
+  blurComputePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao_blur.comp.spv", blurComputePipelineLayout);
+}
+
+bool SSAORenderSystem::isReady(AOMethod method, bool compute) const {
+  if (!gbufferPipeline->isReady()) {
+    return false;
+  }
+  if (ssao.isReducedResolution() &&
+      !(downsamplePipeline->isReady() && upsamplePipeline->isReady())) {
+    return false;
+  }
+  if (compute) {
+    return ssaoComputePipeline && ssaoComputePipeline->isReady() &&
+           blurComputePipeline->isReady();
+  }
+
+  bool hemisphere = method == AOMethod::Hemisphere;
+  bool aoReady;
+  if (!hemisphere) {
+    aoReady = hbaoPipeline->isReady();
+  } else if (deinterleaved) {
+    aoReady = deinterleavePipeline->isReady() &&
+              deinterleavedSSAOPipeline->isReady() &&
+              reinterleavePipeline->isReady();
+  } else {
+    aoReady = ssaoPipeline->isReady();
+  }
+  return aoReady && blurPipeline->isReady() &&
+         (!temporalEnabled || temporalPipeline->isReady()) &&
+         (!(adaptiveSampling && hemisphere) || importancePipeline->isReady());
+}
+
+void SSAORenderSystem::beginGBufferPass(VkCommandBuffer commandBuffer,
+                                        VkSubpassContents contents) {
+  // Clear values for normal, albedo, and depth (1.0 marks background)
   std::array<VkClearValue, 3> clearValues{};
-  clearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Position
-  clearValues[1].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Normal
+  clearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Normal
+  clearValues[1].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Albedo
   clearValues[2].depthStencil = {1.0f, 0};           // Depth
 
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  renderPassInfo.pClearValues = clearValues.data();
-
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  gbuffer.getTarget().begin(frgDevice, commandBuffer, clearValues.data(),
+                            contents);
+  if (contents != VK_SUBPASS_CONTENTS_INLINE) {
+    return;
+  }
 
   // Set viewport and scissor
   VkViewport viewport{};
@@ -374,88 +1113,283 @@ void SSAORenderSystem::beginGBufferPass(VkCommandBuffer commandBuffer) {
 }
 
 void SSAORenderSystem::endGBufferPass(VkCommandBuffer commandBuffer) {
-  vkCmdEndRenderPass(commandBuffer);
+  gbuffer.getTarget().end(frgDevice, commandBuffer);
 }
 
-void SSAORenderSystem::beginSSAOPass(VkCommandBuffer commandBuffer) {
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = ssao.getSSAORenderPass();
-  renderPassInfo.framebuffer = ssao.getSSAOFramebuffer();
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = ssao.getExtent();
-
-  VkClearValue clearValue{};
-  clearValue.color = {{1.0f, 1.0f, 1.0f, 1.0f}}; // Default to no occlusion
+void SSAORenderSystem::beginFullscreenPass(VkCommandBuffer commandBuffer,
+                                           const FrgRenderTarget &target) {
+  // Default to no occlusion (also harmless for the downsample targets)
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color = {{1.0f, 1.0f, 1.0f, 1.0f}};
+  clearValues[1].color = {{1.0f, 1.0f, 1.0f, 1.0f}};
 
-  renderPassInfo.clearValueCount = 1;
-  renderPassInfo.pClearValues = &clearValue;
+  target.begin(frgDevice, commandBuffer, clearValues.data());
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  VkExtent2D extent = target.extent;
 
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(ssao.getExtent().width);
-  viewport.height = static_cast<float>(ssao.getExtent().height);
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
-  VkRect2D scissor{{0, 0}, ssao.getExtent()};
+  VkRect2D scissor{{0, 0}, extent};
 
   vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
+void SSAORenderSystem::beginSSAOPass(VkCommandBuffer commandBuffer) {
+  beginFullscreenPass(commandBuffer, usesDeinterleaving()
+                                         ? ssao.getDeinterleavedSSAOTarget()
+                                         : ssao.getSSAOTarget());
+}
+
 void SSAORenderSystem::endSSAOPass(VkCommandBuffer commandBuffer) {
-  vkCmdEndRenderPass(commandBuffer);
+  ssao.getSSAOTarget().end(frgDevice, commandBuffer);
 }
 
-void SSAORenderSystem::beginBlurPass(VkCommandBuffer commandBuffer) {
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = ssao.getBlurRenderPass();
-  renderPassInfo.framebuffer = ssao.getBlurFramebuffer();
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = ssao.getExtent();
+void SSAORenderSystem::beginBlurPass(VkCommandBuffer commandBuffer,
+                                     BlurDirection direction) {
+  // Horizontal writes the intermediate, vertical the blur target
+  beginFullscreenPass(commandBuffer, direction == BlurDirection::Horizontal
+                                         ? ssao.getBlurTempTarget()
+                                         : ssao.getBlurTarget());
+}
 
-  VkClearValue clearValue{};
-  clearValue.color = {{1.0f, 1.0f, 1.0f, 1.0f}};
+void SSAORenderSystem::endBlurPass(VkCommandBuffer commandBuffer) {
+  ssao.getBlurTarget().end(frgDevice, commandBuffer);
+}
 
-  renderPassInfo.clearValueCount = 1;
-  renderPassInfo.pClearValues = &clearValue;
+void SSAORenderSystem::beginDeinterleavePass(VkCommandBuffer commandBuffer) {
+  beginFullscreenPass(commandBuffer, ssao.getDeinterleaveTarget());
+}
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+void SSAORenderSystem::endDeinterleavePass(VkCommandBuffer commandBuffer) {
+  ssao.getDeinterleaveTarget().end(frgDevice, commandBuffer);
+}
 
-  VkViewport viewport{};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = static_cast<float>(ssao.getExtent().width);
-  viewport.height = static_cast<float>(ssao.getExtent().height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
+void SSAORenderSystem::beginReinterleavePass(VkCommandBuffer commandBuffer) {
+  beginFullscreenPass(commandBuffer, ssao.getSSAOTarget());
+}
 
-  VkRect2D scissor{{0, 0}, ssao.getExtent()};
+void SSAORenderSystem::endReinterleavePass(VkCommandBuffer commandBuffer) {
+  ssao.getSSAOTarget().end(frgDevice, commandBuffer);
+}
 
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+void SSAORenderSystem::beginTemporalPass(VkCommandBuffer commandBuffer) {
+  beginFullscreenPass(commandBuffer, ssao.getHistoryTarget());
 }
 
-void SSAORenderSystem::endBlurPass(VkCommandBuffer commandBuffer) {
-  vkCmdEndRenderPass(commandBuffer);
+void SSAORenderSystem::endTemporalPass(VkCommandBuffer commandBuffer) {
+  ssao.getHistoryTarget().end(frgDevice, commandBuffer);
+}
+
+void SSAORenderSystem::beginDownsamplePass(VkCommandBuffer commandBuffer) {
+  beginFullscreenPass(commandBuffer, ssao.getDownsampleTarget());
+}
+
+void SSAORenderSystem::endDownsamplePass(VkCommandBuffer commandBuffer) {
+  ssao.getDownsampleTarget().end(frgDevice, commandBuffer);
+}
+
+void SSAORenderSystem::beginUpsamplePass(VkCommandBuffer commandBuffer) {
+  beginFullscreenPass(commandBuffer, ssao.getUpsampleTarget());
+}
+
+void SSAORenderSystem::endUpsamplePass(VkCommandBuffer commandBuffer) {
+  ssao.getUpsampleTarget().end(frgDevice, commandBuffer);
+}
+
+FrgRenderGraph::Resource
+SSAORenderSystem::addPasses(FrgRenderGraph &graph,
+                            const FrgGBuffer::GraphImages &gbufferImages,
+                            const FrgSSAO::GraphImages &aoImages,
+                            const FrgCamera &camera, uint32_t frameIndex,
+                            bool compute) {
+  using Usage = FrgRenderGraph::Usage;
+  using Resource = FrgRenderGraph::Resource;
+  constexpr Usage SAMPLED = Usage::SampledFragment;
+  constexpr Usage COLOR = Usage::ColorAttachment;
+
+  // Everything between downsample and upsample runs at the AO resolution
+  bool reduced = ssao.isReducedResolution();
+  Resource depth = reduced ? aoImages.lowDepth : gbufferImages.depth;
+  Resource normal = reduced ? aoImages.lowNormal : gbufferImages.normal;
+  Resource blurTarget = reduced ? aoImages.blurLow : aoImages.blurred;
+
+  if (reduced) {
+    graph.addPass("ssao downsample",
+                  {{gbufferImages.depth, SAMPLED},
+                   {gbufferImages.normal, SAMPLED},
+                   {aoImages.lowDepth, COLOR},
+                   {aoImages.lowNormal, COLOR}},
+                  [this](VkCommandBuffer commandBuffer) {
+                    beginDownsamplePass(commandBuffer);
+                    renderDownsample(commandBuffer);
+                    endDownsamplePass(commandBuffer);
+                  });
+  }
+
+  if (compute) {
+    graph.addPass("ssao compute",
+                  {{depth, Usage::SampledCompute},
+                   {normal, Usage::SampledCompute},
+                   {aoImages.ssao, Usage::StorageCompute}},
+                  [this, &camera](VkCommandBuffer commandBuffer) {
+                    renderSSAOCompute(commandBuffer, camera);
+                  });
+    graph.addPass("ssao blur compute",
+                  {{aoImages.ssao, Usage::SampledCompute},
+                   {depth, Usage::SampledCompute},
+                   {normal, Usage::SampledCompute},
+                   {blurTarget, Usage::StorageCompute}},
+                  [this, &camera](VkCommandBuffer commandBuffer) {
+                    renderBlurCompute(commandBuffer, camera);
+                  });
+  } else {
+    bool deinterleave = usesDeinterleaving();
+    bool adaptive = usesAdaptiveSampling();
+
+    if (adaptive) {
+      graph.addPass(
+          "ssao importance",
+          {{depth, Usage::SampledCompute},
+           {normal, Usage::SampledCompute},
+           {aoImages.importance, Usage::StorageCompute}},
+          [this, frameIndex, &camera](VkCommandBuffer commandBuffer) {
+            renderImportance(commandBuffer, frameIndex, camera);
+          });
+    }
+    if (deinterleave) {
+      graph.addPass("ssao deinterleave",
+                    {{depth, SAMPLED}, {aoImages.deinterleavedDepth, COLOR}},
+                    [this](VkCommandBuffer commandBuffer) {
+                      beginDeinterleavePass(commandBuffer);
+                      renderDeinterleave(commandBuffer);
+                      endDeinterleavePass(commandBuffer);
+                    });
+    }
+
+    graph.addPass(
+        "ssao",
+        {{deinterleave ? aoImages.deinterleavedDepth : depth, SAMPLED},
+         {normal, SAMPLED},
+         {adaptive ? aoImages.importance : FrgRenderGraph::NO_RESOURCE,
+          SAMPLED},
+         {deinterleave ? aoImages.deinterleavedAO : aoImages.ssao, COLOR}},
+        [this, &camera](VkCommandBuffer commandBuffer) {
+          beginSSAOPass(commandBuffer);
+          renderSSAO(commandBuffer, camera);
+          endSSAOPass(commandBuffer);
+        });
+
+    if (deinterleave) {
+      graph.addPass("ssao reinterleave",
+                    {{aoImages.deinterleavedAO, SAMPLED},
+                     {aoImages.ssao, COLOR}},
+                    [this](VkCommandBuffer commandBuffer) {
+                      beginReinterleavePass(commandBuffer);
+                      renderReinterleave(commandBuffer);
+                      endReinterleavePass(commandBuffer);
+                    });
+    }
+
+    Resource blurInput = aoImages.ssao;
+    if (temporalEnabled) {
+      // Swapped while building so the passes below agree on the index
+      ssao.swapHistory();
+      uint32_t index = ssao.getHistoryIndex();
+      graph.addPass("ssao temporal",
+                    {{aoImages.ssao, SAMPLED},
+                     {depth, SAMPLED},
+                     {aoImages.history[1 - index], SAMPLED},
+                     {aoImages.history[index], COLOR}},
+                    [this, &camera](VkCommandBuffer commandBuffer) {
+                      beginTemporalPass(commandBuffer);
+                      renderTemporal(commandBuffer, camera);
+                      endTemporalPass(commandBuffer);
+                    });
+      blurInput = aoImages.history[index];
+    }
+
+    graph.addPass("ssao blur horizontal",
+                  {{blurInput, SAMPLED},
+                   {depth, SAMPLED},
+                   {normal, SAMPLED},
+                   {aoImages.blurTemp, COLOR}},
+                  [this, &camera](VkCommandBuffer commandBuffer) {
+                    beginBlurPass(commandBuffer, BlurDirection::Horizontal);
+                    renderBlur(commandBuffer, BlurDirection::Horizontal,
+                               camera);
+                    endBlurPass(commandBuffer);
+                  });
+    graph.addPass("ssao blur vertical",
+                  {{aoImages.blurTemp, SAMPLED},
+                   {depth, SAMPLED},
+                   {normal, SAMPLED},
+                   {blurTarget, COLOR}},
+                  [this, &camera](VkCommandBuffer commandBuffer) {
+                    beginBlurPass(commandBuffer, BlurDirection::Vertical);
+                    renderBlur(commandBuffer, BlurDirection::Vertical,
+                               camera);
+                    endBlurPass(commandBuffer);
+                  });
+  }
+
+  if (reduced) {
+    graph.addPass("ssao upsample",
+                  {{aoImages.blurLow, SAMPLED},
+                   {aoImages.lowDepth, SAMPLED},
+                   {aoImages.lowNormal, SAMPLED},
+                   {gbufferImages.depth, SAMPLED},
+                   {gbufferImages.normal, SAMPLED},
+                   {aoImages.blurred, COLOR}},
+                  [this, &camera](VkCommandBuffer commandBuffer) {
+                    beginUpsamplePass(commandBuffer);
+                    renderUpsample(commandBuffer, camera);
+                    endUpsamplePass(commandBuffer);
+                  });
+  }
+  return aoImages.blurred;
+}
+
+FrgRenderGraph::Resource
+SSAORenderSystem::addClearPass(FrgRenderGraph &graph,
+                               const FrgSSAO::GraphImages &aoImages) {
+  // The history stops tracking the scene while SSAO is off
+  ssao.setHistoryValid(false);
+  graph.addPass("ssao clear",
+                {{aoImages.blurred, FrgRenderGraph::Usage::ColorAttachment}},
+                [this](VkCommandBuffer commandBuffer) {
+                  // Empty pass: the load op clears the result to 1.0
+                  beginFullscreenPass(commandBuffer, ssao.getOutputTarget());
+                  ssao.getOutputTarget().end(frgDevice, commandBuffer);
+                });
+  return aoImages.blurred;
 }
 
 void SSAORenderSystem::renderGBuffer(VkCommandBuffer commandBuffer,
                                      std::vector<FrgGameObject> &gameObjects,
                                      const FrgCamera &camera) {
+  renderGBuffer(commandBuffer, gameObjects, 0, gameObjects.size(), camera);
+}
+
+void SSAORenderSystem::renderGBuffer(VkCommandBuffer commandBuffer,
+                                     std::vector<FrgGameObject> &gameObjects,
+                                     size_t begin, size_t end,
+                                     const FrgCamera &camera) {
   gbufferPipeline->bind(commandBuffer);
+  auto projectionView = camera.getProjectionMatrix() * camera.getViewMatrix();
 
-  for (auto &gameObject : gameObjects) {
+  for (size_t i = begin; i < end; i++) {
+    auto &gameObject = gameObjects[i];
     GBufferPushConstants push{};
-    push.modelView = camera.getViewMatrix() * gameObject.transform.mat4();
-    push.projection = camera.getProjectionMatrix();
+    auto modelMat = gameObject.transform.mat4();
+    push.transform = projectionView * modelMat;
+    push.modelView = camera.getViewMatrix() * modelMat;
     push.normalMat = glm::transpose(glm::inverse(push.modelView));
 
     vkCmdPushConstants(commandBuffer, gbufferPipelineLayout,
@@ -467,24 +1401,97 @@ void SSAORenderSystem::renderGBuffer(VkCommandBuffer commandBuffer,
   }
 }
 
-void SSAORenderSystem::renderSSAO(VkCommandBuffer commandBuffer,
-                                  const FrgCamera &camera) {
-  ssaoPipeline->bind(commandBuffer);
-
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          ssaoPipelineLayout, 0, 1, &ssaoDescriptorSet, 0,
-                          nullptr);
-
+SSAORenderSystem::SSAOPushConstants
+SSAORenderSystem::makeSSAOPushConstants(const FrgCamera &camera,
+                                        bool temporal) const {
   SSAOPushConstants push{};
   push.projection = camera.getProjectionMatrix();
-  push.noiseScale = glm::vec2(static_cast<float>(ssao.getExtent().width) /
+  // Noise tiles over the AO target, whatever resolution it runs at
+  push.noiseScale = glm::vec2(static_cast<float>(ssao.getAOExtent().width) /
                                   static_cast<float>(FrgSSAO::NOISE_SIZE),
-                              static_cast<float>(ssao.getExtent().height) /
+                              static_cast<float>(ssao.getAOExtent().height) /
                                   static_cast<float>(FrgSSAO::NOISE_SIZE));
   push.radius = FrgSSAO::RADIUS;
   push.bias = FrgSSAO::BIAS;
-  push.kernelSize = FrgSSAO::KERNEL_SIZE;
+  int stride = FrgSSAO::KERNEL_SIZE / kernelSize;
+  if (temporal) {
+    // One interleaved slice per frame; the history supplies the rest
+    push.kernelSize = kernelSize / FrgSSAO::TEMPORAL_SLICES;
+    push.sampleOffset =
+        static_cast<int>(temporalFrame % FrgSSAO::TEMPORAL_SLICES) * stride;
+    push.sampleStride = FrgSSAO::TEMPORAL_SLICES * stride;
+  } else {
+    push.kernelSize = kernelSize;
+    push.sampleOffset = 0;
+    push.sampleStride = stride;
+  }
+  push.adaptive = adaptiveSampling ? 1 : 0;
+  return push;
+}
 
+SSAORenderSystem::HBAOPushConstants
+SSAORenderSystem::makeHBAOPushConstants(const FrgCamera &camera,
+                                        bool temporal) const {
+  HBAOPushConstants push{};
+  push.projectionInfo = makeProjectionInfo(camera);
+  push.noiseScale = glm::vec2(static_cast<float>(ssao.getAOExtent().width) /
+                                  static_cast<float>(FrgSSAO::NOISE_SIZE),
+                              static_cast<float>(ssao.getAOExtent().height) /
+                                  static_cast<float>(FrgSSAO::NOISE_SIZE));
+  push.radius = FrgSSAO::RADIUS;
+  push.angleBias = FrgSSAO::HBAO_ANGLE_BIAS;
+  push.steps = FrgSSAO::HBAO_STEPS * kernelSize / FrgSSAO::KERNEL_SIZE;
+  if (temporal) {
+    // One direction per frame, rotated so TEMPORAL_SLICES frames cover the
+    // circle; the history supplies the rest
+    int slice = static_cast<int>(temporalFrame % FrgSSAO::TEMPORAL_SLICES);
+    push.directions = 1;
+    push.rotation = glm::two_pi<float>() * static_cast<float>(slice) /
+                    static_cast<float>(FrgSSAO::TEMPORAL_SLICES);
+  } else {
+    push.directions = FrgSSAO::HBAO_DIRECTIONS;
+    push.rotation = 0.f;
+  }
+  return push;
+}
+
+void SSAORenderSystem::setAOMethod(AOMethod method) {
+  if (method != aoMethod) {
+    aoMethod = method;
+    ssao.setHistoryValid(false);
+  }
+}
+
+void SSAORenderSystem::renderSSAO(VkCommandBuffer commandBuffer,
+                                  const FrgCamera &camera) {
+  if (aoMethod == AOMethod::Horizon) {
+    hbaoPipeline->bind(commandBuffer);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            hbaoPipelineLayout, 0, 1, &ssaoDescriptorSet, 0,
+                            nullptr);
+
+    HBAOPushConstants push = makeHBAOPushConstants(camera, temporalEnabled);
+    vkCmdPushConstants(commandBuffer, hbaoPipelineLayout,
+                       VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                       sizeof(HBAOPushConstants), &push);
+
+    // Draw fullscreen triangle (3 vertices, no vertex buffer)
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    return;
+  }
+
+  // The deinterleaved variant shares the layout and push constants
+  bool layered = usesDeinterleaving();
+  (layered ? deinterleavedSSAOPipeline : ssaoPipeline)->bind(commandBuffer);
+
+  VkDescriptorSet descriptorSet =
+      layered ? ssaoDeinterleavedDescriptorSet : ssaoDescriptorSet;
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          ssaoPipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+
+  SSAOPushConstants push = makeSSAOPushConstants(camera, temporalEnabled);
   vkCmdPushConstants(commandBuffer, ssaoPipelineLayout,
                      VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SSAOPushConstants),
                      &push);
@@ -493,15 +1500,287 @@ void SSAORenderSystem::renderSSAO(VkCommandBuffer commandBuffer,
   vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
 
-void SSAORenderSystem::renderBlur(VkCommandBuffer commandBuffer) {
+void SSAORenderSystem::renderDeinterleave(VkCommandBuffer commandBuffer) {
+  deinterleavePipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          deinterleavePipelineLayout, 0, 1,
+                          &deinterleaveDescriptorSet, 0, nullptr);
+
+  VkExtent2D tile = ssao.getDeinterleavedTileExtent();
+  DeinterleavePushConstants push{};
+  push.tileSize = {static_cast<int>(tile.width),
+                   static_cast<int>(tile.height)};
+  vkCmdPushConstants(commandBuffer, deinterleavePipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(DeinterleavePushConstants), &push);
+
+  // Draw fullscreen triangle
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void SSAORenderSystem::renderReinterleave(VkCommandBuffer commandBuffer) {
+  reinterleavePipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          deinterleavePipelineLayout, 0, 1,
+                          &reinterleaveDescriptorSet, 0, nullptr);
+
+  VkExtent2D tile = ssao.getDeinterleavedTileExtent();
+  DeinterleavePushConstants push{};
+  push.tileSize = {static_cast<int>(tile.width),
+                   static_cast<int>(tile.height)};
+  vkCmdPushConstants(commandBuffer, deinterleavePipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(DeinterleavePushConstants), &push);
+
+  // Draw fullscreen triangle
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void SSAORenderSystem::renderImportance(VkCommandBuffer commandBuffer,
+                                        uint32_t frameIndex,
+                                        const FrgCamera &camera) {
+  // Reset this frame's totals. The images are ordered by the render graph,
+  // only the stats buffer is synchronized here.
+  vkCmdFillBuffer(commandBuffer, sampleStatsBuffers[frameIndex], 0,
+                  sizeof(SampleStats), 0);
+
+  VkMemoryBarrier inputBarrier{};
+  inputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  inputBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  inputBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &inputBarrier, 0, nullptr, 0, nullptr);
+
+  importancePipeline->bindCompute(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          importancePipelineLayout, 0, 1,
+                          &importanceDescriptorSets[frameIndex], 0, nullptr);
+
+  // Same per-frame budget as the SSAO pass (a temporal slice if enabled)
+  SSAOPushConstants ssaoPush = makeSSAOPushConstants(camera, temporalEnabled);
+  ImportancePushConstants push{};
+  push.projectionInfo = makeProjectionInfo(camera);
+  push.radius = FrgSSAO::RADIUS;
+  push.kernelSize = ssaoPush.kernelSize;
+  push.minSamples =
+      std::max(FrgSSAO::ADAPTIVE_MIN_SAMPLES * ssaoPush.kernelSize /
+                   FrgSSAO::KERNEL_SIZE,
+               1);
+  vkCmdPushConstants(commandBuffer, importancePipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(ImportancePushConstants), &push);
+
+  VkExtent2D extent = ssao.getImportanceExtent();
+  vkCmdDispatch(commandBuffer,
+                (extent.width + IMPORTANCE_GROUP_SIZE - 1) /
+                    IMPORTANCE_GROUP_SIZE,
+                (extent.height + IMPORTANCE_GROUP_SIZE - 1) /
+                    IMPORTANCE_GROUP_SIZE,
+                1);
+
+  // Stats -> host reads once the frame has retired
+  VkMemoryBarrier outputBarrier{};
+  outputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  outputBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  outputBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &outputBarrier, 0,
+                       nullptr, 0, nullptr);
+
+  sampleStatsPending[frameIndex] = true;
+}
+
+bool SSAORenderSystem::resolveSampleStats(uint32_t frameIndex,
+                                          double &averageSamples) {
+  if (!sampleStatsPending[frameIndex]) {
+    return false;
+  }
+  sampleStatsPending[frameIndex] = false;
+
+  SampleStats stats{};
+  std::memcpy(&stats, sampleStatsMapped[frameIndex], sizeof(SampleStats));
+  averageSamples = stats.pixels > 0 ? static_cast<double>(stats.samples) /
+                                          static_cast<double>(stats.pixels)
+                                    : 0.0;
+  return true;
+}
+
+void SSAORenderSystem::setTemporalEnabled(bool enabled) {
+  if (enabled != temporalEnabled) {
+    temporalEnabled = enabled;
+    ssao.setHistoryValid(false);
+  }
+}
+
+void SSAORenderSystem::renderTemporal(VkCommandBuffer commandBuffer,
+                                      const FrgCamera &camera) {
+  temporalPipeline->bind(commandBuffer);
+
+  uint32_t index = ssao.getHistoryIndex();
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          temporalPipelineLayout, 0, 1,
+                          &temporalDescriptorSets[index], 0, nullptr);
+
+  TemporalPushConstants push{};
+  push.reprojection =
+      prevViewProjection * glm::inverse(camera.getViewMatrix());
+  push.projectionInfo = makeProjectionInfo(camera);
+  push.blend = FrgSSAO::TEMPORAL_BLEND;
+  push.depthTolerance = FrgSSAO::TEMPORAL_DEPTH_TOLERANCE;
+  push.historyValid = ssao.isHistoryValid() ? 1 : 0;
+  vkCmdPushConstants(commandBuffer, temporalPipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(TemporalPushConstants), &push);
+
+  // Draw fullscreen triangle
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+  prevViewProjection = camera.getProjectionMatrix() * camera.getViewMatrix();
+  ssao.setHistoryValid(true);
+  temporalFrame++;
+}
+
+void SSAORenderSystem::setBlurRadius(int radius) {
+  blurRadius = std::clamp(radius, 1, FrgSSAO::MAX_BLUR_RADIUS);
+}
+
+void SSAORenderSystem::setKernelSize(int size) {
+  // Round down to a power of two so the stride divides the kernel evenly
+  int clamped =
+      std::clamp(size, FrgSSAO::MIN_KERNEL_SIZE, FrgSSAO::KERNEL_SIZE);
+  kernelSize = FrgSSAO::MIN_KERNEL_SIZE;
+  while (kernelSize * 2 <= clamped) {
+    kernelSize *= 2;
+  }
+}
+
+glm::vec4 SSAORenderSystem::makeProjectionInfo(const FrgCamera &camera) {
+  const glm::mat4 &projection = camera.getProjectionMatrix();
+  return {projection[0][0], projection[1][1], projection[2][2],
+          projection[3][2]};
+}
+
+SSAORenderSystem::BlurPushConstants
+SSAORenderSystem::makeBlurPushConstants(BlurDirection direction,
+                                        const FrgCamera &camera) const {
+  BlurPushConstants push{};
+  push.projectionInfo = makeProjectionInfo(camera);
+  push.direction = direction == BlurDirection::Horizontal ? glm::vec2{1.f, 0.f}
+                                                          : glm::vec2{0.f, 1.f};
+  push.radius = blurRadius;
+  push.depthSigma = FrgSSAO::BLUR_DEPTH_SIGMA;
+  return push;
+}
+
+void SSAORenderSystem::renderBlur(VkCommandBuffer commandBuffer,
+                                  BlurDirection direction,
+                                  const FrgCamera &camera) {
   blurPipeline->bind(commandBuffer);
 
+  VkDescriptorSet descriptorSet = blurVerticalDescriptorSet;
+  if (direction == BlurDirection::Horizontal) {
+    // Temporal mode blurs the accumulated history, not the partial SSAO
+    descriptorSet = temporalEnabled
+                        ? blurTemporalDescriptorSets[ssao.getHistoryIndex()]
+                        : blurHorizontalDescriptorSet;
+  }
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          blurPipelineLayout, 0, 1, &blurDescriptorSet, 0,
+                          blurPipelineLayout, 0, 1, &descriptorSet, 0,
                           nullptr);
 
+  BlurPushConstants push = makeBlurPushConstants(direction, camera);
+  vkCmdPushConstants(commandBuffer, blurPipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BlurPushConstants),
+                     &push);
+
+  // Draw fullscreen triangle
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void SSAORenderSystem::renderDownsample(VkCommandBuffer commandBuffer) {
+  downsamplePipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          downsamplePipelineLayout, 0, 1,
+                          &downsampleDescriptorSet, 0, nullptr);
+
+  DownsamplePushConstants push{};
+  push.factor = static_cast<int>(ssao.getResolutionDivisor());
+
+  vkCmdPushConstants(commandBuffer, downsamplePipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(DownsamplePushConstants), &push);
+
+  // Draw fullscreen triangle
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void SSAORenderSystem::renderUpsample(VkCommandBuffer commandBuffer,
+                                      const FrgCamera &camera) {
+  upsamplePipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          upsamplePipelineLayout, 0, 1, &upsampleDescriptorSet,
+                          0, nullptr);
+
+  UpsamplePushConstants push{};
+  push.projectionInfo = makeProjectionInfo(camera);
+  vkCmdPushConstants(commandBuffer, upsamplePipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(UpsamplePushConstants), &push);
+
   // Draw fullscreen triangle
   vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
 
+void SSAORenderSystem::renderSSAOCompute(VkCommandBuffer commandBuffer,
+                                         const FrgCamera &camera) {
+  assert(ssaoComputePipeline && "Compute SSAO is not supported!");
+
+  // The compute path does not maintain the temporal history
+  ssao.setHistoryValid(false);
+
+  VkExtent2D aoExtent = ssao.getAOExtent();
+  ssaoComputePipeline->bindCompute(commandBuffer);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          ssaoComputePipelineLayout, 0, 1,
+                          &ssaoComputeDescriptorSet, 0, nullptr);
+
+  SSAOPushConstants push = makeSSAOPushConstants(camera, false);
+  vkCmdPushConstants(commandBuffer, ssaoComputePipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SSAOPushConstants),
+                     &push);
+  vkCmdDispatch(commandBuffer,
+                (aoExtent.width + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE,
+                (aoExtent.height + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE,
+                1);
+}
+
+void SSAORenderSystem::renderBlurCompute(VkCommandBuffer commandBuffer,
+                                         const FrgCamera &camera) {
+  assert(blurComputePipeline && "Compute SSAO is not supported!");
+
+  VkExtent2D aoExtent = ssao.getAOExtent();
+  blurComputePipeline->bindCompute(commandBuffer);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          blurComputePipelineLayout, 0, 1,
+                          &blurComputeDescriptorSet, 0, nullptr);
+
+  // Both directions run in one dispatch from shared memory
+  BlurPushConstants push =
+      makeBlurPushConstants(BlurDirection::Horizontal, camera);
+  vkCmdPushConstants(commandBuffer, blurComputePipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BlurPushConstants),
+                     &push);
+  vkCmdDispatch(commandBuffer,
+                (aoExtent.width + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE,
+                (aoExtent.height + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE,
+                1);
+}
+
 } // namespace frg
@@ -5,6 +5,7 @@
 #include "frg_game_object.hpp"
 #include "frg_gbuffer.hpp"
 #include "frg_pipeline.hpp"
+#include "frg_render_graph.hpp"
 #include "frg_ssao.hpp"
 
 // libs
@@ -13,7 +14,9 @@
 #include <glm/glm.hpp>
 
 // std
+#include <array>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace frg {
@@ -22,16 +25,51 @@ namespace frg {
  * SSAO Render System
  *
  * Manages all SSAO-related rendering:
- * - G-Buffer pass (geometry to position/normal textures)
+ * - G-Buffer pass (geometry to depth/packed normal textures)
  * - SSAO pass (calculate ambient occlusion)
- * - Blur pass (smooth SSAO output)
+ * - Blur passes (separable depth/normal-aware blur of the SSAO output)
+ *
+ * At reduced AO resolution two extra passes wrap SSAO and blur:
+ * - Downsample pass (G-buffer to low-res depth/normal)
+ * - Upsample pass (depth/normal-aware bilateral upsample to full res)
+ *
+ * SSAO and blur also have a compute implementation (renderSSAOCompute,
+ * renderBlurCompute) that caches each tile's depth in shared memory; it
+ * replaces the SSAO and blur render passes and is only available when
+ * FrgSSAO::supportsCompute().
+ *
+ * addPasses declares the passes the current settings need to a
+ * FrgRenderGraph, which orders them and does every image transition; the
+ * begin/end and render functions only record the pass contents.
+ *
+ * The AO pass itself has two interchangeable methods (see AOMethod): the
+ * hemisphere kernel (ssao.frag, also available as compute) and horizon-based
+ * AO (hbao.frag, fragment only). Both read the same inputs and write the
+ * same target, so the rest of the chain does not care which one ran.
+ *
+ * Deinterleaved mode (fragment hemisphere only) wraps the SSAO pass in a
+ * deinterleave pass (depth -> per-noise-texel layers) and a reinterleave
+ * pass (layered AO -> SSAO target); see FrgSSAO.
+ *
+ * Adaptive sampling (fragment hemisphere) runs a compute importance pass
+ * before SSAO that picks a sample count per block of pixels and counts the
+ * samples spent; resolveSampleStats() reads the average back.
+ *
+ * Temporal mode (fragment path only) evaluates one slice of the kernel per
+ * frame and inserts a temporal pass between SSAO and blur that accumulates
+ * it into FrgSSAO's reprojected history; the blur then reads the history.
+ *
+ * Passes that need view-space depth reconstruct it from the hardware depth
+ * with the camera projection (see makeProjectionInfo).
  */
 class SSAORenderSystem {
 public:
   // Push constants for G-buffer pass
+  // transform is computed exactly like SimplePushConstantData::transform so the
+  // final pass can depth-test EQUAL against the depth written here
   struct GBufferPushConstants {
+    glm::mat4 transform;
     glm::mat4 modelView;
-    glm::mat4 projection;
     glm::mat4 normalMat;
   };
 
@@ -41,7 +79,65 @@ public:
     glm::vec2 noiseScale;
     float radius;
     float bias;
-    int kernelSize;
+    int kernelSize;   // samples evaluated this frame
+    int sampleOffset; // first kernel index
+    int sampleStride; // kernel index step
+    int adaptive;     // per-pixel sample count from the importance map
+  };
+
+  // Push constants for the adaptive sampling importance pass
+  struct ImportancePushConstants {
+    glm::vec4 projectionInfo;
+    float radius;
+    int kernelSize; // samples for a fully detailed block
+    int minSamples; // samples for a flat block
+  };
+
+  // Push constants for the horizon-based AO pass
+  struct HBAOPushConstants {
+    glm::vec4 projectionInfo;
+    glm::vec2 noiseScale;
+    float radius;
+    float angleBias;
+    int directions;
+    int steps; // samples per direction
+    float rotation; // direction offset in radians (temporal slices)
+  };
+
+  enum class AOMethod { Hemisphere, Horizon };
+
+  // Push constants for the deinterleave/reinterleave passes
+  struct DeinterleavePushConstants {
+    glm::ivec2 tileSize;
+  };
+
+  // Push constants for the temporal accumulation pass
+  struct TemporalPushConstants {
+    glm::mat4 reprojection; // current view -> previous clip space
+    glm::vec4 projectionInfo;
+    float blend;
+    float depthTolerance;
+    int historyValid;
+  };
+
+  // Push constants for the bilateral blur passes
+  struct BlurPushConstants {
+    glm::vec4 projectionInfo;
+    glm::vec2 direction; // (1, 0) or (0, 1); ignored by the compute blur
+    int radius;
+    float depthSigma;
+  };
+
+  enum class BlurDirection { Horizontal, Vertical };
+
+  // Push constants for the G-buffer downsample pass
+  struct DownsamplePushConstants {
+    int factor;
+  };
+
+  // Push constants for the bilateral upsample pass
+  struct UpsamplePushConstants {
+    glm::vec4 projectionInfo;
   };
 
   SSAORenderSystem(FrgDevice &device, FrgGBuffer &gbuffer, FrgSSAO &ssao);
@@ -54,31 +150,168 @@ public:
   void renderGBuffer(VkCommandBuffer commandBuffer,
                      std::vector<FrgGameObject> &gameObjects,
                      const FrgCamera &camera);
+  // Records gameObjects [begin, end); safe to call from several threads
+  void renderGBuffer(VkCommandBuffer commandBuffer,
+                     std::vector<FrgGameObject> &gameObjects, size_t begin,
+                     size_t end, const FrgCamera &camera);
 
+  // Runs the selected AO method inside the SSAO pass
   void renderSSAO(VkCommandBuffer commandBuffer, const FrgCamera &camera);
 
-  void renderBlur(VkCommandBuffer commandBuffer);
+  // The compute path always uses the hemisphere kernel
+  void setAOMethod(AOMethod method);
+  AOMethod getAOMethod() const { return aoMethod; }
+
+  void renderBlur(VkCommandBuffer commandBuffer, BlurDirection direction,
+                  const FrgCamera &camera);
+
+  // Taps per blur pass are 2 * radius + 1
+  void setBlurRadius(int radius);
+  int getBlurRadius() const { return blurRadius; }
+
+  // Samples per pixel, a power of two in [MIN_KERNEL_SIZE, KERNEL_SIZE].
+  // A smaller kernel takes every n-th sample so it still spans the
+  // hemisphere; horizon-based AO shortens its steps by the same factor.
+  void setKernelSize(int size);
+  int getKernelSize() const { return kernelSize; }
+
+  // Deinterleaved SSAO. Only the fragment hemisphere method uses it, see
+  // usesDeinterleaving().
+  void setDeinterleaved(bool enabled) { deinterleaved = enabled; }
+  bool isDeinterleaved() const { return deinterleaved; }
+  bool usesDeinterleaving() const {
+    return deinterleaved && aoMethod == AOMethod::Hemisphere;
+  }
+  // Call before / after the SSAO pass when usesDeinterleaving()
+  void renderDeinterleave(VkCommandBuffer commandBuffer);
+  void renderReinterleave(VkCommandBuffer commandBuffer);
+
+  // Adaptive sample count (fragment hemisphere). renderImportance runs
+  // outside any render pass, after the downsample pass and before SSAO.
+  void setAdaptiveSampling(bool enabled) { adaptiveSampling = enabled; }
+  bool isAdaptiveSampling() const { return adaptiveSampling; }
+  bool usesAdaptiveSampling() const {
+    return adaptiveSampling && aoMethod == AOMethod::Hemisphere;
+  }
+  void renderImportance(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                        const FrgCamera &camera);
+  // Average kernel samples per covered AO pixel from this slot's last
+  // importance pass. Call after the slot was retired; returns
+  // false if the slot has no result.
+  bool resolveSampleStats(uint32_t frameIndex, double &averageSamples);
+
+  // Temporal accumulation (fragment path). Enabling or disabling it drops
+  // the history.
+  void setTemporalEnabled(bool enabled);
+  bool isTemporalEnabled() const { return temporalEnabled; }
+  // Call between beginTemporalPass/endTemporalPass, after the SSAO pass
+  void renderTemporal(VkCommandBuffer commandBuffer, const FrgCamera &camera);
+
+  // Only used when ssao.isReducedResolution()
+  void renderDownsample(VkCommandBuffer commandBuffer);
+  void renderUpsample(VkCommandBuffer commandBuffer, const FrgCamera &camera);
+
+  // Whether every pipeline the given path needs with the current settings
+  // has finished building in the background
+  bool isReady(AOMethod method, bool compute) const;
+
+  // Compute replacements for the SSAO and blur passes (outside any render
+  // pass); the blur writes the low-res target at reduced resolution
+  void renderSSAOCompute(VkCommandBuffer commandBuffer,
+                         const FrgCamera &camera);
+  void renderBlurCompute(VkCommandBuffer commandBuffer,
+                         const FrgCamera &camera);
+
+  // Declares this frame's SSAO passes (downsample through upsample) for the
+  // current settings and returns the full-res result. The passes record
+  // later, in FrgRenderGraph::execute, so camera has to outlive it. Swaps
+  // the temporal history, so call once per frame.
+  FrgRenderGraph::Resource
+  addPasses(FrgRenderGraph &graph,
+            const FrgGBuffer::GraphImages &gbufferImages,
+            const FrgSSAO::GraphImages &aoImages, const FrgCamera &camera,
+            uint32_t frameIndex, bool compute);
+  // SSAO disabled: clears the full-res result to "no occlusion" for the
+  // passes that still read it (culled otherwise)
+  FrgRenderGraph::Resource addClearPass(FrgRenderGraph &graph,
+                                        const FrgSSAO::GraphImages &aoImages);
+
+  // Point the passes at the current targets after FrgSSAO::setResolutionDivisor
+  // or a resize. Sets in use by frames in flight cannot be rewritten, so fresh
+  // ones are written and the old ones released once those frames finished.
+  void updateDescriptorSets();
 
   // Begin/end render passes
-  void beginGBufferPass(VkCommandBuffer commandBuffer);
+  // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the draws come from
+  // secondaries, which set their own viewport and scissor
+  void beginGBufferPass(
+      VkCommandBuffer commandBuffer,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void endGBufferPass(VkCommandBuffer commandBuffer);
 
+  // Targets the AO atlas when usesDeinterleaving()
   void beginSSAOPass(VkCommandBuffer commandBuffer);
   void endSSAOPass(VkCommandBuffer commandBuffer);
 
-  void beginBlurPass(VkCommandBuffer commandBuffer);
+  void beginDeinterleavePass(VkCommandBuffer commandBuffer);
+  void endDeinterleavePass(VkCommandBuffer commandBuffer);
+
+  void beginReinterleavePass(VkCommandBuffer commandBuffer);
+  void endReinterleavePass(VkCommandBuffer commandBuffer);
+
+  void beginBlurPass(VkCommandBuffer commandBuffer, BlurDirection direction);
   void endBlurPass(VkCommandBuffer commandBuffer);
 
+  // Writes the history addPasses selected
+  void beginTemporalPass(VkCommandBuffer commandBuffer);
+  void endTemporalPass(VkCommandBuffer commandBuffer);
+
+  void beginDownsamplePass(VkCommandBuffer commandBuffer);
+  void endDownsamplePass(VkCommandBuffer commandBuffer);
+
+  void beginUpsamplePass(VkCommandBuffer commandBuffer);
+  void endUpsamplePass(VkCommandBuffer commandBuffer);
+
 private:
   void createDescriptorSetLayouts();
-  void createDescriptorPool();
+  void createSampleStatsBuffers();
   void createDescriptorSets();
+  void writeDescriptorSets();
+  void retireDescriptorSets();
+  // Every persistent set except the importance sets, with its layout
+  std::array<std::pair<VkDescriptorSetLayout, VkDescriptorSet *>, 14>
+  descriptorSetSlots();
   void createGBufferPipelineLayout();
   void createGBufferPipeline();
   void createSSAOPipelineLayout();
   void createSSAOPipeline();
+  void createHBAOPipelineLayout();
+  void createHBAOPipeline();
   void createBlurPipelineLayout();
   void createBlurPipeline();
+  void createDownsamplePipelineLayout();
+  void createDownsamplePipeline();
+  void createUpsamplePipelineLayout();
+  void createUpsamplePipeline();
+  void createDeinterleavePipelineLayout();
+  void createDeinterleavePipelines();
+  void createTemporalPipelineLayout();
+  void createTemporalPipeline();
+  void createImportancePipelineLayout();
+  void createImportancePipeline();
+  void createComputePipelineLayouts();
+  void createComputePipelines();
+  // temporal: evaluate this frame's kernel slice instead of the full kernel
+  SSAOPushConstants makeSSAOPushConstants(const FrgCamera &camera,
+                                          bool temporal) const;
+  HBAOPushConstants makeHBAOPushConstants(const FrgCamera &camera,
+                                          bool temporal) const;
+  BlurPushConstants makeBlurPushConstants(BlurDirection direction,
+                                          const FrgCamera &camera) const;
+  // (P[0][0], P[1][1], P[2][2], P[3][2]) for gbuffer_common.glsl
+  static glm::vec4 makeProjectionInfo(const FrgCamera &camera);
+  void beginFullscreenPass(VkCommandBuffer commandBuffer,
+                           const FrgRenderTarget &target);
 
   FrgDevice &frgDevice;
   FrgGBuffer &gbuffer;
@@ -87,9 +320,30 @@ private:
   // Descriptor management
   VkDescriptorSetLayout ssaoDescriptorSetLayout = VK_NULL_HANDLE;
   VkDescriptorSetLayout blurDescriptorSetLayout = VK_NULL_HANDLE;
-  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  VkDescriptorSetLayout downsampleDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSetLayout upsampleDescriptorSetLayout = VK_NULL_HANDLE;
   VkDescriptorSet ssaoDescriptorSet = VK_NULL_HANDLE;
-  VkDescriptorSet blurDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet blurHorizontalDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet blurVerticalDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet downsampleDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet upsampleDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSetLayout ssaoComputeDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSetLayout blurComputeDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSet ssaoComputeDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet blurComputeDescriptorSet = VK_NULL_HANDLE;
+  // Deinterleave (depth in) and reinterleave (AO atlas in) share a layout;
+  // the deinterleaved SSAO set uses the SSAO layout with the depth atlas
+  VkDescriptorSetLayout deinterleaveDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSet deinterleaveDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet reinterleaveDescriptorSet = VK_NULL_HANDLE;
+  VkDescriptorSet ssaoDeinterleavedDescriptorSet = VK_NULL_HANDLE;
+  // Importance pass, one set per frame in flight (own stats buffer)
+  VkDescriptorSetLayout importanceDescriptorSetLayout = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> importanceDescriptorSets;
+  // Indexed by the history being written this frame
+  VkDescriptorSetLayout temporalDescriptorSetLayout = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, 2> temporalDescriptorSets{};
+  std::array<VkDescriptorSet, 2> blurTemporalDescriptorSets{};
 
   // G-buffer pipeline
   VkPipelineLayout gbufferPipelineLayout = VK_NULL_HANDLE;
@@ -99,9 +353,67 @@ private:
   VkPipelineLayout ssaoPipelineLayout = VK_NULL_HANDLE;
   std::unique_ptr<FrgPipeline> ssaoPipeline;
 
+  // Horizon-based AO pipeline (same descriptor set as SSAO)
+  VkPipelineLayout hbaoPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> hbaoPipeline;
+
   // Blur pipeline
   VkPipelineLayout blurPipelineLayout = VK_NULL_HANDLE;
   std::unique_ptr<FrgPipeline> blurPipeline;
+
+  // Downsample pipeline (G-buffer -> low-res depth/normal)
+  VkPipelineLayout downsamplePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> downsamplePipeline;
+
+  // Bilateral upsample pipeline (low-res AO -> full-res AO)
+  VkPipelineLayout upsamplePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> upsamplePipeline;
+
+  // Deinterleaved SSAO pipelines (deinterleaved SSAO uses the SSAO layout)
+  VkPipelineLayout deinterleavePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> deinterleavePipeline;
+  std::unique_ptr<FrgPipeline> deinterleavedSSAOPipeline;
+  std::unique_ptr<FrgPipeline> reinterleavePipeline;
+
+  // Adaptive sampling importance pipeline (compute)
+  VkPipelineLayout importancePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> importancePipeline;
+
+  // Sample statistics written by the importance pass, per frame in flight
+  struct SampleStats {
+    uint32_t samples;
+    uint32_t pixels;
+  };
+  std::vector<VkBuffer> sampleStatsBuffers;
+  std::vector<VkDeviceMemory> sampleStatsMemory;
+  std::vector<void *> sampleStatsMapped;
+  std::vector<bool> sampleStatsPending;
+
+  // Temporal accumulation pipeline (SSAO + previous history -> history)
+  VkPipelineLayout temporalPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> temporalPipeline;
+
+  // Compute SSAO + blur pipelines (null when unsupported)
+  VkPipelineLayout ssaoComputePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> ssaoComputePipeline;
+  VkPipelineLayout blurComputePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> blurComputePipeline;
+
+  int blurRadius = FrgSSAO::DEFAULT_BLUR_RADIUS;
+  int kernelSize = FrgSSAO::KERNEL_SIZE;
+
+  AOMethod aoMethod = AOMethod::Hemisphere;
+  bool deinterleaved = false;
+  bool adaptiveSampling = false;
+
+  bool temporalEnabled = false;
+  uint32_t temporalFrame = 0; // selects the kernel slice
+  glm::mat4 prevViewProjection{1.f};
+
+  // Must match local_size in ssao.comp / ssao_blur.comp
+  static constexpr uint32_t COMPUTE_TILE_SIZE = 16;
+  // Must match local_size in ssao_importance.comp (blocks per axis)
+  static constexpr uint32_t IMPORTANCE_GROUP_SIZE = 8;
 };
 
 } // namespace frg
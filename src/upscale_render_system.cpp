@@ -0,0 +1,678 @@
+#include "upscale_render_system.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace frg {
+
+namespace {
+
+// Radical inverse in the given base, index starting at 1
+float halton(uint32_t index, uint32_t base) {
+  float result = 0.0f;
+  float fraction = 1.0f / static_cast<float>(base);
+  while (index > 0) {
+    result += static_cast<float>(index % base) * fraction;
+    index /= base;
+    fraction /= static_cast<float>(base);
+  }
+  return result;
+}
+
+} // namespace
+
+UpscaleRenderSystem::UpscaleRenderSystem(FrgDevice &device,
+                                         FrgGBuffer &gbuffer,
+                                         VkExtent2D outputExtent,
+                                         VkFormat colorFormat,
+                                         VkRenderPass swapChainRenderPass)
+    : frgDevice{device}, gbuffer{gbuffer}, outputExtent{outputExtent},
+      colorFormat{colorFormat} {
+  createSceneTarget();
+  createHistoryImages();
+  createSampler();
+  createSceneRenderPass();
+  createResolveRenderPass();
+  createFramebuffers();
+  createDescriptorSetLayouts();
+  createDescriptorSets();
+  createPipelineLayouts();
+  createPipelines(swapChainRenderPass);
+}
+
+UpscaleRenderSystem::~UpscaleRenderSystem() {
+  // Background builds may still reference the layouts destroyed below
+  frgDevice.pipelineCompiler().waitIdle();
+  VkDevice dev = frgDevice.device();
+
+  if (presentPipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, presentPipelineLayout, nullptr);
+  }
+  if (resolvePipelineLayout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(dev, resolvePipelineLayout, nullptr);
+  }
+  if (presentDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, presentDescriptorSetLayout, nullptr);
+  }
+  if (resolveDescriptorSetLayout != VK_NULL_HANDLE) {
+    vkDestroyDescriptorSetLayout(dev, resolveDescriptorSetLayout, nullptr);
+  }
+
+  for (VkFramebuffer framebuffer : historyFramebuffers) {
+    if (framebuffer != VK_NULL_HANDLE) {
+      vkDestroyFramebuffer(dev, framebuffer, nullptr);
+    }
+  }
+  if (sceneFramebuffer != VK_NULL_HANDLE) {
+    vkDestroyFramebuffer(dev, sceneFramebuffer, nullptr);
+  }
+  if (resolveRenderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(dev, resolveRenderPass, nullptr);
+  }
+  if (sceneRenderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(dev, sceneRenderPass, nullptr);
+  }
+  if (sampler != VK_NULL_HANDLE) {
+    vkDestroySampler(dev, sampler, nullptr);
+  }
+
+  for (size_t i = 0; i < historyImages.size(); ++i) {
+    destroyColorTarget(historyImages[i], historyMemories[i],
+                       historyImageViews[i]);
+  }
+  destroyColorTarget(sceneImage, sceneMemory, sceneImageView);
+}
+
+VkExtent2D UpscaleRenderSystem::scaledExtent(VkExtent2D outputExtent,
+                                             float scale) {
+  scale = std::clamp(scale, MIN_SCALE, MAX_SCALE);
+  auto scaled = [scale](uint32_t size) {
+    return std::max(
+        static_cast<uint32_t>(std::lround(static_cast<float>(size) * scale)),
+        1u);
+  };
+  return {scaled(outputExtent.width), scaled(outputExtent.height)};
+}
+
+void UpscaleRenderSystem::createColorTarget(VkExtent2D size, VkFormat format,
+                                            VkImage &image,
+                                            VkDeviceMemory &memory,
+                                            VkImageView &view) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = size.width;
+  imageInfo.extent.height = size.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = format;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  frgDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                image, memory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(frgDevice.device(), &viewInfo, nullptr, &view) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create upscale target image view!");
+  }
+}
+
+void UpscaleRenderSystem::destroyColorTarget(VkImage &image,
+                                             VkDeviceMemory &memory,
+                                             VkImageView &view) {
+  VkDevice dev = frgDevice.device();
+
+  if (view != VK_NULL_HANDLE) {
+    vkDestroyImageView(dev, view, nullptr);
+    view = VK_NULL_HANDLE;
+  }
+  if (image != VK_NULL_HANDLE) {
+    vkDestroyImage(dev, image, nullptr);
+    image = VK_NULL_HANDLE;
+  }
+  if (memory != VK_NULL_HANDLE) {
+    vkFreeMemory(dev, memory, nullptr);
+    memory = VK_NULL_HANDLE;
+  }
+}
+
+void UpscaleRenderSystem::createSceneTarget() {
+  // Swap chain format keeps the scene pass compatible with the swap chain
+  // pass the scene pipelines were created for
+  createColorTarget(getRenderExtent(), colorFormat, sceneImage, sceneMemory,
+                    sceneImageView);
+}
+
+void UpscaleRenderSystem::createHistoryImages() {
+  for (size_t i = 0; i < historyImages.size(); ++i) {
+    createColorTarget(outputExtent, HISTORY_FORMAT, historyImages[i],
+                      historyMemories[i], historyImageViews[i]);
+  }
+
+  // The resolve pass always samples the previous history, even before it has
+  // been written, so both images start out shader-readable. Recorded for the
+  // next frame rather than waited on, as resizes happen mid-run.
+  for (VkImage image : historyImages) {
+    frgDevice.uploader().initializeImage(
+        image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+  }
+
+  historyIndex = 0;
+  historyValid = false;
+}
+
+void UpscaleRenderSystem::createSampler() {
+  // Bilinear: the resolve samples the scene between texels and the history
+  // at reprojected positions
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.anisotropyEnable = VK_FALSE;
+  samplerInfo.maxAnisotropy = 1.0f;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+  samplerInfo.compareEnable = VK_FALSE;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.mipLodBias = 0.0f;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = 0.0f;
+
+  if (vkCreateSampler(frgDevice.device(), &samplerInfo, nullptr, &sampler) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create upscale sampler!");
+  }
+}
+
+void UpscaleRenderSystem::createSceneRenderPass() {
+  // Must stay compatible with the swap chain render pass (same formats and
+  // sample counts); load/store ops and layouts may differ
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = colorFormat;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  // Same read-only G-buffer depth as the swap chain depth-load pass
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = gbuffer.getDepthFormat();
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+  VkAttachmentReference colorRef{};
+  colorRef.attachment = 0;
+  colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depthRef{};
+  depthRef.attachment = 1;
+  depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorRef;
+  subpass.pDepthStencilAttachment = &depthRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+
+  // Previous resolve read the scene color; G-buffer depth writes must land
+  // before the depth test and the deferred lighting reads
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].srcAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                  VK_ACCESS_SHADER_READ_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment,
+                                                        depthAttachment};
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(frgDevice.device(), &renderPassInfo, nullptr,
+                         &sceneRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create upscale scene render pass!");
+  }
+}
+
+void UpscaleRenderSystem::createResolveRenderPass() {
+  // Every texel of the history is rewritten, so the old contents are dropped
+  VkAttachmentDescription attachment{};
+  attachment.format = HISTORY_FORMAT;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkAttachmentReference colorRef{};
+  colorRef.attachment = 0;
+  colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &attachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(frgDevice.device(), &renderPassInfo, nullptr,
+                         &resolveRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create upscale resolve render pass!");
+  }
+}
+
+void UpscaleRenderSystem::createFramebuffers() {
+  auto create = [this](VkRenderPass renderPass,
+                       const std::vector<VkImageView> &views,
+                       VkExtent2D size) {
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = size.width;
+    framebufferInfo.height = size.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(frgDevice.device(), &framebufferInfo, nullptr,
+                            &framebuffer) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create upscale framebuffer!");
+    }
+    return framebuffer;
+  };
+
+  sceneFramebuffer =
+      create(sceneRenderPass, {sceneImageView, gbuffer.getDepthImageView()},
+             getRenderExtent());
+  for (size_t i = 0; i < historyFramebuffers.size(); ++i) {
+    historyFramebuffers[i] =
+        create(resolveRenderPass, {historyImageViews[i]}, outputExtent);
+  }
+}
+
+void UpscaleRenderSystem::createDescriptorSetLayouts() {
+  // Resolve descriptor set layout
+  // Binding 0: sceneColor (sampler2D, internal resolution)
+  // Binding 1: gDepth     (sampler2D, internal resolution)
+  // Binding 2: history    (sampler2D, previous output)
+  // Present uses binding 0 only (the history just written)
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                  &resolveDescriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create upscale resolve descriptor set layout!");
+  }
+
+  layoutInfo.bindingCount = 1;
+  if (vkCreateDescriptorSetLayout(frgDevice.device(), &layoutInfo, nullptr,
+                                  &presentDescriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create upscale present descriptor set layout!");
+  }
+}
+
+void UpscaleRenderSystem::createDescriptorSets() {
+  std::array<VkDescriptorSetLayout, 4> layouts = {
+      resolveDescriptorSetLayout, resolveDescriptorSetLayout,
+      presentDescriptorSetLayout, presentDescriptorSetLayout};
+
+  std::array<VkDescriptorSet, 4> sets{};
+  for (size_t i = 0; i < layouts.size(); i++) {
+    sets[i] = frgDevice.descriptorAllocator().allocate(layouts[i]);
+  }
+  resolveDescriptorSets = {sets[0], sets[1]};
+  presentDescriptorSets = {sets[2], sets[3]};
+
+  VkDescriptorImageInfo sceneInfo{};
+  sceneInfo.sampler = sampler;
+  sceneInfo.imageView = sceneImageView;
+  sceneInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkDescriptorImageInfo depthInfo = gbuffer.getDepthDescriptor();
+
+  std::array<VkDescriptorImageInfo, 2> historyInfos{};
+  for (size_t i = 0; i < historyInfos.size(); ++i) {
+    historyInfos[i].sampler = sampler;
+    historyInfos[i].imageView = historyImageViews[i];
+    historyInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  }
+
+  auto imageWrite = [](VkDescriptorSet set, uint32_t binding,
+                       const VkDescriptorImageInfo *info) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = info;
+    return write;
+  };
+
+  std::vector<VkWriteDescriptorSet> writes;
+  for (size_t i = 0; i < resolveDescriptorSets.size(); ++i) {
+    writes.push_back(imageWrite(resolveDescriptorSets[i], 0, &sceneInfo));
+    writes.push_back(imageWrite(resolveDescriptorSets[i], 1, &depthInfo));
+    writes.push_back(
+        imageWrite(resolveDescriptorSets[i], 2, &historyInfos[1 - i]));
+    writes.push_back(
+        imageWrite(presentDescriptorSets[i], 0, &historyInfos[i]));
+  }
+
+  vkUpdateDescriptorSets(frgDevice.device(),
+                         static_cast<uint32_t>(writes.size()), writes.data(),
+                         0, nullptr);
+}
+
+void UpscaleRenderSystem::retireTargets() {
+  FrgDeletionQueue &queue = frgDevice.deletionQueue();
+  for (VkFramebuffer &framebuffer : historyFramebuffers) {
+    queue.retireFramebuffer(framebuffer);
+  }
+  queue.retireFramebuffer(sceneFramebuffer);
+  for (size_t i = 0; i < historyImages.size(); ++i) {
+    queue.retireImage(historyImages[i], historyMemories[i],
+                      historyImageViews[i]);
+  }
+  queue.retireImage(sceneImage, sceneMemory, sceneImageView);
+}
+
+void UpscaleRenderSystem::retireDescriptorSets() {
+  std::vector<std::pair<VkDescriptorSetLayout, VkDescriptorSet>> retired;
+  for (size_t i = 0; i < resolveDescriptorSets.size(); ++i) {
+    retired.emplace_back(resolveDescriptorSetLayout, resolveDescriptorSets[i]);
+    retired.emplace_back(presentDescriptorSetLayout, presentDescriptorSets[i]);
+  }
+
+  FrgDescriptorAllocator &allocator = frgDevice.descriptorAllocator();
+  frgDevice.deletionQueue().retire([&allocator, retired] {
+    for (auto &[layout, set] : retired) {
+      allocator.release(layout, set);
+    }
+  });
+}
+
+void UpscaleRenderSystem::resize(VkExtent2D newOutputExtent) {
+  // Render passes, sampler and pipelines do not depend on the size
+  retireDescriptorSets();
+  retireTargets();
+
+  outputExtent = newOutputExtent;
+  createSceneTarget();
+  createHistoryImages();
+  createFramebuffers();
+  createDescriptorSets();
+}
+
+void UpscaleRenderSystem::createPipelineLayouts() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ResolvePushConstants);
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &resolveDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &resolvePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create upscale resolve pipeline layout!");
+  }
+
+  layoutInfo.pSetLayouts = &presentDescriptorSetLayout;
+  layoutInfo.pushConstantRangeCount = 0;
+  layoutInfo.pPushConstantRanges = nullptr;
+
+  if (vkCreatePipelineLayout(frgDevice.device(), &layoutInfo, nullptr,
+                             &presentPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "Failed to create upscale present pipeline layout!");
+  }
+}
+
+void UpscaleRenderSystem::createPipelines(VkRenderPass swapChainRenderPass) {
+  assert(resolvePipelineLayout != nullptr &&
+         presentPipelineLayout != nullptr &&
+         "Cannot create pipelines before layouts!");
+
+  PipelineConfigInfo pipelineConfig{};
+  FrgPipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+  // Fullscreen triangle - no vertex input
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+
+  // No depth testing for fullscreen passes
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  pipelineConfig.renderPass = resolveRenderPass;
+  pipelineConfig.pipelineLayout = resolvePipelineLayout;
+  resolvePipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/upscale_resolve.frag.spv",
+      pipelineConfig);
+
+  // The swap chain pass clears its own depth; the copy ignores it
+  pipelineConfig.renderPass = swapChainRenderPass;
+  pipelineConfig.pipelineLayout = presentPipelineLayout;
+  presentPipeline = std::make_unique<FrgPipeline>(
+      frgDevice, "shaders/ssao.vert.spv", "shaders/upscale_present.frag.spv",
+      pipelineConfig);
+}
+
+void UpscaleRenderSystem::jitterCamera(FrgCamera &camera) {
+  // Halton(2, 3) in [-0.5, 0.5) pixels of the internal resolution
+  jitterIndex = (jitterIndex + 1) % JITTER_PHASES;
+  glm::vec2 offset{halton(jitterIndex + 1, 2) - 0.5f,
+                   halton(jitterIndex + 1, 3) - 0.5f};
+
+  VkExtent2D extent = getRenderExtent();
+  camera.setProjectionJitter(
+      offset * glm::vec2{2.0f / static_cast<float>(extent.width),
+                         2.0f / static_cast<float>(extent.height)});
+}
+
+void UpscaleRenderSystem::beginPass(VkCommandBuffer commandBuffer,
+                                    VkRenderPass renderPass,
+                                    VkFramebuffer framebuffer,
+                                    VkExtent2D extent,
+                                    VkSubpassContents contents) {
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.framebuffer = framebuffer;
+  renderPassInfo.renderArea.offset = {0, 0};
+  renderPassInfo.renderArea.extent = extent;
+
+  // Same background as the swap chain pass; depth is loaded
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color = {{0.1f, 0.1f, 0.1f, 1.0f}};
+  clearValues[1].depthStencil = {1.0f, 0};
+
+  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+  renderPassInfo.pClearValues = clearValues.data();
+
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  if (contents != VK_SUBPASS_CONTENTS_INLINE) {
+    return;
+  }
+
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  VkRect2D scissor{{0, 0}, extent};
+
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void UpscaleRenderSystem::beginScenePass(VkCommandBuffer commandBuffer,
+                                         VkSubpassContents contents) {
+  beginPass(commandBuffer, sceneRenderPass, sceneFramebuffer,
+            getRenderExtent(), contents);
+}
+
+void UpscaleRenderSystem::endScenePass(VkCommandBuffer commandBuffer) {
+  vkCmdEndRenderPass(commandBuffer);
+}
+
+void UpscaleRenderSystem::beginResolvePass(VkCommandBuffer commandBuffer) {
+  historyIndex = 1 - historyIndex;
+  beginPass(commandBuffer, resolveRenderPass,
+            historyFramebuffers[historyIndex], outputExtent);
+}
+
+void UpscaleRenderSystem::renderResolve(VkCommandBuffer commandBuffer,
+                                        const FrgCamera &camera) {
+  resolvePipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          resolvePipelineLayout, 0, 1,
+                          &resolveDescriptorSets[historyIndex], 0, nullptr);
+
+  // Motion is measured between unjittered cameras; the jitter only moves
+  // where the samples were taken
+  const glm::vec2 &jitter = camera.getProjectionJitter();
+  glm::mat4 projection = camera.getProjectionMatrix();
+  projection[2][0] -= jitter.x;
+  projection[2][1] -= jitter.y;
+  glm::mat4 viewProjection = projection * camera.getViewMatrix();
+
+  ResolvePushConstants push{};
+  push.reprojection = prevViewProjection * glm::inverse(camera.getViewMatrix());
+  push.projectionInfo = {projection[0][0], projection[1][1], projection[2][2],
+                         projection[3][2]};
+  push.jitter = jitter;
+  push.blend = HISTORY_BLEND;
+  push.historyValid = historyValid ? 1 : 0;
+
+  vkCmdPushConstants(commandBuffer, resolvePipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(ResolvePushConstants), &push);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+  prevViewProjection = viewProjection;
+  historyValid = true;
+}
+
+void UpscaleRenderSystem::endResolvePass(VkCommandBuffer commandBuffer) {
+  vkCmdEndRenderPass(commandBuffer);
+}
+
+void UpscaleRenderSystem::renderPresent(VkCommandBuffer commandBuffer) {
+  presentPipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          presentPipelineLayout, 0, 1,
+                          &presentDescriptorSets[historyIndex], 0, nullptr);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+} // namespace frg
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "frg_camera.hpp"
+#include "frg_device.hpp"
+#include "frg_gbuffer.hpp"
+#include "frg_pipeline.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <memory>
+
+namespace frg {
+
+/**
+ * Upscale Render System
+ *
+ * Temporal upscaling from an internal render resolution (the G-buffer extent)
+ * to the output resolution. The G-buffer, SSAO and lighting passes all run at
+ * the internal resolution, with the camera jittered by a different sub-pixel
+ * offset every frame:
+ * - Scene pass: lighting and particles into an internal-resolution color
+ *   target, testing against the G-buffer depth. The render pass is compatible
+ *   with the swap chain pass, so the forward, deferred and particle pipelines
+ *   are used unchanged.
+ * - Resolve pass: per-pixel motion from reprojecting the G-buffer depth with
+ *   the previous camera (scene geometry is static, so camera motion is all
+ *   there is), then the reprojected output-resolution history is clamped to
+ *   the current neighborhood and blended with the new samples.
+ * - Present: copies the history into the swap chain image.
+ */
+class UpscaleRenderSystem {
+public:
+  // Accumulated output, also the source of the present pass
+  static constexpr VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+  // Halton(2, 3) jitter sequence length
+  static constexpr uint32_t JITTER_PHASES = 8;
+  // Weight of the current frame; lower keeps more of the accumulated detail
+  static constexpr float HISTORY_BLEND = 0.1f;
+  // Internal resolution range relative to the output
+  static constexpr float MIN_SCALE = 0.5f;
+  static constexpr float MAX_SCALE = 1.0f;
+
+  // Push constants for the resolve pass
+  struct ResolvePushConstants {
+    glm::mat4 reprojection; // current view space -> previous clip (unjittered)
+    glm::vec4 projectionInfo;
+    glm::vec2 jitter; // NDC offset this frame's scene was rendered with
+    float blend;
+    int historyValid;
+  };
+
+  // renderExtent is the G-buffer extent, outputExtent the swap chain extent
+  UpscaleRenderSystem(FrgDevice &device, FrgGBuffer &gbuffer,
+                      VkExtent2D outputExtent, VkFormat colorFormat,
+                      VkRenderPass swapChainRenderPass);
+  ~UpscaleRenderSystem();
+
+  UpscaleRenderSystem(const UpscaleRenderSystem &) = delete;
+  UpscaleRenderSystem &operator=(const UpscaleRenderSystem &) = delete;
+
+  // Internal extent for an output extent and scale factor
+  static VkExtent2D scaledExtent(VkExtent2D outputExtent, float scale);
+
+  VkExtent2D getRenderExtent() const { return gbuffer.getExtent(); }
+  VkExtent2D getOutputExtent() const { return outputExtent; }
+
+  // Applies this frame's jitter; call after setPerspectiveProjection
+  void jitterCamera(FrgCamera &camera);
+
+  // Internal-resolution pass that replaces the swap chain pass for the scene.
+  // The G-buffer depth is loaded read-only, as in the depth-reuse swap chain
+  // pass.
+  void beginScenePass(VkCommandBuffer commandBuffer,
+                      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+  VkRenderPass getSceneRenderPass() const { return sceneRenderPass; }
+  VkFramebuffer getSceneFramebuffer() const { return sceneFramebuffer; }
+  void endScenePass(VkCommandBuffer commandBuffer);
+
+  // Output-resolution accumulation, after the scene pass
+  void beginResolvePass(VkCommandBuffer commandBuffer);
+  void renderResolve(VkCommandBuffer commandBuffer, const FrgCamera &camera);
+  void endResolvePass(VkCommandBuffer commandBuffer);
+
+  // Call inside the swap chain pass
+  void renderPresent(VkCommandBuffer commandBuffer);
+
+  // Drop the history (e.g. after a camera cut)
+  void invalidateHistory() { historyValid = false; }
+
+  // Recreates the targets after the swap chain changed size; resize the
+  // G-buffer to the new internal extent first. Frames in flight keep using
+  // the old targets until they finish.
+  void resize(VkExtent2D newOutputExtent);
+
+private:
+  void createColorTarget(VkExtent2D size, VkFormat format, VkImage &image,
+                         VkDeviceMemory &memory, VkImageView &view);
+  void destroyColorTarget(VkImage &image, VkDeviceMemory &memory,
+                          VkImageView &view);
+  void createSceneTarget();
+  void createHistoryImages();
+  void createSampler();
+  void createSceneRenderPass();
+  void createResolveRenderPass();
+  void createFramebuffers();
+  void createDescriptorSetLayouts();
+  void createDescriptorSets();
+  void retireTargets();
+  void retireDescriptorSets();
+  void createPipelineLayouts();
+  void createPipelines(VkRenderPass swapChainRenderPass);
+  void beginPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass,
+                 VkFramebuffer framebuffer, VkExtent2D extent,
+                 VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+  FrgDevice &frgDevice;
+  FrgGBuffer &gbuffer;
+  VkExtent2D outputExtent;
+  VkFormat colorFormat;
+
+  // Internal-resolution scene color (swap chain format)
+  VkImage sceneImage = VK_NULL_HANDLE;
+  VkDeviceMemory sceneMemory = VK_NULL_HANDLE;
+  VkImageView sceneImageView = VK_NULL_HANDLE;
+
+  // Output-resolution history, ping-ponged every frame
+  std::array<VkImage, 2> historyImages{};
+  std::array<VkDeviceMemory, 2> historyMemories{};
+  std::array<VkImageView, 2> historyImageViews{};
+  std::array<VkFramebuffer, 2> historyFramebuffers{};
+  uint32_t historyIndex = 0;
+  bool historyValid = false;
+
+  VkSampler sampler = VK_NULL_HANDLE;
+  VkRenderPass sceneRenderPass = VK_NULL_HANDLE;
+  VkRenderPass resolveRenderPass = VK_NULL_HANDLE;
+  VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
+
+  // Resolve set i writes history i and reads the other one; present set i
+  // reads history i
+  VkDescriptorSetLayout resolveDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSetLayout presentDescriptorSetLayout = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, 2> resolveDescriptorSets{};
+  std::array<VkDescriptorSet, 2> presentDescriptorSets{};
+
+  VkPipelineLayout resolvePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> resolvePipeline;
+  VkPipelineLayout presentPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<FrgPipeline> presentPipeline;
+
+  uint32_t jitterIndex = 0;
+  glm::mat4 prevViewProjection{1.f};
+};
+
+} // namespace frg